@@ -25,14 +25,20 @@
     SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 #include "permutohedral.h"
-#include <unordered_map>
 #include "macroses.h"
+#include "DGM/parallel.h"
+#include "DGM/simd.h"
+
+using namespace DirectGraphicalModels;
 
 // Copy constructor
 CPermutohedral::CPermutohedral(const CPermutohedral &rhs)
     : m_nFeatures(rhs.m_nFeatures)
 	, m_M(rhs.m_M)
 	, m_featureSize(rhs.m_featureSize)
+	, m_vVertexOffsets(rhs.m_vVertexOffsets)
+	, m_vVertexFeatures(rhs.m_vVertexFeatures)
+	, m_vVertexWeights(rhs.m_vVertexWeights)
 {
 	if (!rhs.m_offset.empty()) rhs.m_offset.copyTo(m_offset); 
 	if (!rhs.m_barycentric.empty()) rhs.m_barycentric.copyTo(m_barycentric);
@@ -53,188 +59,281 @@ CPermutohedral & CPermutohedral::operator= (const CPermutohedral &rhs)
 	m_barycentric	= rhs.m_barycentric.empty()		? Mat() : rhs.m_barycentric.clone();
 	m_blurNeighbor1 = rhs.m_blurNeighbor1.empty()	? Mat() : rhs.m_blurNeighbor1.clone();
 	m_blurNeighbor2 = rhs.m_blurNeighbor2.empty()	? Mat() : rhs.m_blurNeighbor2.clone();
+	m_vVertexOffsets = rhs.m_vVertexOffsets;
+	m_vVertexFeatures = rhs.m_vVertexFeatures;
+	m_vVertexWeights = rhs.m_vVertexWeights;
 
 	return *this;
 }
 
-struct Key {
-	Mat mat;
+namespace {
+	// dst = dst + a * src: the vectorized kernel pays off only for long rows
+	inline void axpy(float *dst, const float *src, float a, int n)
+	{
+		if (n >= 16) simd::axpy(dst, src, a, n);
+		else for (int i = 0; i < n; i++) dst[i] += a * src[i];
+	}
+
+	// Hash table of the lattice vertices: the keys are stored in one contiguous array and the table uses the open addressing with linear probing
+	class CHashTable
+	{
+	public:
+		CHashTable(int keySize) : m_keySize(keySize) { resize(1024); }
 
-	bool operator==(const Key& other) const {
-		if (mat.size() != other.mat.size()) return false;
-		if (mat.type() != other.mat.type()) return false;
+		// Returns the number of keys
+		int size(void) const { return static_cast<int>(m_vKeys.size() / m_keySize); }
+		// Returns the pointer to the key with index idx
+		const short* getKey(int idx) const { return m_vKeys.data() + static_cast<size_t>(idx) * m_keySize; }
+		// Returns the index of the key, or -1 if the key is not found and create is false. The new keys get the consecutive indexes.
+		int find(const short* key, bool create = false)
+		{
+			if (create && 2 * static_cast<size_t>(size() + 1) > m_vTable.size()) resize(2 * m_vTable.size());
 
-		for (int y = 0; y < mat.rows; y++) {
-			const short* pMat = mat.ptr<short>(y);
-			const short* pMatOther = other.mat.ptr<short>(y);
-			for (int x = 0; x < mat.cols; x++)
-				if (pMat[x] != pMatOther[x]) return false;
+			for (size_t h = hash(key); ; h = (h + 1) & (m_vTable.size() - 1)) {
+				const int idx = m_vTable[h];
+				if (idx == -1) {
+					if (!create) return -1;
+					m_vKeys.insert(m_vKeys.end(), key, key + m_keySize);
+					return m_vTable[h] = size() - 1;
+				}
+				if (std::equal(key, key + m_keySize, getKey(idx))) return idx;
+			}
 		}
-		return true;
-	}
-};
 
-struct hashFunc
-{
-	std::size_t operator()(const Key &key) const
+
+	private:
+		// Multiplicative hashing of the coordinates, packed into 64 bits: the upper bits of the product give the position in the table
+		size_t hash(const short* key) const
+		{
+			uint64_t res = 0;
+			for (int i = 0; i < m_keySize; i++) res = ((res << 16) | static_cast<unsigned short>(key[i])) ^ ((res >> 48) * 0xFF51AFD7ED558CCDULL);
+			return static_cast<size_t>((res * 0x9E3779B97F4A7C15ULL) >> m_shift);
+		}
+		// Sets the capacity of the table (a power of 2) and re-inserts all keys
+		void resize(size_t capacity)
+		{
+			m_vTable.assign(capacity, -1);
+			m_shift = 64;
+			while (capacity > 1) { capacity /= 2; m_shift--; }
+			for (int idx = 0; idx < size(); idx++) {
+				size_t h = hash(getKey(idx));
+				while (m_vTable[h] != -1) h = (h + 1) & (m_vTable.size() - 1);
+				m_vTable[h] = idx;
+			}
+		}
+
+
+	private:
+		int					m_keySize;
+		int					m_shift;		// 64 - log2(capacity)
+		std::vector<int>	m_vTable;		// indexes of the keys or -1 for the empty cells: capacity
+		std::vector<short>	m_vKeys;		// all keys: size() x keySize
+	};
+
+	// Embedding of the features into the permutohedral lattice: finds the enclosing simplex of a feature and its barycentric coordinates
+	class CSimplexEmbedding
 	{
-		std::size_t res = 0;
-		const short* ptr = key.mat.ptr<short>(0);
-		for (int i = 0; i < key.mat.cols; i++) {
-			res += static_cast<size_t>(ptr[i]);
-			res *= 1664525;
+	public:
+		CSimplexEmbedding(int featureSize)
+			: m_featureSize(featureSize)
+			, m_vScaleFactor(featureSize)
+			, m_vElevated(featureSize + 1)
+			, m_vRem0(featureSize + 1)
+			, m_vBarycentric(featureSize + 2)
+			, m_vRank(featureSize + 1)
+			, m_vCanonical((featureSize + 1) * (featureSize + 1))
+		{
+			// Compute the canonical simplex
+			for(int i = 0; i <= m_featureSize; i++) {
+				for(int j = 0; j <= m_featureSize - i; j++)
+					m_vCanonical[i * (m_featureSize + 1) + j] = i;
+				for(int j = m_featureSize - i + 1; j <= m_featureSize; j++)
+					m_vCanonical[i * (m_featureSize + 1) + j] = i - (m_featureSize + 1);
+			}
+    
+			// Expected standard deviation of our filter (p.6 in [Adams etal 2010])
+			float inv_std_dev = sqrtf(2.f / 3.f) * (m_featureSize + 1);
+			// Compute the diagonal part of E (p.5 in [Adams etal 2010])
+			for(int i = 0; i < m_featureSize; i++)
+				m_vScaleFactor[i] = 1.f / sqrtf((i + 2.f) * (i + 1.f)) * inv_std_dev;
 		}
-		return res;
-	}
-};
+
+		// Computes the keys of the d + 1 simplex vertices: (d + 1) x d and the barycentric coordinates: d + 1 of the feature f
+		void embed(const float *f, short *pKeys, float *pBarycentric)
+		{
+			// Elevate the feature ( y = Ep, see p.5 in [Adams etal 2010])
+			// sm contains the sum of 1..n of our faeture vector
+			float sm = 0;
+			for(int j = m_featureSize; j > 0; j--){
+				float cf = f[j-1]*m_vScaleFactor[j-1];
+				m_vElevated[j] = sm - j*cf;
+				sm += cf;
+			}
+			m_vElevated[0] = sm;
+        
+			// Find the closest 0-colored simplex through rounding
+			float down_factor = 1.0f / (m_featureSize + 1);
+			float up_factor = static_cast<float>(m_featureSize + 1);
+			int sum = 0;
+			for(int i = 0; i <= m_featureSize; i++) {
+				int rd = static_cast<int>(round( down_factor * m_vElevated[i]));
+				m_vRem0[i] = rd*up_factor;
+				sum += rd;
+			}
+        
+			// Find the simplex we are in and store it in rank (where rank describes what position coorinate i has in the sorted order of the features values)
+			for(int i = 0; i <= m_featureSize; i++)
+				m_vRank[i] = 0;
+			for(int i = 0; i < m_featureSize; i++) {
+				double di = m_vElevated[i] - m_vRem0[i];
+				for(int j = i + 1; j <= m_featureSize; j++)
+					if (di < m_vElevated[j] - m_vRem0[j])	m_vRank[i]++;
+					else									m_vRank[j]++;
+			}
+        
+			// If the point doesn't lie on the plane (sum != 0) bring it back
+			for(int i = 0; i <= m_featureSize; i++) {
+				m_vRank[i] += sum;
+				if ( m_vRank[i] < 0 ){
+					m_vRank[i] += m_featureSize + 1;
+					m_vRem0[i] += m_featureSize + 1;
+				}
+				else if (m_vRank[i] > m_featureSize) {
+					m_vRank[i] -= m_featureSize + 1;
+					m_vRem0[i] -= m_featureSize + 1;
+				}
+			}
+        
+			// Compute the barycentric coordinates (p.10 in [Adams etal 2010])
+			for(int i = 0; i <= m_featureSize + 1; i++)
+				m_vBarycentric[i] = 0;
+			for(int i = 0; i <= m_featureSize; i++) {
+				float v = (m_vElevated[i] - m_vRem0[i])*down_factor;
+				m_vBarycentric[m_featureSize - m_vRank[i]  ] += v;
+				m_vBarycentric[m_featureSize - m_vRank[i] + 1] -= v;
+			}
+			// Wrap around
+			m_vBarycentric[0] += 1.0f + m_vBarycentric[m_featureSize + 1];
+        
+			// Compute all vertices
+			for(int remainder = 0; remainder <= m_featureSize; remainder++) {
+				for(int i = 0; i < m_featureSize; i++)
+					pKeys[remainder * m_featureSize + i] = static_cast<short>(m_vRem0[i] + m_vCanonical[remainder * (m_featureSize + 1) + m_vRank[i]]);
+				pBarycentric[remainder] = m_vBarycentric[remainder];
+			}
+		}
+
+
+	private:
+		int					m_featureSize;
+		vec_float_t			m_vScaleFactor;
+		vec_float_t			m_vElevated;
+		vec_float_t			m_vRem0;
+		vec_float_t			m_vBarycentric;
+		std::vector<short>	m_vRank;
+		std::vector<short>	m_vCanonical;
+	};
+}
 
 void CPermutohedral::init(const Mat &features)
+{
+	init(features.rows, features.cols, [&features](int k, float *pFeature) {
+		const float *f = features.ptr<float>(k);
+		std::copy(f, f + features.cols, pFeature);
+	});
+}
+
+void CPermutohedral::init(int nFeatures, int featureSize, const std::function<void(int, float *)> &generator)
 {
 	// Compute the lattice coordinates for each feature [there is going to be a lot of magic here
-    m_nFeatures = features.rows;
-    m_featureSize = features.cols;
-	std::unordered_map<Key, int, hashFunc> hash_table;
-	hash_table.reserve(m_nFeatures * (m_featureSize + 1));
-	Mat allKeys;
+    m_nFeatures = nFeatures;
+    m_featureSize = featureSize;
+	CHashTable hash_table(m_featureSize);							// usually the lattice has much less vertices than the features
 
     // Allocate the class memory
 	m_offset		= Mat(m_nFeatures, m_featureSize + 1, CV_32SC1); 
     m_barycentric	= Mat(m_nFeatures, m_featureSize + 1, CV_32FC1);
 
-    
-    // Allocate the local memory
-    vec_float_t scale_factor(m_featureSize);
-    vec_float_t elevated(m_featureSize + 1);
-    vec_float_t rem0(m_featureSize + 1);
-    vec_float_t barycentric(m_featureSize + 2);
-    std::vector<short> rank(m_featureSize + 1);
-    std::vector<short> canonical((m_featureSize + 1) * (m_featureSize + 1));
-	Mat key(1, m_featureSize + 1, CV_16SC1);
-    
-    // Compute the canonical simplex
-    for(int i = 0; i <= m_featureSize; i++) {
-        for(int j = 0; j <= m_featureSize - i; j++)
-            canonical[i * (m_featureSize + 1) + j] = i;
-        for(int j = m_featureSize - i + 1; j <= m_featureSize; j++)
-            canonical[i * (m_featureSize + 1) + j] = i - (m_featureSize + 1);
-    }
-    
-    // Expected standard deviation of our filter (p.6 in [Adams etal 2010])
-    float inv_std_dev = sqrtf(2.f / 3.f) * (m_featureSize + 1);
-    // Compute the diagonal part of E (p.5 in [Adams etal 2010])
-    for(int i = 0; i < m_featureSize; i++)
-        scale_factor[i] = 1.f / sqrtf((i + 2.f) * (i + 1.f)) * inv_std_dev;
-    
-    // Compute the simplex each feature lies in
-    for(int k = 0; k < m_nFeatures; k++) {
-        // Elevate the feature ( y = Ep, see p.5 in [Adams etal 2010])
-        const float *f = features.ptr<float>(k);
-        
-        // sm contains the sum of 1..n of our faeture vector
-        float sm = 0;
-        for(int j = m_featureSize; j > 0; j--){
-            float cf = f[j-1]*scale_factor[j-1];
-            elevated[j] = sm - j*cf;
-            sm += cf;
-        }
-        elevated[0] = sm;
-        
-        // Find the closest 0-colored simplex through rounding
-        float down_factor = 1.0f / (m_featureSize + 1);
-        float up_factor = static_cast<float>(m_featureSize + 1);
-        int sum = 0;
-        for(int i = 0; i <= m_featureSize; i++) {
-            int rd = static_cast<int>(round( down_factor * elevated[i]));
-            rem0[i] = rd*up_factor;
-            sum += rd;
-        }
-        
-        // Find the simplex we are in and store it in rank (where rank describes what position coorinate i has in the sorted order of the features values)
-        for(int i = 0; i <= m_featureSize; i++)
-            rank[i] = 0;
-        for(int i = 0; i < m_featureSize; i++) {
-            double di = elevated[i] - rem0[i];
-            for(int j = i + 1; j <= m_featureSize; j++)
-                if (di < elevated[j] - rem0[j])    rank[i]++;
-                else                            rank[j]++;
-        }
-        
-        // If the point doesn't lie on the plane (sum != 0) bring it back
-        for(int i = 0; i <= m_featureSize; i++) {
-            rank[i] += sum;
-            if ( rank[i] < 0 ){
-                rank[i] += m_featureSize + 1;
-                rem0[i] += m_featureSize + 1;
-            }
-            else if (rank[i] > m_featureSize) {
-                rank[i] -= m_featureSize + 1;
-                rem0[i] -= m_featureSize + 1;
-            }
-        }
-        
-        // Compute the barycentric coordinates (p.10 in [Adams etal 2010])
-        for(int i = 0; i <= m_featureSize + 1; i++)
-            barycentric[i] = 0;
-        for(int i = 0; i <= m_featureSize; i++) {
-            float v = (elevated[i] - rem0[i])*down_factor;
-            barycentric[m_featureSize - rank[i]  ] += v;
-            barycentric[m_featureSize - rank[i] + 1] -= v;
-        }
-        // Wrap around
-        barycentric[0] += 1.0f + barycentric[m_featureSize + 1];
-        
-        // Compute all vertices and their offset
-		int		*pOffset		= m_offset.ptr<int>(k);
-		float	*pBarycentric	= m_barycentric.ptr<float>(k);
-		for(int remainder = 0; remainder <= m_featureSize; remainder++) {
-            for(int i = 0; i < m_featureSize; i++)
-                key.at<short>(0, i) = static_cast<short>(rem0[i] + canonical[ remainder * (m_featureSize + 1) + rank[i]]);		// TODO
-			
-			auto it = hash_table.find({ key(Rect(0, 0, m_featureSize, 1)) });
-			int val = it == hash_table.end() ? -1 : it->second;
-			if (val == -1) {
-				val = static_cast<int>(hash_table.size());
-				hash_table[{ key(Rect(0, 0, m_featureSize, 1)).clone() }] = val;
-				allKeys.push_back(key(Rect(0, 0, m_featureSize, 1)));
+	// The features are processed in chunks: the simplices are found in parallel, then their vertices are inserted into the hash table
+	const int chunkSize = 16384;
+	const int blockSize = 256;
+	const int keysSize	= (m_featureSize + 1) * m_featureSize;		// keys of all simplex vertices of one feature
+	std::vector<short> vKeys(static_cast<size_t>(MIN(chunkSize, m_nFeatures)) * keysSize);
+	for (int first = 0; first < m_nFeatures; first += chunkSize) {
+		const int last = MIN(first + chunkSize, m_nFeatures);
+
+		// Compute the simplex each feature lies in
+#ifdef ENABLE_PARALLEL
+		parallel::parallel_for(first, last, blockSize, [&](int begin) {
+#else
+		for (int begin = first; begin < last; begin += blockSize) {
+#endif
+			CSimplexEmbedding embedding(m_featureSize);
+			vec_float_t feature(m_featureSize);
+			for (int k = begin; k < MIN(begin + blockSize, last); k++) {
+				generator(k, feature.data());
+				embedding.embed(feature.data(), &vKeys[static_cast<size_t>(k - first) * keysSize], m_barycentric.ptr<float>(k));
 			}
-			pOffset[remainder]		= val;	
-			pBarycentric[remainder]	= barycentric[remainder];		
-        }
-    } // k
+		}
+#ifdef ENABLE_PARALLEL
+		);
+#endif
+
+		// Compute all vertices and their offset
+		for (int k = first; k < last; k++) {
+			int *pOffset = m_offset.ptr<int>(k);
+			for (int remainder = 0; remainder <= m_featureSize; remainder++)
+				pOffset[remainder] = hash_table.find(&vKeys[static_cast<size_t>(k - first) * keysSize + remainder * m_featureSize], true);
+		}
+	} // first
     
     // Find the Neighbors of each lattice point
     // Get the number of vertices in the lattice
-	m_M = static_cast<int>(hash_table.size());
+	m_M = hash_table.size();
     
     // Create the neighborhood structure
 	m_blurNeighbor1 = Mat(m_M, m_featureSize + 1, CV_32SC1);
 	m_blurNeighbor2 = Mat(m_M, m_featureSize + 1, CV_32SC1);
     
-    Mat n1(1, m_featureSize + 1, CV_16SC1);
-    Mat n2(1, m_featureSize + 1, CV_16SC1);
+    std::vector<short> n1(m_featureSize + 1);
+    std::vector<short> n2(m_featureSize + 1);
     
     // For each of d+1 axes,
 	for (int i = 0; i < m_M; i++) {
 		int *pBlurNeighbor1 = m_blurNeighbor1.ptr<int>(i);
 		int *pBlurNeighbor2 = m_blurNeighbor2.ptr<int>(i);
 		
-		Mat key = allKeys.row(i); 
+		const short *pKey = hash_table.getKey(i);
 
 		for(int j = 0; j <= m_featureSize; j++) {
 
 			for(int k = 0; k < m_featureSize; k++) {
-                n1.at<short>(0, k) = key.at<short>(0, k) - 1;	// TODO
-                n2.at<short>(0, k) = key.at<short>(0, k) + 1;	// TODO
+                n1[k] = pKey[k] - 1;
+                n2[k] = pKey[k] + 1;
             }
-            n1.at<short>(0, j) = key.at<short>(0, std::min(j, m_featureSize - 1)) + m_featureSize;	// TODO
-            n2.at<short>(0, j) = key.at<short>(0, std::min(j, m_featureSize - 1)) - m_featureSize;	// TODO
+            n1[j] = pKey[std::min(j, m_featureSize - 1)] + m_featureSize;
+            n2[j] = pKey[std::min(j, m_featureSize - 1)] - m_featureSize;
             
-			auto it = hash_table.find({ n1(Rect(0, 0, m_featureSize, 1)) });
-			pBlurNeighbor1[j] = it == hash_table.end() ? -1 : it->second;
-			it = hash_table.find({ n2(Rect(0, 0, m_featureSize, 1)) });
-			pBlurNeighbor2[j] = it == hash_table.end() ? -1 : it->second;
+			pBlurNeighbor1[j] = hash_table.find(n1.data());
+			pBlurNeighbor2[j] = hash_table.find(n2.data());
         }
     }
+
+	// Build the inverse of m_offset with the counting sort, so that every vertex may gather its values independently
+	const int nEntries = m_nFeatures * (m_featureSize + 1);
+	const int *pOffset = m_offset.ptr<int>();
+	m_vVertexOffsets.assign(m_M + 1, 0);
+	for (int e = 0; e < nEntries; e++) m_vVertexOffsets[pOffset[e] + 1]++;
+	for (int i = 0; i < m_M; i++) m_vVertexOffsets[i + 1] += m_vVertexOffsets[i];
+	m_vVertexFeatures.resize(nEntries);
+	m_vVertexWeights.resize(nEntries);
+	const float *pBarycentric = m_barycentric.ptr<float>();
+	vec_int_t vPos(m_vVertexOffsets.begin(), m_vVertexOffsets.end() - 1);
+	for (int e = 0; e < nEntries; e++) {
+		const int pos = vPos[pOffset[e]]++;
+		m_vVertexFeatures[pos] = e / (m_featureSize + 1);
+		m_vVertexWeights[pos]  = pBarycentric[e];
+	}
 }
 
 void CPermutohedral::compute(const Mat &src, Mat &dst, int in_offset, int out_offset, size_t in_size, size_t out_size) const
@@ -243,54 +342,70 @@ void CPermutohedral::compute(const Mat &src, Mat &dst, int in_offset, int out_of
     if (out_size == 0) out_size = m_nFeatures - out_offset;
 	if (dst.empty())   dst		= Mat(static_cast<int>(out_size), src.cols, CV_32FC1);
 
+	const int nStates	= src.cols;
+	const int in_begin	= in_offset;
+	const int in_end	= in_offset + static_cast<int>(in_size);
+
     // Shift all values by 1 such that -1 -> 0 (used for blurring)
-	Mat values(m_M + 2, src.cols, CV_32FC1, Scalar(0));
-    Mat newValues(m_M + 2, src.cols, CV_32FC1, Scalar(0));
+	m_values.create(m_M + 2, nStates, CV_32FC1);
+	m_newValues.create(m_M + 2, nStates, CV_32FC1);
+	m_values.row(0).setTo(0);
+	m_newValues.row(0).setTo(0);
 
-    // Splatting
-    for(int i = 0; i < in_size; i++) {
-        const float *pIn			= src.ptr<float>(i);
-		const int	*pOffset		= m_offset.ptr<int>(in_offset + i);
-		const float	*pBarycentric	= m_barycentric.ptr<float>(in_offset + i);
-		for(int j = 0; j <= m_featureSize; j++) {
-            int   o	= pOffset[j] + 1;
-            float w = pBarycentric[j];	
-			float *pValues = values.ptr<float>(o);
-			for(int k = 0; k < src.cols; k++)
-				pValues[k] += w * pIn[k];
-        }
-    }
-    
+    // Splatting: every vertex gathers the values of its features, thus no synchronization is needed
+#ifdef ENABLE_PARALLEL
+	parallel::parallel_for(0, m_M, [&](int i) {
+#else
+	for (int i = 0; i < m_M; i++) {
+#endif
+		float *pValues = m_values.ptr<float>(i + 1);
+		std::fill(pValues, pValues + nStates, 0.0f);
+		for (int e = m_vVertexOffsets[i]; e < m_vVertexOffsets[i + 1]; e++) {
+			const int k = m_vVertexFeatures[e];
+			if (k >= in_begin && k < in_end) axpy(pValues, src.ptr<float>(k - in_offset), m_vVertexWeights[e], nStates);
+		}
+	}
+#ifdef ENABLE_PARALLEL
+	);
+#endif
+
+    // Blurring
     for(int j = 0; j <= m_featureSize; j++) {
-        for(int i = 0; i < m_M; i++) {
-            float *pValues		= values.ptr<float>(i + 1);
-            float *pNewValues	= newValues.ptr<float>(i + 1);
-            
-            int n1 = m_blurNeighbor1.at<int>(i, j) + 1;
-            int n2 = m_blurNeighbor2.at<int>(i, j) + 1;
-            float *n1_val = values.ptr<float>(n1);
-            float *n2_val = values.ptr<float>(n2);
-            for(int k = 0; k < src.cols; k++)
-				pNewValues[k] = pValues[k] + 0.5f * (n1_val[k] + n2_val[k]);
-        }
-		swap(values, newValues);
+#ifdef ENABLE_PARALLEL
+		parallel::parallel_for(0, m_M, [&](int i) {
+#else
+		for (int i = 0; i < m_M; i++) {
+#endif
+			const float *pValues	= m_values.ptr<float>(i + 1);
+			float		*pNewValues	= m_newValues.ptr<float>(i + 1);
+			const float *n1_val		= m_values.ptr<float>(m_blurNeighbor1.at<int>(i, j) + 1);
+			const float *n2_val		= m_values.ptr<float>(m_blurNeighbor2.at<int>(i, j) + 1);
+			std::copy(pValues, pValues + nStates, pNewValues);
+			axpy(pNewValues, n1_val, 0.5f, nStates);
+			axpy(pNewValues, n2_val, 0.5f, nStates);
+		}
+#ifdef ENABLE_PARALLEL
+		);
+#endif
+		swap(m_values, m_newValues);
     }
     // Alpha is a magic scaling constant (write Andrew if you really wanna understand this)
     float alpha = 1.0f / (1.0f + powf(2.0f, -static_cast<float>(m_featureSize)));
-    
+
     // Slicing
-    for(int i = 0; i < out_size; i++) {
-        float		*pOut			= dst.ptr<float>(i);
+#ifdef ENABLE_PARALLEL
+	parallel::parallel_for(0, static_cast<int>(out_size), [&](int i) {
+#else
+	for (int i = 0; i < static_cast<int>(out_size); i++) {
+#endif
+		float		*pOut			= dst.ptr<float>(i);
 		const int	*pOffset		= m_offset.ptr<int>(in_offset + i);
 		const float	*pBarycentric	= m_barycentric.ptr<float>(in_offset + i);
-		for(int k = 0; k < src.cols; k++)
-            pOut[k] = 0;
-        for(int j = 0; j <= m_featureSize; j++) {
-            int   o = pOffset[j] + 1;		
-            float w = pBarycentric[j];	
-			float *pValues = values.ptr<float>(o);
-			for(int k = 0; k < src.cols; k++)
-                pOut[k] += w * pValues[k] * alpha;
-        }
-    }
+		std::fill(pOut, pOut + nStates, 0.0f);
+		for (int j = 0; j <= m_featureSize; j++)
+			axpy(pOut, m_values.ptr<float>(pOffset[j] + 1), pBarycentric[j] * alpha, nStates);
+	}
+#ifdef ENABLE_PARALLEL
+	);
+#endif
 }
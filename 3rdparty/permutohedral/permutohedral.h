@@ -43,6 +43,11 @@ public:
 	~CPermutohedral(void) = default;
 
     void init(const Mat& features);
+    // Builds the lattice without the feature matrix: generator(k, pFeature) writes featureSize values of the feature k into pFeature.
+    // The generator is called concurrently from several threads
+    void init(int nFeatures, int featureSize, const std::function<void(int, float *)>& generator);
+    // Splatting, blurring and slicing are executed in parallel. The lattice keeps the intermediate values between the calls,
+    // so one lattice object may not be used by several threads at the same time
     void compute(const Mat& src, Mat& dst, int in_offset = 0, int out_offset = 0, size_t in_size = 0, size_t out_size = 0) const;
 
     
@@ -55,4 +60,11 @@ private:
     Mat	m_barycentric       = Mat();
     Mat	m_blurNeighbor1		= Mat();
 	Mat	m_blurNeighbor2		= Mat();
+
+    vec_int_t m_vVertexOffsets;                 // Inverse of m_offset: entries of the vertex i are in range [m_vVertexOffsets[i]; m_vVertexOffsets[i + 1])
+    vec_int_t m_vVertexFeatures;                // Features k, splatted to the vertices, sorted by vertex and by feature
+    vec_float_t m_vVertexWeights;               // Corresponding barycentric weights
+
+    mutable Mat m_values    = Mat();            // Scratch buffers for the values on the lattice: (m_M + 2) x nStates
+    mutable Mat m_newValues = Mat();
 };
@@ -0,0 +1,76 @@
+// Microbenchmark of the vectorized message passing kernels
+#include "DGM.h"
+
+using namespace DirectGraphicalModels;
+
+namespace {
+	// Builds a 4-connected grid graph with random potentials
+	void fillGraph(CGraphPairwise &graph, int width, int height)
+	{
+		const byte nStates = graph.getNumStates();
+		Mat nodePot(nStates, 1, CV_32FC1);
+		Mat edgePot(nStates, nStates, CV_32FC1);
+
+		for (int y = 0; y < height; y++)
+			for (int x = 0; x < width; x++) {
+				randu(nodePot, 0.1f, 1.0f);
+				size_t idx = graph.addNode(nodePot);
+				if (x > 0) graph.addArc(idx - 1, idx);
+				if (y > 0) graph.addArc(idx - width, idx);
+			}
+		randu(edgePot, 0.1f, 1.0f);
+		edgePot = edgePot + edgePot.t();						// symmetric, but not Potts
+		graph.setEdges(std::nullopt, edgePot);
+	}
+
+	// Returns the time in milliseconds of the inference on the graph with the given instruction set
+	double timeInference(CGraphPairwise &graph, const Mat &nodePots, simd::ISA isa, bool maxSum)
+	{
+		simd::setISA(isa);
+		for (size_t n = 0; n < graph.getNumNodes(); n++) graph.setNode(n, nodePots.col(static_cast<int>(n)).clone());
+
+		int64 ticks = getTickCount();
+		if (maxSum) CInferViterbi(graph).infer(10);
+		else		CInferLBP(graph).infer(10);
+		return 1000.0 * (getTickCount() - ticks) / getTickFrequency();
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	std::vector<simd::ISA> vISAs;
+	for (simd::ISA isa : { simd::ISA::scalar, simd::ISA::SSE, simd::ISA::NEON, simd::ISA::AVX2, simd::ISA::AVX512 })
+		if (simd::isSupported(isa)) vISAs.push_back(isa);
+	const simd::ISA bestISA = simd::getISA();
+
+	printf("Time of 10 iterations on a 32 x 32 grid, ms\n");
+	for (bool maxSum : { false, true }) {
+		printf("\n%s\nnStates", maxSum ? "Viterbi (max-product)" : "LBP (sum-product)");
+		for (simd::ISA isa : vISAs) printf("\t%8s", simd::getISAName(isa));
+		printf("\tspeedup\n");
+
+		for (int nStates : { 2, 4, 8, 16, 32, 64, 128, 255 }) {
+			CGraphPairwise graph(static_cast<byte>(nStates));
+			fillGraph(graph, 32, 32);
+
+			// the inference overwrites the node potentials: the same ones are set before each run
+			Mat nodePots(nStates, static_cast<int>(graph.getNumNodes()), CV_32FC1);
+			for (size_t n = 0; n < graph.getNumNodes(); n++) {
+				Mat pot;
+				graph.getNode(n, pot);
+				pot.copyTo(nodePots.col(static_cast<int>(n)));
+			}
+
+			printf("%d", nStates);
+			std::vector<double> vTimes;
+			for (simd::ISA isa : vISAs) {
+				vTimes.push_back(timeInference(graph, nodePots, isa, maxSum));
+				printf("\t%8.1f", vTimes.back());
+			}
+			printf("\t%7.2fx\n", vTimes.front() / vTimes.back());
+		}
+	}
+
+	simd::setISA(bestISA);
+	return 0;
+}
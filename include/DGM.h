@@ -7,6 +7,7 @@
 #include "DGM/KDTree.h"
 #include "DGM/random.h"
 #include "DGM/parallel.h"
+#include "DGM/simd.h"
 
 #include "DGM/IPDF.h"
 #include "DGM/PDFHistogram.h"
@@ -57,6 +58,8 @@
 
 #include "DGM/IEdgeModel.h"
 #include "DGM/EdgeModelPotts.h"
+#include "DGM/EdgeModelGaussian.h"
+#include "DGM/EdgeModelCompatibility.h"
 
 #include "DGM/Infer.h"
 #include "DGM/InferExact.h"
@@ -64,6 +67,7 @@
 #include "DGM/InferChain.h"
 #include "DGM/InferTree.h"
 #include "DGM/InferLBP.h"
+#include "DGM/InferRBP.h"
 #include "DGM/InferTRW.h"
 #include "DGM/InferViterbi.h"
 
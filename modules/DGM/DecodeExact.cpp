@@ -79,10 +79,6 @@ namespace DirectGraphicalModels
                     p *= ePot.at<float>(state[n], state[c]);
                 }
             }
-            
-            // Old implementation with direct access to CGraphPairwise private member variables
-            // for (ptr_node_t &node : getGraphPairwise().m_vNodes) p *= node->Pot.at<float>(state[node->id], 0);
-            // for (ptr_edge_t &edge : getGraphPairwise().m_vEdges) p *= edge->Pot.at<float>(state[edge->node1], state[edge->node2]);
 			incState(state);
 		}
 
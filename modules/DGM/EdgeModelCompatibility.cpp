@@ -0,0 +1,62 @@
+#include "EdgeModelCompatibility.h"
+#include "permutohedral/permutohedral.h"
+#include "parallel.h"
+#include "macroses.h"
+
+namespace DirectGraphicalModels {
+	// Constructor
+	CEdgeModelCompatibility::CEdgeModelCompatibility(const Mat& features, const Mat& compatibility, float weight, bool perPixelNormalization)
+		: CEdgeModelPotts(features, weight, {}, perPixelNormalization)
+		, m_compatibility(compatibility.clone())
+	{
+		DGM_ASSERT(compatibility.type() == CV_32FC1);
+		DGM_ASSERT_MSG(compatibility.rows == compatibility.cols, "The compatibility matrix must be quadratic");
+	}
+
+	// Constructor
+	CEdgeModelCompatibility::CEdgeModelCompatibility(int nNodes, int nFeatures, const std::function<void(int n, float *pFeature)>& featureGenerator, const Mat& compatibility, float weight, bool perPixelNormalization)
+		: CEdgeModelPotts(nNodes, nFeatures, featureGenerator, weight, {}, perPixelNormalization)
+		, m_compatibility(compatibility.clone())
+	{
+		DGM_ASSERT(compatibility.type() == CV_32FC1);
+		DGM_ASSERT_MSG(compatibility.rows == compatibility.cols, "The compatibility matrix must be quadratic");
+	}
+
+	// dst = e^(w * norm * Lattice.compute(src) * compatibility)
+	void CEdgeModelCompatibility::apply(const Mat &src, Mat &dst) const
+	{
+		filter(src);
+		dst.create(src.size(), CV_32FC1);
+		parallel::gemm(m_tmp, m_compatibility, 1.0f, Mat(), 0.0f, dst);
+		exp(dst, dst);
+	}
+
+	// dst += w * norm * Lattice.compute(src) * compatibility
+	void CEdgeModelCompatibility::applyLog(const Mat &src, Mat &dst) const
+	{
+		filter(src);
+		parallel::gemm(m_tmp, m_compatibility, 1.0f, dst, 1.0f, dst);
+	}
+
+	// tmp = w * norm * Lattice.compute(src)
+	void CEdgeModelCompatibility::filter(const Mat &src) const
+	{
+		DGM_ASSERT_MSG(src.cols == m_compatibility.rows, "The number of states (%d) does not correspond to the size of the compatibility matrix (%d)", src.cols, m_compatibility.rows);
+		
+		m_tmp.create(src.size(), CV_32FC1);
+		m_pLattice->compute(src, m_tmp);
+
+#ifdef ENABLE_PARALLEL
+		parallel::parallel_for(0, m_tmp.rows, [&](int n) {
+#else
+		for (int n = 0; n < m_tmp.rows; n++) {	// nodes
+#endif
+			float*	pTmp = m_tmp.ptr<float>(n);
+			float	k = m_weight * m_norm.at<float>(n, 0);
+			for (int s = 0; s < m_tmp.cols; s++) pTmp[s] *= k;
+		}
+#ifdef ENABLE_PARALLEL
+		);
+#endif
+	}
+}
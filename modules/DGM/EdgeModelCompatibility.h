@@ -0,0 +1,53 @@
+// Compatibility Edge Model class interface
+#pragma once
+
+#include "EdgeModelPotts.h"
+
+namespace DirectGraphicalModels {
+	// ================================ Compatibility Edge Model ================================
+	/**
+	* @brief Label-compatibility %Edge Model for dense graphical models
+	* @details This class generalizes the @ref CEdgeModelPotts model with an arbitrary label compatibility matrix \f$\mu\f$: the message 
+	* for the state \f$s\f$ is \f$w \cdot \sum_t \tilde{Q}(t)\mu(t, s)\f$, where \f$\tilde{Q}\f$ is the output of the permutohedral lattice filter.
+	* The identity matrix results in the Potts model. The matrix is applied to all nodes at once with parallel::gemm().
+	* @ingroup moduleGraph
+	*/
+	class CEdgeModelCompatibility : public CEdgeModelPotts {
+	public:
+		/**
+		* @brief Constructor
+		* @param features The set of features which correspond to the nodes of the dense graphical model: Mat(size: nNodes x nFeatures; type: CV_32FC1)
+		* @param compatibility The label compatibility matrix: Mat(size: nStates x nStates; type: CV_32FC1)
+		* @param weight The weighting parameter (default value is 1)
+		* @param perPixelNormalization Flag indicating whether er-pixel normalization should be used during applying the edge model.
+		*/
+		DllExport CEdgeModelCompatibility(const Mat& features, const Mat& compatibility, float weight = 1.0f, bool perPixelNormalization = true);
+		/**
+		* @brief Constructor
+		* @param nNodes The number of nodes of the dense graphical model
+		* @param nFeatures The number of features per node
+		* @param featureGenerator Reference to a function, which writes \b nFeatures features of the node \b n into the array \b pFeature. 
+		* For more details refere to @ref CEdgeModelPotts.
+		* @param compatibility The label compatibility matrix: Mat(size: nStates x nStates; type: CV_32FC1)
+		* @param weight The weighting parameter (default value is 1)
+		* @param perPixelNormalization Flag indicating whether er-pixel normalization should be used during applying the edge model.
+		*/
+		DllExport CEdgeModelCompatibility(int nNodes, int nFeatures, const std::function<void(int n, float *pFeature)>& featureGenerator, const Mat& compatibility, float weight = 1.0f, bool perPixelNormalization = true);
+		DllExport virtual ~CEdgeModelCompatibility(void) = default;
+
+		DllExport void apply(const Mat &src, Mat &dst) const override;
+		DllExport void applyLog(const Mat &src, Mat &dst) const override;
+
+
+	private:
+		/**
+		* @brief Filters the node potentials and scales the result with the weight and the normalization factors
+		* @param src The node potentials: Mat(size: nNodes x nStates; type: CV_32FC1)
+		*/
+		void filter(const Mat &src) const;
+
+
+	private:
+		Mat	m_compatibility;		///< The label compatibility matrix: Mat(size: nStates x nStates; type: CV_32FC1)
+	};
+}
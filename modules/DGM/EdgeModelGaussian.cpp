@@ -0,0 +1,136 @@
+#include "EdgeModelGaussian.h"
+#include "parallel.h"
+#include "simd.h"
+#include "macroses.h"
+
+namespace DirectGraphicalModels {
+	namespace {
+		// Returns the Gaussian kernel exp(-k^2 / (2 * sigma^2)) for k in range [-3 * sigma; 3 * sigma]
+		vec_float_t getKernel(float sigma)
+		{
+			const int radius = MAX(0, static_cast<int>(ceilf(3 * sigma)));
+			vec_float_t res(2 * radius + 1);
+			for (int k = -radius; k <= radius; k++)
+				res[radius + k] = expf(-0.5f * k * k / (sigma * sigma));
+			return res;
+		}
+	}
+
+	// Constructor
+	CEdgeModelGaussian::CEdgeModelGaussian(Size size, Vec2f sigma, float weight, const std::function<void(const Mat& src, Mat& dst)>& semiMetricFunction, bool perPixelNormalization)
+		: IEdgeModel()
+		, m_size(size)
+		, m_vKernelX(getKernel(sigma.val[0]))
+		, m_vKernelY(getKernel(sigma.val[1]))
+		, m_weight(weight)
+		, m_function(semiMetricFunction)
+	{
+		DGM_ASSERT_MSG(sigma.val[0] > 0 && sigma.val[1] > 0, "The standard deviation must be positive");
+		
+		// Compute the normalization factor
+		filter(Mat(size.width * size.height, 1, CV_32FC1, Scalar(1)), m_norm);
+
+		if (perPixelNormalization)
+			for (int n = 0; n < m_norm.rows; n++)
+				m_norm.at<float>(n, 0) = 1.0f / (m_norm.at<float>(n, 0) + FLT_EPSILON);
+		else {
+			float mean_norm = static_cast<float>(sum(m_norm)[0]);
+			mean_norm = m_norm.rows / mean_norm;
+			m_norm.setTo(mean_norm);
+		}
+	}
+
+	// dst = e^(w * norm * f(Gaussian(src)))
+	void CEdgeModelGaussian::apply(const Mat &src, Mat &dst) const
+	{
+		filter(src, dst);
+
+#ifdef ENABLE_PARALLEL
+		parallel::parallel_for(0, dst.rows, [&](int n) {
+#else
+		for (int n = 0; n < dst.rows; n++) {	// nodes
+#endif
+			if (m_function) m_function(dst.row(n), lvalue_cast(dst.row(n)));		// With the SemiMetric function
+
+			float*	pDst = dst.ptr<float>(n);
+			float	k = m_weight * m_norm.at<float>(n, 0);
+			for (int s = 0; s < dst.cols; s++) pDst[s] *= k;
+		}
+#ifdef ENABLE_PARALLEL
+		);
+#endif
+		exp(dst, dst);
+	}
+
+	// dst += w * norm * f(Gaussian(src))
+	void CEdgeModelGaussian::applyLog(const Mat &src, Mat &dst) const
+	{
+		filter(src, m_res);
+
+#ifdef ENABLE_PARALLEL
+		parallel::parallel_for(0, dst.rows, [&](int n) {
+#else
+		for (int n = 0; n < dst.rows; n++) {	// nodes
+#endif
+			if (m_function) m_function(m_res.row(n), lvalue_cast(m_res.row(n)));	// With the SemiMetric function
+
+			const float	*pRes	= m_res.ptr<float>(n);
+			float		*pDst	= dst.ptr<float>(n);
+			float		k		= m_weight * m_norm.at<float>(n, 0);
+			for (int s = 0; s < dst.cols; s++) pDst[s] += k * pRes[s];
+		}
+#ifdef ENABLE_PARALLEL
+		);
+#endif
+	}
+
+	// Both passes shift whole pixels, i.e. nStates floats, so every kernel tap is one long axpy over the row or over the image
+	void CEdgeModelGaussian::filter(const Mat &src, Mat &dst) const
+	{
+		const int width		= m_size.width;
+		const int height	= m_size.height;
+		const int nStates	= src.cols;
+		const int radiusX	= static_cast<int>(m_vKernelX.size()) / 2;
+		const int radiusY	= static_cast<int>(m_vKernelY.size()) / 2;
+		
+		DGM_ASSERT_MSG(src.rows == width * height, "The number of nodes (%d) does not correspond to the graph size %d x %d", src.rows, width, height);
+		DGM_ASSERT(src.type() == CV_32FC1);
+		
+		// Horizontal pass: tmp = src * kernelX
+		m_tmp.create(src.size(), CV_32FC1);
+		m_tmp.setTo(0);
+#ifdef ENABLE_PARALLEL
+		parallel::parallel_for(0, height, [&](int y) {
+#else
+		for (int y = 0; y < height; y++) {
+#endif
+			const float *pSrc = src.ptr<float>(y * width);
+			float		*pTmp = m_tmp.ptr<float>(y * width);
+			for (int k = -radiusX; k <= radiusX; k++) {
+				const int x0 = MAX(0, -k);							// first x with valid x + k
+				const int x1 = MIN(width, width - k);				// last x with valid x + k
+				if (x1 > x0) simd::axpy(pTmp + x0 * nStates, pSrc + (x0 + k) * nStates, m_vKernelX[radiusX + k], (x1 - x0) * nStates);
+			}
+		}
+#ifdef ENABLE_PARALLEL
+		);
+#endif
+
+		// Vertical pass: dst = tmp * kernelY
+		dst.create(src.size(), CV_32FC1);
+		const size_t rowSize = static_cast<size_t>(width) * nStates;
+#ifdef ENABLE_PARALLEL
+		parallel::parallel_for(0, height, [&](int y) {
+#else
+		for (int y = 0; y < height; y++) {
+#endif
+			float *pDst = dst.ptr<float>(y * width);
+			std::fill(pDst, pDst + rowSize, 0.0f);
+			for (int k = MAX(-radiusY, -y); k <= MIN(radiusY, height - 1 - y); k++)
+				simd::axpy(pDst, m_tmp.ptr<float>((y + k) * width), m_vKernelY[radiusY + k], rowSize);
+		}
+#ifdef ENABLE_PARALLEL
+		);
+#endif
+	}
+}
@@ -0,0 +1,53 @@
+// Gaussian Edge Model class interface
+#pragma once
+
+#include "IEdgeModel.h"
+
+namespace DirectGraphicalModels {
+	// ================================ Gaussian Edge Model ================================
+	/**
+	* @brief Gaussian %Edge Model for dense graphical models on 2D grids
+	* @details This class implements the Potts edge potential model with the purely spatial Gaussian kernel. It is equivalent to 
+	* @ref CEdgeModelPotts with the features \f$(x / \sigma_x, y / \sigma_y)\f$, but instead of the permutohedral lattice it 
+	* filters the node potentials directly on the image grid with the separable Gaussian filter, which is both cheaper and exact.
+	* The nodes must be ordered as the pixels of the image of size \b size, \a i.e. node = y * width + x.
+	* @ingroup moduleGraph
+	*/
+	class CEdgeModelGaussian : public IEdgeModel {
+	public:
+		/**
+		* @brief Constructor
+		* @param size The size of the 2D graph
+		* @param sigma The spatial standard deviation of the 2D-Gaussian filter in pixels
+		* @param weight The weighting parameter (default value is 1)
+		* @param semiMetricFunction Reference to a semi-metric function, which arguments \b src and \b dst are: Mat(size: 1 x nFeatures; type: CV_32FC1). 
+		* For more details refere to @ref CEdgeModelPotts.
+		* @param perPixelNormalization Flag indicating whether er-pixel normalization should be used during applying the edge model.
+		*/
+		DllExport CEdgeModelGaussian(Size size, Vec2f sigma, float weight = 1.0f, const std::function<void(const Mat& src, Mat& dst)>& semiMetricFunction = {}, bool perPixelNormalization = true);
+		DllExport virtual ~CEdgeModelGaussian(void) = default;
+
+		DllExport void apply(const Mat &src, Mat &dst) const override;
+		DllExport void applyLog(const Mat &src, Mat &dst) const override;
+
+
+	private:
+		/**
+		* @brief Filters the node potentials with the separable Gaussian filter
+		* @param[in] src The node potentials: Mat(size: nNodes x nStates; type: CV_32FC1)
+		* @param[out] dst The filtered node potentials: Mat(size: nNodes x nStates; type: CV_32FC1)
+		*/
+		void filter(const Mat &src, Mat &dst) const;
+
+
+	private:
+		Size											m_size;			///< Size of the 2D graph
+		vec_float_t										m_vKernelX;		///< Horizontal Gaussian kernel of size 2 * radius + 1
+		vec_float_t										m_vKernelY;		///< Vertical Gaussian kernel of size 2 * radius + 1
+		float											m_weight;		///< The weighting parameter
+		Mat												m_norm;			///< Array with normalization factors
+		std::function<void(const Mat &src, Mat &dst)>	m_function;		///< The semi-metric function
+		mutable Mat										m_tmp;			///< Scratch container for the horizontal pass
+		mutable Mat										m_res;			///< Scratch container for the output of applyLog()
+	};
+}
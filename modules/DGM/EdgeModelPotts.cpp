@@ -1,5 +1,6 @@
 #include "EdgeModelPotts.h"
 #include "permutohedral/permutohedral.h"
+#include "parallel.h"
 
 namespace DirectGraphicalModels {
 	// Constructor
@@ -11,8 +12,24 @@ namespace DirectGraphicalModels {
 		, m_function(semiMetricFunction)
 	{
 		m_pLattice->init(features);
+		calculateNormalization(perPixelNormalization);
+	}
 
-		// Compute the normalization factor
+	// Constructor
+	CEdgeModelPotts::CEdgeModelPotts(int nNodes, int nFeatures, const std::function<void(int n, float *pFeature)>& featureGenerator, float weight, const std::function<void(const Mat& src, Mat& dst)>& semiMetricFunction, bool perPixelNormalization)
+		: IEdgeModel()
+		, m_pLattice(new CPermutohedral())
+		, m_weight(weight)
+		, m_norm(nNodes, 1, CV_32FC1, Scalar(1))
+		, m_function(semiMetricFunction)
+	{
+		m_pLattice->init(nNodes, nFeatures, featureGenerator);
+		calculateNormalization(perPixelNormalization);
+	}
+
+	// Compute the normalization factor
+	void CEdgeModelPotts::calculateNormalization(bool perPixelNormalization)
+	{
 		m_pLattice->compute(m_norm, m_norm);
 		
 		if (perPixelNormalization)
@@ -36,8 +53,8 @@ namespace DirectGraphicalModels {
 	{
 		m_pLattice->compute(src, dst);				// dst = Lattice.compute(src)
 
-#ifdef ENABLE_PPL
-		concurrency::parallel_for(0, dst.rows, [&](int n) {
+#ifdef ENABLE_PARALLEL
+		parallel::parallel_for(0, dst.rows, [&](int n) {
 #else
 		for (int n = 0; n < dst.rows; n++) {	// nodes
 #endif
@@ -49,10 +66,33 @@ namespace DirectGraphicalModels {
 			float	k = m_weight * m_norm.at<float>(n, 0);
 			for (int s = 0; s < dst.cols; s++) pDst[s] *= k;
 		}
-#ifdef ENABLE_PPL
+#ifdef ENABLE_PARALLEL
 		);
 #endif
 		exp(dst, dst);
 	}
 
+	// dst += w * norm * f(Lattice.compute(src))
+	void CEdgeModelPotts::applyLog(const Mat &src, Mat &dst) const
+	{
+		m_tmp.create(src.size(), CV_32FC1);
+		m_pLattice->compute(src, m_tmp);			// tmp = Lattice.compute(src)
+
+#ifdef ENABLE_PARALLEL
+		parallel::parallel_for(0, dst.rows, [&](int n) {
+#else
+		for (int n = 0; n < dst.rows; n++) {	// nodes
+#endif
+			if (m_function) m_function(m_tmp.row(n), lvalue_cast(m_tmp.row(n)));	// With the SemiMetric function
+
+			const float	*pTmp	= m_tmp.ptr<float>(n);
+			float		*pDst	= dst.ptr<float>(n);
+			float		k		= m_weight * m_norm.at<float>(n, 0);
+			for (int s = 0; s < dst.cols; s++) pDst[s] += k * pTmp[s];
+		}
+#ifdef ENABLE_PARALLEL
+		);
+#endif
+	}
+
 }
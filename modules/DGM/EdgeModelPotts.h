@@ -30,15 +30,37 @@ namespace DirectGraphicalModels {
 		* @param perPixelNormalization Flag indicating whether er-pixel normalization should be used during applying the edge model.
 		*/
 		DllExport CEdgeModelPotts(const Mat& features, float weight = 1.0f, const std::function<void(const Mat& src, Mat& dst)>& semiMetricFunction = {}, bool perPixelNormalization = true);
+		/**
+		* @brief Constructor
+		* @details This constructor does not need the matrix with all features: the features are generated on the fly, while the model is being built.
+		* @param nNodes The number of nodes of the dense graphical model
+		* @param nFeatures The number of features per node
+		* @param featureGenerator Reference to a function, which writes \b nFeatures features of the node \b n into the array \b pFeature. 
+		* This function is called concurrently from multiple threads.
+		* @param weight The weighting parameter (default value is 1)
+		* @param semiMetricFunction Reference to a semi-metric function, which arguments \b src and \b dst are: Mat(size: 1 x nFeatures; type: CV_32FC1). 
+		* @param perPixelNormalization Flag indicating whether er-pixel normalization should be used during applying the edge model.
+		*/
+		DllExport CEdgeModelPotts(int nNodes, int nFeatures, const std::function<void(int n, float *pFeature)>& featureGenerator, float weight = 1.0f, const std::function<void(const Mat& src, Mat& dst)>& semiMetricFunction = {}, bool perPixelNormalization = true);
 		DllExport virtual ~CEdgeModelPotts(void);
 	
 		DllExport void apply(const Mat &src, Mat &dst) const override;
+		DllExport void applyLog(const Mat &src, Mat &dst) const override;
 	
 
-	private:
+	protected:
+		/**
+		* @brief Calculates the normalization factors with the built lattice
+		* @param perPixelNormalization Flag indicating whether er-pixel normalization should be used
+		*/
+		void calculateNormalization(bool perPixelNormalization);
+
+
+	protected:
 		CPermutohedral								  * m_pLattice;		///< Pointer to the permutohedral lattice
 		float											m_weight;		///< The weighting parameter
 		Mat												m_norm;			///< Array with normalization factors
 		std::function<void(const Mat &src, Mat &dst)>	m_function;		///< The semi-metric function
+		mutable Mat										m_tmp;			///< Scratch container for the lattice output of applyLog()
 	};
 }
\ No newline at end of file
@@ -1,4 +1,5 @@
 #include "Graph.h"
+#include "parallel.h"
 #include "macroses.h"
 
 namespace DirectGraphicalModels 
@@ -12,12 +13,12 @@ namespace DirectGraphicalModels
 		// Assertions
 		DGM_ASSERT_MSG(start_node + pots.rows <= getNumNodes(), "The given ranges exceed the number of nodes(%zu)", getNumNodes());
 
-#ifdef ENABLE_PPL
+#ifdef ENABLE_PARALLEL
 		int size = pots.rows;
-		int rangeSize = size / (concurrency::GetProcessorCount() * 10);
+		int rangeSize = size / static_cast<int>(parallel::getNumThreads() * 10);
 		rangeSize = MAX(1, rangeSize);
-		//printf("Processors: %d\n", concurrency::GetProcessorCount());
-		concurrency::parallel_for(0, size, rangeSize, [start_node, size, rangeSize, &pots, this](int i) {
+		//printf("Threads: %zu\n", parallel::getNumThreads());
+		parallel::parallel_for(0, size, rangeSize, [start_node, size, rangeSize, &pots, this](int i) {
 			for (int j = 0; (j < rangeSize) && (i + j < size); j++)
 				setNode(start_node + i + j, pots.row(i + j).t());
 		});
@@ -38,12 +39,12 @@ namespace DirectGraphicalModels
 		
 		transpose(pots, pots);
 
-#ifdef ENABLE_PPL
+#ifdef ENABLE_PARALLEL
 		int size = pots.cols;
-		int rangeSize = size / (concurrency::GetProcessorCount() * 10);
+		int rangeSize = size / static_cast<int>(parallel::getNumThreads() * 10);
 		rangeSize = MAX(1, rangeSize);
-		//printf("Processors: %d\n", concurrency::GetProcessorCount());
-		concurrency::parallel_for(0, size, rangeSize, [start_node, size, rangeSize, &pots, this](int i) {
+		//printf("Threads: %zu\n", parallel::getNumThreads());
+		parallel::parallel_for(0, size, rangeSize, [start_node, size, rangeSize, &pots, this](int i) {
 			Mat pot;
 			for (int j = 0; (j  < rangeSize) && (i + j < size); j++)
 				getNode(start_node + i + j, lvalue_cast(pots.col(i + j)));
@@ -50,7 +50,7 @@ namespace DirectGraphicalModels {
 		/**
         * @brief Fills the graph nodes with new potentials
         * @details
-        * > This function supports PPL
+        * > This function supports parallel computing
 		* @param start_node The index of the node, starting from which the potentials should be set
 		* @param pots A block of potentials: Mat(size: nNodes x nStates; type: CV_32FC1)
 		*/
@@ -64,7 +64,7 @@ namespace DirectGraphicalModels {
 		/**
 		* @brief Returns the node potentials
         * @details
-        * > This function supports PPL
+        * > This function supports parallel computing
 		* @param[in] start_node The index of the node, starting from which the potentials should be got
 		* @param[in] num_nodes The number of nodes potentials to acquire. \b 0 means - read nodes from \b start_node till the last one.
 		* @param[out] pots A block of potentials: Mat(size: num_nodes x nStates; type: CV_32FC1)
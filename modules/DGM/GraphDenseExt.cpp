@@ -1,6 +1,7 @@
 #include "GraphDenseExt.h"
 #include "GraphDense.h"
 #include "EdgeModelPotts.h"
+#include "EdgeModelGaussian.h"
 #include "macroses.h"
 
 namespace DirectGraphicalModels 
@@ -29,19 +30,18 @@ namespace DirectGraphicalModels
         }
 	}
 
-	void CGraphDenseExt::addGaussianEdgeModel(Vec2f sigma, float weight, const std::function<void(const Mat& src, Mat& dst)> &semiMetricFunction)
+	void CGraphDenseExt::addGaussianEdgeModel(Vec2f sigma, float weight, const std::function<void(const Mat& src, Mat& dst)> &semiMetricFunction, bool separable)
 	{
-		Mat features;
-		Mat feature(1, 2, CV_32FC1);
-		float *pFeature = feature.ptr<float>(0);
-		for (int y = 0; y < m_size.height; y++) 
-			for (int x = 0; x < m_size.width; x++) {
-				pFeature[0] = x / sigma.val[0];
-				pFeature[1] = y / sigma.val[1];
-				features.push_back(feature);
-			} // x
+		if (separable) {
+			m_graph.addEdgeModel(std::make_shared<CEdgeModelGaussian>(m_size, sigma, weight, semiMetricFunction));
+			return;
+		}
 
-		m_graph.addEdgeModel(std::make_shared<CEdgeModelPotts>(features, weight, semiMetricFunction));
+		const int	width	= m_size.width;
+		m_graph.addEdgeModel(std::make_shared<CEdgeModelPotts>(m_size.width * m_size.height, 2, [=](int n, float *pFeature) {
+			pFeature[0] = (n % width) / sigma.val[0];
+			pFeature[1] = (n / width) / sigma.val[1];
+		}, weight, semiMetricFunction));
 	}
 
 	void CGraphDenseExt::addBilateralEdgeModel(const Mat &featureVectors, Vec2f sigma, float sigma_opt, float weight, const std::function<void(const Mat& src, Mat& dst)> &semiMetricFunction)
@@ -49,20 +49,16 @@ namespace DirectGraphicalModels
         const word	nFeatures = featureVectors.channels();
         
         DGM_ASSERT_MSG(featureVectors.size() == m_size, "Resilution of the train image does not equal to the graph size");
-        Mat features; 
-        Mat feature(1, 2 + nFeatures, CV_32FC1);
-        float *pFeature = feature.ptr<float>(0);
-        for (int y = 0; y < m_size.height; y++) {
-			const byte *pFv = featureVectors.ptr<byte>(y);
-			for (int x = 0; x < m_size.width; x++) {
-				pFeature[0] = x / sigma.val[0];
-				pFeature[1] = y / sigma.val[1];
-                for (word f = 0; f < nFeatures; f++)
-                    pFeature[2 + f] = pFv[nFeatures * x + f] / sigma_opt;
-                features.push_back(feature);
-			} // x
-		} // y
-		m_graph.addEdgeModel(std::make_shared<CEdgeModelPotts>(features, weight, semiMetricFunction));
+		const int	width	= m_size.width;
+		m_graph.addEdgeModel(std::make_shared<CEdgeModelPotts>(m_size.width * m_size.height, 2 + nFeatures, [&, width, nFeatures](int n, float *pFeature) {
+			const int	x	= n % width;
+			const int	y	= n / width;
+			const byte	*pFv = featureVectors.ptr<byte>(y);
+			pFeature[0] = x / sigma.val[0];
+			pFeature[1] = y / sigma.val[1];
+			for (word f = 0; f < nFeatures; f++)
+				pFeature[2 + f] = pFv[nFeatures * x + f] / sigma_opt;
+		}, weight, semiMetricFunction));
 	}
 
     void CGraphDenseExt::addBilateralEdgeModel(const vec_mat_t &featureVectors, Vec2f sigma, float sigma_opt, float weight, const std::function<void(const Mat& src, Mat& dst)> &semiMetricFunction)
@@ -71,20 +67,14 @@ namespace DirectGraphicalModels
         
         DGM_ASSERT_MSG(!featureVectors.empty(), "The train image is empty");
         DGM_ASSERT_MSG(featureVectors[0].size() == m_size, "Resilution of the train image does not equal to the graph size");
-        Mat features;
-        Mat feature(1, 2 + nFeatures, CV_32FC1);
-        float *pFeature = feature.ptr<float>(0);
-        for (int y = 0; y < m_size.height; y++) {
-            byte const **pFv = new const byte *[nFeatures];
-            for (word f = 0; f < nFeatures; f++) pFv[f] = featureVectors[f].ptr<byte>(y);
-            for (int x = 0; x < m_size.width; x++) {
-                pFeature[0] = x / sigma.val[0];
-                pFeature[1] = y / sigma.val[1];
-                for (int f = 0; f < nFeatures; f++)
-                    pFeature[2 + f] = pFv[f][x] / sigma_opt;
-                features.push_back(feature);
-            } // x
-        } // y
-        m_graph.addEdgeModel(std::make_shared<CEdgeModelPotts>(features, weight, semiMetricFunction));
+		const int	width	= m_size.width;
+		m_graph.addEdgeModel(std::make_shared<CEdgeModelPotts>(m_size.width * m_size.height, 2 + nFeatures, [&, width, nFeatures](int n, float *pFeature) {
+			const int	x	= n % width;
+			const int	y	= n / width;
+			pFeature[0] = x / sigma.val[0];
+			pFeature[1] = y / sigma.val[1];
+			for (word f = 0; f < nFeatures; f++)
+				pFeature[2 + f] = featureVectors[f].ptr<byte>(y)[x] / sigma_opt;
+		}, weight, semiMetricFunction));
     }
 }
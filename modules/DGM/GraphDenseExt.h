@@ -68,8 +68,10 @@ namespace DirectGraphicalModels
 		* @param weight The weighting parameter
 		* @param semiMetricFunction Reference to a semi-metric function, which arguments \b src and \b dst are: Mat(size: 1 x nFeatures; type: CV_32FC1). 
 		* For more details refere to @ref CEdgeModelPotts.
+		* @param separable Flag indicating whether the separable Gaussian filter on the image grid (ref. @ref CEdgeModelGaussian) should be used 
+		* instead of the 2D permutohedral lattice. It is faster for small \b sigma and computes the exact Gaussian filter.
 		*/
-        DllExport void addGaussianEdgeModel(Vec2f sigma, float weight = 1.0f, const std::function<void(const Mat& src, Mat& dst)>& semiMetricFunction = {});
+        DllExport void addGaussianEdgeModel(Vec2f sigma, float weight = 1.0f, const std::function<void(const Mat& src, Mat& dst)>& semiMetricFunction = {}, bool separable = false);
 		/**
 		* @brief Add a Bilateral pairwise potential with spacial standard deviations \b sigma and color standard deviations sr,sg,sb
 		* @param featureVectors Multi-channel matrix, each element of which is a multi-dimensinal point: Mat(type: CV_8UC<nFeatures>)
@@ -0,0 +1,54 @@
+#include "GraphDenseKit.h"
+#include <mutex>
+#include "parallel.h"
+#include "macroses.h"
+
+namespace DirectGraphicalModels
+{
+	void CGraphDenseKit::inferTiled(Size imageSize, Size tileSize, int halo, unsigned int nIt
+		, const std::function<void(CGraphDenseExt& graphExt, const Rect& roi)>& buildTile
+		, const std::function<void(const Rect& roi, const Mat& pots)>& storeTile) const
+	{
+		DGM_ASSERT_MSG(tileSize.width > 0 && tileSize.height > 0, "The tile size must be positive");
+		DGM_ASSERT_MSG(halo >= 0, "The halo width must not be negative");
+		
+		const byte	nStates		= m_graph.getNumStates();
+		const Rect	image		= Rect(Point(0, 0), imageSize);
+		
+		std::vector<Rect> vTiles;
+		for (int y = 0; y < imageSize.height; y += tileSize.height)
+			for (int x = 0; x < imageSize.width; x += tileSize.width)
+				vTiles.push_back(Rect(Point(x, y), tileSize) & image);
+
+		std::mutex mtx;
+		auto inferTile = [&](size_t t) {
+			const Rect &core	= vTiles[t];
+			const Rect	roi		= Rect(core.x - halo, core.y - halo, core.width + 2 * halo, core.height + 2 * halo) & image;
+			
+			CGraphDense		graph(nStates);
+			CGraphDenseExt	graphExt(graph);
+			CInferDense		infer(graph);
+			infer.setTolerance(m_infer.getTolerance());
+			
+			buildTile(graphExt, roi);
+			DGM_ASSERT_MSG(graph.getNumNodes() == static_cast<size_t>(roi.area()), "The tile graph has %zu nodes, but the tile has %d pixels", graph.getNumNodes(), roi.area());
+			infer.infer(nIt);
+
+			Mat pots = graph.getNodePotentials().reshape(nStates, roi.height);		// Mat(size: roi.size(); type: CV_32FC(nStates))
+			{
+				std::lock_guard<std::mutex> lock(mtx);
+				storeTile(core, pots(Rect(core.tl() - roi.tl(), core.size())));
+			}
+		};
+
+#ifdef ENABLE_PARALLEL
+		// The tiles are processed in waves: the inference of a tile runs parallel loops itself, and a thread waiting for them may pick up another tile 
+		// of the same wave, but not of the whole image, thus the number of the tiles kept in memory is bounded by the wave size
+		const size_t nWave = MAX(size_t(1), parallel::getNumThreads());
+		for (size_t first = 0; first < vTiles.size(); first += nWave)
+			parallel::parallel_for(first, MIN(first + nWave, vTiles.size()), inferTile);
+#else
+		for (size_t t = 0; t < vTiles.size(); t++) inferTile(t);
+#endif
+	}
+}
@@ -32,6 +32,27 @@ namespace DirectGraphicalModels
 		DllExport CInfer&		getInfer() override { return m_infer; }
 		DllExport CGraphExt&	getGraphExt() override { return m_graphExtension; }
 
+		/**
+		* @brief Tiled inference for large images
+		* @details This function splits the image into tiles of size \b tileSize, extends every tile with the overlapping halo region and 
+		* runs the dense inference for every extended tile separately with its own graph. The tiles are processed in parallel in waves of 
+		* parallel::getNumThreads() tiles and only the tiles of one wave are kept in memory, thus the required memory depends on the tile size 
+		* and not on the image size. The marginals of every tile without the halo are passed to \b storeTile, so the tiles may be stitched into the resulting image or streamed to disk.
+		* The graph and the inference object of this kit are not used; the tiles use the same tolerance as getInfer().
+		* @param imageSize The size of the whole image
+		* @param tileSize The size of the tiles without the halo
+		* @param halo The width of the halo region in pixels. It should exceed the range of the spatial edge models, \a e.g. 3 sigma of the Gaussian kernel
+		* @param nIt The number of iterations of the dense inference
+		* @param buildTile Reference to a function, which builds the graph of one tile: \a e.g. reads the potentials and the features of the 
+		* region \b roi of the image and passes them to @ref CGraphDenseExt::setGraph() and to the edge model builders of \b graphExt. 
+		* This function is called concurrently from multiple threads.
+		* @param storeTile Reference to a function, which receives the marginals of the tile \b roi without the halo: 
+		* \b pots = Mat(size: roi.size(); type: CV_32FC(nStates)). The calls of this function are serialized.
+		*/
+		DllExport void inferTiled(Size imageSize, Size tileSize, int halo, unsigned int nIt
+			, const std::function<void(CGraphDenseExt& graphExt, const Rect& roi)>& buildTile
+			, const std::function<void(const Rect& roi, const Mat& pots)>& storeTile) const;
+
 
 	private:
 		CGraphDense		m_graph;			///< Dense (complete) graph
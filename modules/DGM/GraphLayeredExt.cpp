@@ -6,56 +6,121 @@
 #include "TrainEdgePotts.h"
 #include "TrainLink.h"
 #include "TrainEdgePottsCS.h"
+#include "parallel.h"
 #include "macroses.h"
 
 namespace DirectGraphicalModels
 {
+	namespace {
+		// Enumerates the edges of the row of the layered graph: first pass (row < height) - the links and the grid edges, second pass - the diagonal edges.
+		// The pairs of mutually opposite edges are reported with addArc(), the single (inter-layer) edges - with addEdge(). The direction of an arc
+		// is 0 for the links and for the left (up-left) edges, and 1 for the up (up-right) edges
+		template <typename EdgeFn, typename ArcFn>
+		void enumerateRow(Size size, word nLayers, byte gType, int row, EdgeFn &&addEdge, ArcFn &&addArc)
+		{
+			const int	width	= size.width;
+			const int	y		= row % size.height;
+			const bool	diag	= row >= size.height;
+			word l;
+			for (int x = 0; x < width; x++) {
+				size_t idx = (static_cast<size_t>(y) * width + x) * nLayers;
+				if (!diag) {
+					// All links have group_id = 1
+					if (gType & GRAPH_EDGES_LINK) {
+						if (nLayers >= 2)
+							addArc(idx, idx + 1, 1, 0);
+						for (l = 2; l < nLayers; l++)
+							addEdge(idx + l - 1, idx + l, 1);
+					} // if LINK
+
+					if (gType & GRAPH_EDGES_GRID) {
+						if (x > 0)
+							for (l = 0; l < nLayers; l++)
+								addArc(idx + l, idx + l - nLayers, 0, 0);
+						if (y > 0)
+							for (l = 0; l < nLayers; l++)
+								addArc(idx + l, idx + l - nLayers * width, 0, 1);
+					} // if GRID
+				}
+				else if (gType & GRAPH_EDGES_DIAG) {
+					if ((x > 0) && (y > 0))
+						for (l = 0; l < nLayers; l++)
+							addArc(idx + l, idx + l - nLayers * (width + 1), 0, 0);
+
+					if ((x < width - 1) && (y > 0))
+						for (l = 0; l < nLayers; l++)
+							addArc(idx + l, idx + l - nLayers * (width - 1), 0, 1);
+				} // if DIAG
+			} // x
+		}
+	}
+
 	void CGraphLayeredExt::buildGraph(Size graphSize)
 	{
 		if (m_graph.getNumNodes() != 0) m_graph.reset();
 		m_size = graphSize;
+		m_frozenVersion = 0;
+		m_vArcEdges.clear();
+		m_vArcOffsets.clear();
+
+		const int		width	= m_size.width;
+		const int		height	= m_size.height;
+		const size_t	nNodes	= static_cast<size_t>(width) * height * m_nLayers;
+
+		auto processRow = [&](int row, auto &&addEdge) {
+			enumerateRow(m_size, m_nLayers, m_gType, row, addEdge, [&addEdge](size_t node1, size_t node2, byte group, byte) {
+				addEdge(node1, node2, group);
+				addEdge(node2, node1, group);
+			});
+		};
+		
+		CGraphPairwise *pGraph = dynamic_cast<CGraphPairwise *>(&m_graph);
+		if (!pGraph) {																// Generic graph: one edge at a time
+			for (size_t n = 0; n < nNodes; n++) m_graph.addNode();
+			for (int row = 0; row < 2 * height; row++)
+				processRow(row, [&](size_t srcNode, size_t dstNode, byte group) { m_graph.addEdge(srcNode, dstNode, group, Mat()); });
+			return;
+		}
 
-		word l;
-		for (int y = 0; y < m_size.height; y++)
-			for (int x = 0; x < m_size.width; x++) {
-				// Nodes
-				size_t idx = m_graph.addNode();
-				for (l = 1; l < m_nLayers; l++) m_graph.addNode();
-
-				// All links have group_id = 1
-				if (m_gType & GRAPH_EDGES_LINK) {
-					if (m_nLayers >= 2)
-						m_graph.addArc(idx, idx + 1, 1, Mat());
-					for (l = 2; l < m_nLayers; l++)
-						m_graph.addEdge(idx + l - 1, idx + l, 1, Mat());
-				} // if LINK
-
-				if (m_gType & GRAPH_EDGES_GRID) {
-					if (x > 0)
-						for (l = 0; l < m_nLayers; l++)
-							m_graph.addArc(idx + l, idx + l - m_nLayers);
-					if (y > 0)
-						for (l = 0; l < m_nLayers; l++)
-							m_graph.addArc(idx + l, idx + l - m_nLayers * m_size.width);
-				} // if GRID
-			} // x
-
-
-		if (m_gType & GRAPH_EDGES_DIAG) {
-			for (int y = 0; y < m_size.height; y++) {
-				for (int x = 0; x < m_size.width; x++) {
-					size_t idx = (y * m_size.width + x) * m_nLayers;
-
-					if ((x > 0) && (y > 0))
-						for (l = 0; l < m_nLayers; l++)
-							m_graph.addArc(idx + l, idx + l - m_nLayers * (m_size.width + 1));
+		// Pairwise graph: count the edges of every row, then fill all rows in parallel and add the edges at once
+		vec_size_t vOffsets(2 * height + 1, 0);
+#ifdef ENABLE_PARALLEL
+		parallel::parallel_for(0, 2 * height, [&](int row) {
+#else
+		for (int row = 0; row < 2 * height; row++) {
+#endif
+			size_t count = 0;
+			processRow(row, [&count](size_t, size_t, byte) { count++; });
+			vOffsets[row + 1] = count;
+		}
+#ifdef ENABLE_PARALLEL
+		);
+#endif
+		for (int row = 0; row < 2 * height; row++) vOffsets[row + 1] += vOffsets[row];
+
+		const size_t nEdges = vOffsets.back();
+		vec_size_t	vSrcNodes(nEdges);
+		vec_size_t	vDstNodes(nEdges);
+		vec_byte_t	vGroups(nEdges);
+#ifdef ENABLE_PARALLEL
+		parallel::parallel_for(0, 2 * height, [&](int row) {
+#else
+		for (int row = 0; row < 2 * height; row++) {
+#endif
+			size_t e = vOffsets[row];
+			processRow(row, [&](size_t srcNode, size_t dstNode, byte group) {
+				vSrcNodes[e]	= srcNode;
+				vDstNodes[e]	= dstNode;
+				vGroups[e]		= group;
+				e++;
+			});
+		}
+#ifdef ENABLE_PARALLEL
+		);
+#endif
 
-					if ((x < graphSize.width - 1) && (y > 0))
-						for (l = 0; l < m_nLayers; l++)
-							m_graph.addArc(idx + l, idx + l - m_nLayers * (m_size.width - 1));
-				} // x
-			} // y
-		} // if DIAG
+		pGraph->addNodes(nNodes);
+		pGraph->addEdges(vSrcNodes, vDstNodes, vGroups);
 	}
 
 	void CGraphLayeredExt::setGraph(const Mat& pots) 
@@ -109,8 +174,36 @@ namespace DirectGraphicalModels
 		if (m_nLayers >= 2) DGM_ASSERT(nStatesOccl);
 		DGM_ASSERT(nStatesBase + nStatesOccl == m_graph.getNumStates());
 
-#ifdef ENABLE_PPL
-		concurrency::parallel_for(0, m_size.height, [&, nStatesBase, nStatesOccl](int y) {
+		CGraphPairwise *pGraph = dynamic_cast<CGraphPairwise *>(&m_graph);
+		if (pGraph) {																// Pairwise graph: write the potentials directly into the node storage
+			const byte nStates = m_graph.getNumStates();
+#ifdef ENABLE_PARALLEL
+			parallel::parallel_for(0, m_size.height, [&, nStatesBase, nStatesOccl](int y) {
+#else
+			for (int y = 0; y < m_size.height; y++) {
+#endif
+				const float *pPotBase = potBase.ptr<float>(y);
+				const float *pPotOccl = potOccl.empty() ? NULL : potOccl.ptr<float>(y);
+				for (int x = 0; x < m_size.width; x++) {
+					size_t idx = (y * m_size.width + x) * m_nLayers;
+					for (word l = 0; l < m_nLayers; l++) {
+						float *pPot = pGraph->getNodePot(idx + l);
+						std::fill(pPot, pPot + nStates, 0.0f);
+						if (l == 0)			std::copy(pPotBase + nStatesBase * x, pPotBase + nStatesBase * (x + 1), pPot);
+						else if (l == 1)	std::copy(pPotOccl + nStatesOccl * x, pPotOccl + nStatesOccl * (x + 1), pPot + nStatesBase);
+						else				std::fill(pPot + nStatesBase, pPot + nStates, 100.0f / nStatesOccl);
+						pGraph->m_vNodeIsSet[idx + l] = true;
+					}
+				} // x
+			} // y
+#ifdef ENABLE_PARALLEL
+			);
+#endif
+			return;
+		}
+
+#ifdef ENABLE_PARALLEL
+		parallel::parallel_for(0, m_size.height, [&, nStatesBase, nStatesOccl](int y) {
 			Mat nPotBase(m_graph.getNumStates(), 1, CV_32FC1, Scalar(0.0f));
 			Mat nPotOccl(m_graph.getNumStates(), 1, CV_32FC1, Scalar(0.0f));
 			Mat nPotIntr(m_graph.getNumStates(), 1, CV_32FC1, Scalar(0.0f));
@@ -143,7 +236,7 @@ namespace DirectGraphicalModels
 					m_graph.setNode(idx + l, nPotIntr);
 			} // x
 		} // y
-#ifdef ENABLE_PPL	
+#ifdef ENABLE_PARALLEL	
 		);
 #endif
 	}
@@ -252,168 +345,89 @@ namespace DirectGraphicalModels
 
 	void CGraphLayeredExt::fillEdges(const CTrainEdge& edgeTrainer, const CTrainLink* linkTrainer, const Mat& featureVectors, const vec_float_t& vParams, float edgeWeight, float linkWeight)
 	{
+		const byte	nStates		= m_graph.getNumStates();
 		const word	nFeatures	= featureVectors.channels();
+		const int	width		= m_size.width;
 
 		// Assertions
 		DGM_ASSERT(m_size.height == featureVectors.rows);
 		DGM_ASSERT(m_size.width == featureVectors.cols);
+		DGM_ASSERT(CV_8U == featureVectors.depth());
 		DGM_ASSERT(nFeatures == edgeTrainer.getNumFeatures());
 		if (linkTrainer) DGM_ASSERT(nFeatures == linkTrainer->getNumFeatures());
+		if ((m_gType & GRAPH_EDGES_LINK) && (m_nLayers >= 2)) DGM_ASSERT_MSG(linkTrainer, "The link trainer is required for the links");
 		DGM_ASSERT(m_size.width * m_size.height * m_nLayers == m_graph.getNumNodes());
 
-#ifdef ENABLE_PPL
-		concurrency::parallel_for(0, m_size.height, [&, nFeatures](int y) {
-			Mat featureVector1(nFeatures, 1, CV_8UC1);
-			Mat featureVector2(nFeatures, 1, CV_8UC1);
-			Mat ePot;
-			word l;
-#else 
-		Mat featureVector1(nFeatures, 1, CV_8UC1);
-		Mat featureVector2(nFeatures, 1, CV_8UC1);
-		Mat ePot;
-		word l;
-		for (int y = 0; y < m_size.height; y++) {
-#endif
-			const byte *pFv1 = featureVectors.ptr<byte>(y);
-			const byte *pFv2 = (y > 0) ? featureVectors.ptr<byte>(y - 1) : NULL;
-			for (int x = 0; x < m_size.width; x++) {
-				size_t idx = (y * m_size.width + x) * m_nLayers;
-				for (word f = 0; f < nFeatures; f++) featureVector1.at<byte>(f, 0) = pFv1[nFeatures * x + f];				// featureVectors[x][y]
-				
-				if (m_gType & GRAPH_EDGES_LINK) {
-					ePot = linkTrainer->getLinkPotentials(featureVector1, linkWeight);
-					add(ePot, ePot.t(), ePot);
-					if (m_nLayers >= 2)
-						m_graph.setArc(idx, idx + 1, ePot);
-					ePot = CTrainEdge::getDefaultEdgePotentials(100, m_graph.getNumStates());
-					for (l = 2; l < m_nLayers; l++)
-						m_graph.setEdge(idx + l - 1, idx + l, ePot);
-				} // edges_link
-
-				if (m_gType & GRAPH_EDGES_GRID) {
-					if (x > 0) {
-						for (word f = 0; f < nFeatures; f++) featureVector2.at<byte>(f, 0) = pFv1[nFeatures * (x - 1) + f];	// featureVectors[x-1][y]
-						ePot = edgeTrainer.getEdgePotentials(featureVector1, featureVector2, vParams, edgeWeight);
-						for (word l = 0; l < m_nLayers; l++) m_graph.setArc(idx + l, idx + l - m_nLayers, ePot);
-					} // if x
-
-					if (y > 0) {
-						for (word f = 0; f < nFeatures; f++) featureVector2.at<byte>(f, 0) = pFv2[nFeatures * x + f];		// featureVectors[x][y-1]
-						ePot = edgeTrainer.getEdgePotentials(featureVector1, featureVector2, vParams, edgeWeight);
-						for (word l = 0; l < m_nLayers; l++) m_graph.setArc(idx + l, idx + l - m_nLayers * m_size.width, ePot);
-					} // if y
-				} // edges_grid
-
-				if (m_gType & GRAPH_EDGES_DIAG) {
-					if ((x > 0) && (y > 0)) {
-						for (word f = 0; f < nFeatures; f++) featureVector2.at<byte>(f, 0) = pFv2[nFeatures * (x - 1) + f];	// featureVectors[x-1][y-1]
-						ePot = edgeTrainer.getEdgePotentials(featureVector1, featureVector2, vParams, edgeWeight);
-						for (word l = 0; l < m_nLayers; l++) m_graph.setArc(idx + l, idx + l - m_nLayers * m_size.width - m_nLayers, ePot);
-					} // if x, y
-
-					if ((x < m_size.width - 1) && (y > 0)) {
-						for (word f = 0; f < nFeatures; f++) featureVector2.at<byte>(f, 0) = pFv2[nFeatures * (x + 1) + f];	// featureVectors[x+1][y-1]
-						ePot = edgeTrainer.getEdgePotentials(featureVector1, featureVector2, vParams, edgeWeight);
-						for (word l = 0; l < m_nLayers; l++) m_graph.setArc(idx + l, idx + l - m_nLayers * m_size.width + m_nLayers, ePot);
-					} // x, y
-				} // edges_diag
-			} // x
-#ifdef ENABLE_PPL
-		}); // y
-#else
-		} // y
-#endif
-	}
+		CGraphPairwise *pGraph = dynamic_cast<CGraphPairwise *>(&m_graph);
+		if (pGraph) {
+			if (!isTopologyFrozen()) freezeTopology();
+			pGraph->allocateEdgePots();
+		}
 
-	void CGraphLayeredExt::fillEdges(const CTrainEdge& edgeTrainer, const CTrainLink* linkTrainer, const vec_mat_t& featureVectors, const vec_float_t& vParams, float edgeWeight, float linkWeight)
-	{
-		const word	nFeatures	=static_cast<word>(featureVectors.size());
+		const Mat intrPot = CTrainEdge::getDefaultEdgePotentials(100, nStates);
 
-		// Assertions
-		DGM_ASSERT(m_size.height == featureVectors[0].rows);
-		DGM_ASSERT(m_size.width == featureVectors[0].cols);
-		DGM_ASSERT(nFeatures == edgeTrainer.getNumFeatures());
-		if (linkTrainer) DGM_ASSERT(nFeatures == linkTrainer->getNumFeatures());
-		DGM_ASSERT(m_size.width * m_size.height * m_nLayers == m_graph.getNumNodes());
-
-#ifdef ENABLE_PPL
-		concurrency::parallel_for(0, m_size.height, [&, nFeatures](int y) {
-			Mat featureVector1(nFeatures, 1, CV_8UC1);
-			Mat featureVector2(nFeatures, 1, CV_8UC1);
-			Mat ePot;
-			word l;
+		// Every row of the graph (Ref. enumerateRow()) is processed at once: the potentials of two edge directions are calculated 
+		// for the whole image row - left and up for the grid edges, up-left and up-right for the diagonal edges
+#ifdef ENABLE_PARALLEL
+		parallel::parallel_for(0, 2 * m_size.height, [&](int row) {
 #else 
-		Mat featureVector1(nFeatures, 1, CV_8UC1);
-		Mat featureVector2(nFeatures, 1, CV_8UC1);
-		Mat ePot;
-		word l;
-		for (int y = 0; y < m_size.height; y++) {
+		for (int row = 0; row < 2 * m_size.height; row++) {
 #endif
-			byte const **pFv1 = new const byte * [nFeatures];
-			for (word f = 0; f < nFeatures; f++) pFv1[f] = featureVectors[f].ptr<byte>(y);
-			byte const **pFv2 = NULL;
-			if (y > 0) {
-				pFv2 = new const byte *[nFeatures];
-				for (word f = 0; f < nFeatures; f++) pFv2[f] = featureVectors[f].ptr<byte>(y-1);
+			const int	y		= row % m_size.height;
+			const bool	diag	= row >= m_size.height;
+			const byte *pFv1	= featureVectors.ptr<byte>(y);
+			const byte *pFv2	= (y > 0) ? featureVectors.ptr<byte>(y - 1) : NULL;
+			const size_t potSize = nStates * nStates;
+
+			vec_float_t vPots((diag ? (m_gType & GRAPH_EDGES_DIAG) : (m_gType & GRAPH_EDGES_GRID)) ? 2 * width * potSize : 0);
+			float *pPots[2] = { vPots.data(), vPots.data() + width * potSize };			// the potentials of the edges, starting at pixel x
+			if (!diag && (m_gType & GRAPH_EDGES_GRID)) {
+				edgeTrainer.getEdgePotentials(pFv1 + nFeatures, pFv1, width - 1, vParams, edgeWeight, pPots[0] + potSize);		// [x][y] - [x-1][y]
+				if (y > 0) edgeTrainer.getEdgePotentials(pFv1, pFv2, width, vParams, edgeWeight, pPots[1]);						// [x][y] - [x][y-1]
+			}
+			if (diag && (m_gType & GRAPH_EDGES_DIAG) && (y > 0)) {
+				edgeTrainer.getEdgePotentials(pFv1 + nFeatures, pFv2, width - 1, vParams, edgeWeight, pPots[0] + potSize);		// [x][y] - [x-1][y-1]
+				edgeTrainer.getEdgePotentials(pFv1, pFv2 + nFeatures, width - 1, vParams, edgeWeight, pPots[1]);				// [x][y] - [x+1][y-1]
 			}
-			
-			for (int x = 0; x < m_size.width; x++) {
-				size_t idx = (y * m_size.width + x) * m_nLayers;
-				
-				for (word f = 0; f < nFeatures; f++) featureVector1.at<byte>(f, 0) = pFv1[f][x];				// featureVectors[x][y]
 
-				if (m_gType & GRAPH_EDGES_LINK) {
-					ePot = linkTrainer->getLinkPotentials(featureVector1, linkWeight);
+			size_t a = pGraph ? m_vArcOffsets[row] : 0;
+			Mat ePot;
+			enumerateRow(m_size, m_nLayers, m_gType, row, [&](size_t node1, size_t node2, byte) {
+				m_graph.setEdge(node1, node2, intrPot);
+			}, [&](size_t node1, size_t node2, byte, byte dir) {
+				const int x = static_cast<int>((node1 / m_nLayers) % width);
+				const float *pPot;
+				if (node2 == node1 + 1) {														// link
+					ePot = linkTrainer->getLinkPotentials(Mat(nFeatures, 1, CV_8UC1, const_cast<byte *>(pFv1 + nFeatures * x)), linkWeight);
 					add(ePot, ePot.t(), ePot);
-					if (m_nLayers >= 2)
-						m_graph.setArc(idx, idx + 1, ePot);
-					ePot = CTrainEdge::getDefaultEdgePotentials(100, m_graph.getNumStates());
-					for (l = 2; l < m_nLayers; l++)
-						m_graph.setEdge(idx + l - 1, idx + l, ePot);
-				} // edges_link
-
-				if (m_gType & GRAPH_EDGES_GRID) {
-					if (x > 0) {
-						for (word f = 0; f < nFeatures; f++) featureVector2.at<byte>(f, 0) = pFv1[f][x - 1];				// featureVectors[x-1][y]
-						ePot = edgeTrainer.getEdgePotentials(featureVector1, featureVector2, vParams, edgeWeight);
-						for (word l = 0; l < m_nLayers; l++) m_graph.setArc(idx + l, idx + l - m_nLayers, ePot);
-					} // if x
-
-					if (y > 0) {
-						for (word f = 0; f < nFeatures; f++) featureVector2.at<byte>(f, 0) = pFv2[f][x];					// featureVectors[x][y-1]
-						ePot = edgeTrainer.getEdgePotentials(featureVector1, featureVector2, vParams, edgeWeight);
-						for (word l = 0; l < m_nLayers; l++) m_graph.setArc(idx + l, idx + l - m_nLayers * m_size.width, ePot);
-					} // if y
-				} // edges_grid
-
-				if (m_gType & GRAPH_EDGES_DIAG) {
-					if ((x > 0) && (y > 0)) {
-						for (word f = 0; f < nFeatures; f++) featureVector2.at<byte>(f, 0) = pFv2[f][x - 1];				// featureVectors[x-1][y-1]
-						ePot = edgeTrainer.getEdgePotentials(featureVector1, featureVector2, vParams, edgeWeight);
-						for (word l = 0; l < m_nLayers; l++) m_graph.setArc(idx + l, idx + l - m_nLayers * m_size.width - m_nLayers, ePot);
-					} // if x, y
-
-					if ((x < m_size.width - 1) && (y > 0)) {
-						for (word f = 0; f < nFeatures; f++) featureVector2.at<byte>(f, 0) = pFv2[f][x + 1];				// featureVectors[x+1][y-1]
-						ePot = edgeTrainer.getEdgePotentials(featureVector1, featureVector2, vParams, edgeWeight);
-						for (word l = 0; l < m_nLayers; l++) m_graph.setArc(idx + l, idx + l - m_nLayers * m_size.width + m_nLayers, ePot);
-					} // x, y
-				} // edges_diag
-			} // x
-#ifdef ENABLE_PPL
-		}); // y
-#else
-		} // y
+					pPot = ePot.ptr<float>();
+				}
+				else pPot = pPots[dir] + x * potSize;
+				if (pGraph) pGraph->setArcPot(m_vArcEdges[2 * a], m_vArcEdges[2 * a + 1], pPot);
+				else		m_graph.setArc(node1, node2, Mat(nStates, nStates, CV_32FC1, const_cast<float *>(pPot)));
+				a++;
+			});
+		}
+#ifdef ENABLE_PARALLEL
+		);
 #endif
 	}
 
+	void CGraphLayeredExt::fillEdges(const CTrainEdge& edgeTrainer, const CTrainLink* linkTrainer, const vec_mat_t& featureVectors, const vec_float_t& vParams, float edgeWeight, float linkWeight)
+	{
+		DGM_ASSERT(!featureVectors.empty());
+		Mat fv;
+		merge(featureVectors, fv);
+		fillEdges(edgeTrainer, linkTrainer, fv, vParams, edgeWeight, linkWeight);
+	}
+
 	void CGraphLayeredExt::defineEdgeGroup(float A, float B, float C, byte group)
 	{
 		// Assertion
 		DGM_ASSERT_MSG(A != 0 || B != 0, "Wrong arguments");
 
-#ifdef ENABLE_PPL
-		concurrency::parallel_for(0, m_size.height, [&](int y) {
+#ifdef ENABLE_PARALLEL
+		parallel::parallel_for(0, m_size.height, [&](int y) {
 #else
 		for (int y = 0; y < m_size.height; y++) {
 #endif
@@ -452,7 +466,7 @@ namespace DirectGraphicalModels
 				}
 			} // x
 		} // y
-#ifdef ENABLE_PPL
+#ifdef ENABLE_PARALLEL
 		);
 #endif
 	}
@@ -492,4 +506,56 @@ namespace DirectGraphicalModels
 			m_graph.setEdges(group, Pot);
 		}
 	}
+
+	void CGraphLayeredExt::freezeTopology(void)
+	{
+		CGraphPairwise *pGraph = dynamic_cast<CGraphPairwise *>(&m_graph);
+		DGM_ASSERT_MSG(pGraph, "The topology may be frozen only for the CGraphPairwise graph");
+		DGM_ASSERT(m_size.width * m_size.height * m_nLayers == m_graph.getNumNodes());
+
+		m_vArcEdges.clear();
+		m_vArcOffsets.assign(1, 0);
+		for (int row = 0; row < 2 * m_size.height; row++) {
+			enumerateRow(m_size, m_nLayers, m_gType, row, [](size_t, size_t, byte) {}, [&](size_t node1, size_t node2, byte, byte) {
+				for (size_t e : { pGraph->findEdge(node1, node2), pGraph->findEdge(node2, node1) }) {
+					DGM_ASSERT_MSG(e != CGraphPairwise::NO_EDGE, "The arc (%zu)-(%zu) is not found", node1, node2);
+					m_vArcEdges.push_back(e);
+				}
+			});
+			m_vArcOffsets.push_back(m_vArcEdges.size() / 2);
+		}
+		m_frozenVersion = pGraph->m_topologyVersion;
+	}
+
+	bool CGraphLayeredExt::isTopologyFrozen(void) const
+	{
+		const CGraphPairwise *pGraph = dynamic_cast<const CGraphPairwise *>(&m_graph);
+		return m_frozenVersion && pGraph && pGraph->m_topologyVersion == m_frozenVersion;
+	}
+
+	void CGraphLayeredExt::setArcPots(const Mat &pots)
+	{
+		const byte nStates = m_graph.getNumStates();
+		const int  nArcs   = static_cast<int>(getNumArcs());
+
+		// Assertions
+		DGM_ASSERT_MSG(isTopologyFrozen(), "The graph topology is not frozen. Call CGraphLayeredExt::freezeTopology() first");
+		DGM_ASSERT_MSG(pots.rows == nArcs, "The number of potentials (%d) does not match the number of arcs (%d)", pots.rows, nArcs);
+		DGM_ASSERT(pots.cols == nStates * nStates);
+		DGM_ASSERT(pots.type() == CV_32FC1);
+
+		CGraphPairwise &graph = static_cast<CGraphPairwise &>(m_graph);
+		graph.allocateEdgePots();
+
+#ifdef ENABLE_PARALLEL
+		parallel::parallel_for(0, nArcs, [&](int a) {
+#else
+		for (int a = 0; a < nArcs; a++) {
+#endif
+			graph.setArcPot(m_vArcEdges[2 * a], m_vArcEdges[2 * a + 1], pots.ptr<float>(a));
+		}
+#ifdef ENABLE_PARALLEL
+		);
+#endif
+	}
 }
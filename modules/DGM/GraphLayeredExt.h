@@ -80,7 +80,7 @@ namespace DirectGraphicalModels
         * @code
         * buildGraph(potBase.size())
         * @endcode
-		* > This function supports PPL
+		* > This function supports parallel computing
 		* @param potBase A block of potentials for the base layer: Mat(type: CV_32FC(nStatesBase))
 		* @param potOccl A block of potentials for the occlusion layer: Mat(type: CV_32FC(nStatesOccl))
 		*/
@@ -108,8 +108,10 @@ namespace DirectGraphicalModels
 		/**
 		* @brief Fills the graph edges with potentials
 		* @details This function uses \b edgeTrainer class in oerder to achieve edge potentials from feature vectors, stored in \b featureVectors
-		* and fills with them the graph edges
-		* > This function supports PPL
+		* and fills with them the graph edges. The potentials of all edges of an image row are calculated with one call of the batch version of 
+		* CTrainEdge::getEdgePotentials(). For the CGraphPairwise graph the topology is frozen with freezeTopology(), if it was not frozen before, 
+		* and the potentials are written directly into the edge storage.
+		* > This function supports parallel computing
 		* @param edgeTrainer A pointer to the edge trainer
 		* @param linkTrainer A pointer to tht link (inter-layer edge) trainer
 		* @param featureVectors Multi-channel matrix, each element of which is a multi-dimensinal point: Mat(type: CV_8UC<nFeatures>)
@@ -121,8 +123,10 @@ namespace DirectGraphicalModels
 		/**
 		* @brief Fills the graph edges with potentials
 		* @details This function uses \b edgeTrainer class in oerder to achieve edge potentials from feature vectors, stored in \b featureVectors
-		* and fills with them the graph edges
-		* > This function supports PPL
+		* and fills with them the graph edges. The potentials of all edges of an image row are calculated with one call of the batch version of 
+		* CTrainEdge::getEdgePotentials(). For the CGraphPairwise graph the topology is frozen with freezeTopology(), if it was not frozen before, 
+		* and the potentials are written directly into the edge storage.
+		* > This function supports parallel computing
 		* @param edgeTrainer A pointer to the edge trainer
 		* @param linkTrainer A pointer to tht link (inter-layer edge) trainer
 		* @param featureVectors Vector of size \a nFeatures, each element of which is a single feature - image: Mat(type: CV_8UC1)
@@ -147,6 +151,36 @@ namespace DirectGraphicalModels
 		*/
 		DllExport void setEdges(std::optional<byte> group, const Mat &pot);
 		/**
+		* @brief Freezes the graph topology
+		* @details This function resolves once the indexes of the edges of all arcs (pairs of mutually opposite edges) of the graph, so that the potentials 
+		* of the arcs may be updated afterwards with setArcPots() without searching for the edges. This is useful when many images of the same resolution 
+		* (\a e.g. video frames) are classified with the same graph. The frozen topology is released, when the graph is rebuilt with buildGraph() or 
+		* when the nodes or edges of the graph are added or removed afterwards.
+		* @note The graph must be a CGraphPairwise graph, built with buildGraph()
+		*/
+		DllExport void freezeTopology(void);
+		/**
+		* @brief Checks whether the graph topology is frozen
+		* @retval true if the topology was frozen with freezeTopology() and was not changed since then
+		* @retval false otherwise
+		*/
+		DllExport bool isTopologyFrozen(void) const;
+		/**
+		* @brief Returns the number of arcs of the frozen graph
+		* @return The number of arcs (pairs of mutually opposite edges), which potentials are set with setArcPots()
+		*/
+		DllExport size_t getNumArcs(void) const { return isTopologyFrozen() ? m_vArcEdges.size() / 2 : 0; }
+		/**
+		* @brief Sets the potentials of all arcs of the frozen graph
+		* @details The arcs are enumerated in the order of their creation in buildGraph(): for every pixel in raster order the link between the two 
+		* bottom layers, the horizontal and the vertical edges of every layer, and then for every pixel - the diagonal edges of every layer. 
+		* As IGraphPairwise::setArc() does, the function assigns the square root of the potential to the first edge of the arc and its transpose - to the second edge.
+		* The potentials are written directly into the edge storage, without searching for the edges and without allocating memory.
+		* > This function supports parallel computing
+		* @param pots The arc potentials: Mat(size: nArcs x nStates<sup>2</sup>; type: CV_32FC1), where every row is a row-major nStates x nStates potential matrix
+		*/
+		DllExport void setArcPots(const Mat &pots);
+		/**
 		* @brief Returns the type of the graph
 		* @returns The type of the graph (Ref. @ref graphEdgesType)
 		*/
@@ -163,5 +197,8 @@ namespace DirectGraphicalModels
 		const word		m_nLayers;		///< Number of layers
 		const byte		m_gType;		///< Graph type (Ref. @ref graphEdgesType)
 		Size			m_size;			///< Size of the graph
+		size_t			m_frozenVersion	= 0;	///< Revision of the graph topology, which was frozen with freezeTopology(), or 0 if the topology is not frozen
+		vec_size_t		m_vArcEdges;	///< Indexes of the two edges of every arc of the frozen graph: 2 x nArcs
+		vec_size_t		m_vArcOffsets;	///< Index of the first arc of every row of the frozen graph (the diagonal edges form separate rows): 2 x height + 1
 	};
 }
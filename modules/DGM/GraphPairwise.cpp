@@ -1,38 +1,115 @@
 #include "GraphPairwise.h"
+#include "parallel.h"
 #include "macroses.h"
 
 namespace DirectGraphicalModels
 {
+	namespace {
+		// Checks whether all off-diagonal elements of the nStates x nStates matrix are equal
+		bool isPotts(const float *pPot, byte nStates)
+		{
+			if (nStates < 2) return false;
+			const float val = pPot[1];
+			for (byte y = 0; y < nStates; y++)
+				for (byte x = 0; x < nStates; x++)
+					if (x != y && pPot[y * nStates + x] != val) return false;
+			return true;
+		}
+	}
+
 	void CGraphPairwise::reset(void)
 	{
-		m_vNodes.clear();
-		m_vEdges.clear();
-		m_IDx = 0;
+		m_vNodePot.clear();
+		m_vNodeSol.clear();
+		m_vNodeIsSet.clear();
+		m_vNodeFirstTo.clear();
+		m_vNodeFirstFrom.clear();
+		m_vEdgePot.clear();
+		m_vEdgePotPool.clear();
+		m_nPoolFree = 0;
+		m_vEdgeNode1.clear();
+		m_vEdgeNode2.clear();
+		m_vEdgeGroup.clear();
+		m_vEdgeIsSet.clear();
+		m_vEdgeIsShared.clear();
+		m_vEdgeIsPotts.clear();
+		for (Mat &pot : m_vGroupPot) pot.release();
+		std::fill(m_vGroupDist.begin(), m_vGroupDist.end(), std::nullopt);
+		m_vEdgeNextTo.clear();
+		m_vEdgeNextFrom.clear();
+		m_topologyVersion++;
 	}
 
 	// Add a new node to the graph with specified potentional
 	size_t CGraphPairwise::addNode(const Mat &pot)
 	{
-		m_vNodes.push_back(ptr_node_t(new Node(m_IDx, pot))); 
-		return m_IDx++;
+		const byte	 nStates = getNumStates();
+		const size_t node	 = getNumNodes();
+
+		m_vNodePot.resize(m_vNodePot.size() + nStates, 0.0f);
+		m_vNodeSol.push_back(0);
+		m_vNodeIsSet.push_back(false);
+		m_vNodeFirstTo.push_back(NO_EDGE);
+		m_vNodeFirstFrom.push_back(NO_EDGE);
+		m_topologyVersion++;
+
+		if (!pot.empty()) setNode(node, pot);
+		return node;
+	}
+
+	// Add multiple nodes without potentials
+	size_t CGraphPairwise::addNodes(size_t nNodes)
+	{
+		const size_t first	= getNumNodes();
+		const size_t last	= first + nNodes;
+
+		m_vNodePot.resize(last * getNumStates(), 0.0f);
+		m_vNodeSol.resize(last, 0);
+		m_vNodeIsSet.resize(last, false);
+		m_vNodeFirstTo.resize(last, NO_EDGE);
+		m_vNodeFirstFrom.resize(last, NO_EDGE);
+		m_topologyVersion++;
+
+		return first;
 	}
 
 	// Set or change the potential of node idx
 	void CGraphPairwise::setNode(size_t node, const Mat &pot)
 	{
-		DGM_ASSERT_MSG(node < m_vNodes.size(), "Node %zu is out of range %zu", node, m_vNodes.size());
+		DGM_ASSERT_MSG(node < getNumNodes(), "Node %zu is out of range %zu", node, getNumNodes());
 		DGM_ASSERT_MSG((pot.cols == 1) && (pot.rows == getNumStates()), "Potential size (%d x %d) does not match (%d x %d)", pot.cols, pot.rows, 1, getNumStates());
+		DGM_ASSERT(pot.type() == CV_32FC1);
 
-		if (!m_vNodes[node]->Pot.empty()) m_vNodes[node]->Pot.release();
-		pot.copyTo(m_vNodes[node]->Pot);
+		pot.copyTo(lvalue_cast(Mat(getNumStates(), 1, CV_32FC1, getNodePot(node))));
+		m_vNodeIsSet[node] = true;
 	}
 
-	// Return node potential vector 
+	void CGraphPairwise::setNodes(size_t start_node, const Mat &pots)
+	{
+		const byte nStates = getNumStates();
+		DGM_ASSERT_MSG(start_node + pots.rows <= getNumNodes(), "The given ranges exceed the number of nodes(%zu)", getNumNodes());
+		DGM_ASSERT_MSG(pots.cols == nStates, "Potential size (%d) does not match (%d)", pots.cols, nStates);
+		DGM_ASSERT(pots.type() == CV_32FC1);
+
+#ifdef ENABLE_PARALLEL
+		parallel::parallel_for(0, pots.rows, [&](int n) {
+#else
+		for (int n = 0; n < pots.rows; n++) {
+#endif
+			memcpy(getNodePot(start_node + n), pots.ptr<float>(n), nStates * sizeof(float));
+			m_vNodeIsSet[start_node + n] = true;
+		}
+#ifdef ENABLE_PARALLEL
+		);
+#endif
+	}
+
+	// Return node potential vector
 	void CGraphPairwise::getNode(size_t node, Mat &pot) const
 	{
-		DGM_ASSERT_MSG(node < m_vNodes.size(), "Node %zu is out of range %zu", node, m_vNodes.size());
-		DGM_ASSERT_MSG(!m_vNodes[node]->Pot.empty(), "Specified node %zu is not set", node);
-		m_vNodes[node]->Pot.copyTo(pot);
+		DGM_ASSERT_MSG(node < getNumNodes(), "Node %zu is out of range %zu", node, getNumNodes());
+		DGM_ASSERT_MSG(m_vNodeIsSet[node], "Specified node %zu is not set", node);
+		Mat(getNumStates(), 1, CV_32FC1, const_cast<float *>(m_vNodePot.data() + node * getNumStates())).copyTo(pot);
 	}
 
 	// Return child nodes ID's
@@ -40,7 +117,8 @@ namespace DirectGraphicalModels
 	{
 		DGM_ASSERT_MSG(node < getNumNodes(), "Node %zu is out of range %zu", node, getNumNodes());
 		if (!vNodes.empty()) vNodes.clear();
-		for (size_t e: m_vNodes[node]->to) { vNodes.push_back(m_vEdges[e]->node2); }
+		for (size_t e = m_vNodeFirstTo[node]; e != NO_EDGE; e = m_vEdgeNextTo[e]) vNodes.push_back(m_vEdgeNode2[e]);
+		std::reverse(vNodes.begin(), vNodes.end());														// in order of edge creation
 	}
 
 	// Return parent nodes ID's
@@ -48,141 +126,358 @@ namespace DirectGraphicalModels
 	{
 		DGM_ASSERT_MSG(node < getNumNodes(), "Node %zu is out of range %zu", node, getNumNodes());
 		if (!vNodes.empty()) vNodes.clear();
-		for (size_t e: m_vNodes[node]->from) { vNodes.push_back(m_vEdges[e]->node1); }
+		for (size_t e = m_vNodeFirstFrom[node]; e != NO_EDGE; e = m_vEdgeNextFrom[e]) vNodes.push_back(m_vEdgeNode1[e]);
+		std::reverse(vNodes.begin(), vNodes.end());														// in order of edge creation
 	}
 
 
 	// Add a new (directed) edge to the graph with specified potentional
 	void CGraphPairwise::addEdge(size_t srcNode, size_t dstNode, byte group, const Mat &pot)
 	{
-		DGM_ASSERT_MSG(srcNode < m_vNodes.size(), "The source node index %zu is out of range %zu", srcNode, m_vNodes.size());
-		DGM_ASSERT_MSG(dstNode < m_vNodes.size(), "The destination node index %zu is out of range %zu", dstNode, m_vNodes.size());
+		DGM_ASSERT_MSG(srcNode < getNumNodes(), "The source node index %zu is out of range %zu", srcNode, getNumNodes());
+		DGM_ASSERT_MSG(dstNode < getNumNodes(), "The destination node index %zu is out of range %zu", dstNode, getNumNodes());
 
 		// Check if the edge exists
-		if (m_vNodes[srcNode]->to.size() < m_vNodes[dstNode]->from.size())
-			for (size_t &e : m_vNodes[srcNode]->to) { DGM_ASSERT(m_vEdges[e]->node2 != dstNode); }
-		else
-			for (size_t &e : m_vNodes[dstNode]->from) { DGM_ASSERT(m_vEdges[e]->node1 != srcNode); }
+		DGM_ASSERT(findEdge(srcNode, dstNode) == NO_EDGE);
 
 		// Else: create a new one
-		size_t e = m_vEdges.size();
-		m_vEdges.push_back(ptr_edge_t(new Edge(srcNode, dstNode, group, pot)));
-		m_vNodes[srcNode]->to.push_back(e);
-		m_vNodes[dstNode]->from.push_back(e);
+		const byte	 nStates = getNumStates();
+		const size_t e		 = getNumEdges();
+		m_vEdgeNode1.push_back(srcNode);
+		m_vEdgeNode2.push_back(dstNode);
+		m_vEdgeGroup.push_back(group);
+		m_vEdgeIsSet.push_back(false);
+		m_vEdgeIsShared.push_back(false);
+		m_vEdgeIsPotts.push_back(false);
+		m_vEdgePot.push_back(m_vZeroPot.data());
+		m_vEdgeNextTo.push_back(m_vNodeFirstTo[srcNode]);
+		m_vEdgeNextFrom.push_back(m_vNodeFirstFrom[dstNode]);
+		m_vNodeFirstTo[srcNode]	  = e;
+		m_vNodeFirstFrom[dstNode] = e;
+		m_topologyVersion++;
+
+		if (!pot.empty()) {
+			DGM_ASSERT_MSG((pot.cols == nStates) && (pot.rows == nStates), "Potential size (%d x %d) does not match (%d x %d)", pot.cols, pot.rows, nStates, nStates);
+			DGM_ASSERT(pot.type() == CV_32FC1);
+			const Mat _pot = pot.isContinuous() ? pot : pot.clone();
+			setEdgePot(e, _pot.ptr<float>());
+		}
+	}
+
+	// Add multiple (directed) edges without the duplicate check
+	void CGraphPairwise::addEdges(const vec_size_t &vSrcNodes, const vec_size_t &vDstNodes, const vec_byte_t &vGroups)
+	{
+		DGM_ASSERT(vSrcNodes.size() == vDstNodes.size());
+		DGM_ASSERT(vSrcNodes.size() == vGroups.size());
+
+		const size_t nNodes	= getNumNodes();
+		const size_t first	= getNumEdges();
+		const size_t last	= first + vSrcNodes.size();
+
+		m_vEdgeNode1.insert(m_vEdgeNode1.end(), vSrcNodes.begin(), vSrcNodes.end());
+		m_vEdgeNode2.insert(m_vEdgeNode2.end(), vDstNodes.begin(), vDstNodes.end());
+		m_vEdgeGroup.insert(m_vEdgeGroup.end(), vGroups.begin(), vGroups.end());
+		m_vEdgeIsSet.resize(last, false);
+		m_vEdgeIsShared.resize(last, false);
+		m_vEdgeIsPotts.resize(last, false);
+		m_vEdgePot.resize(last, m_vZeroPot.data());
+		m_vEdgeNextTo.resize(last);
+		m_vEdgeNextFrom.resize(last);
+
+		// Link the edges in the order of their indexes, as addEdge() does
+		for (size_t e = first; e < last; e++) {
+			const size_t srcNode = m_vEdgeNode1[e];
+			const size_t dstNode = m_vEdgeNode2[e];
+			DGM_ASSERT_MSG(srcNode < nNodes && dstNode < nNodes, "The edge (%zu)->(%zu) is out of range %zu", srcNode, dstNode, nNodes);
+			m_vEdgeNextTo[e]			= m_vNodeFirstTo[srcNode];
+			m_vEdgeNextFrom[e]			= m_vNodeFirstFrom[dstNode];
+			m_vNodeFirstTo[srcNode]		= e;
+			m_vNodeFirstFrom[dstNode]	= e;
+		}
+		m_topologyVersion++;
 	}
 
 	// Set or change the potentional of an directed edge
 	void CGraphPairwise::setEdge(size_t srcNode, size_t dstNode, const Mat &pot)
 	{
-		DGM_ASSERT_MSG(srcNode < m_vNodes.size(), "The source node index %zu is out of range %zu", srcNode, m_vNodes.size());
-		DGM_ASSERT_MSG(dstNode < m_vNodes.size(), "The destination node index %zu is out of range %zu", dstNode, m_vNodes.size());
+		DGM_ASSERT_MSG(srcNode < getNumNodes(), "The source node index %zu is out of range %zu", srcNode, getNumNodes());
+		DGM_ASSERT_MSG(dstNode < getNumNodes(), "The destination node index %zu is out of range %zu", dstNode, getNumNodes());
+		DGM_ASSERT_MSG((pot.cols == getNumStates()) && (pot.rows == getNumStates()), "Potential size (%d x %d) does not match (%d x %d)", pot.cols, pot.rows, getNumStates(), getNumStates());
+		DGM_ASSERT(pot.type() == CV_32FC1);
 
-		vec_size_t::const_iterator e_t = std::find_if(m_vNodes[srcNode]->to.cbegin(), m_vNodes[srcNode]->to.cend(), [&](size_t e) { return (m_vEdges[e]->node2 == dstNode); });
-		DGM_ASSERT_MSG(e_t != m_vNodes[srcNode]->to.end(), "The edge (%zu)->(%zu) is not found", srcNode, dstNode);
+		size_t e = findEdge(srcNode, dstNode);
+		DGM_ASSERT_MSG(e != NO_EDGE, "The edge (%zu)->(%zu) is not found", srcNode, dstNode);
 
-		pot.copyTo(m_vEdges[*e_t]->Pot);
+		const Mat _pot = pot.isContinuous() ? pot : pot.clone();
+		setEdgePot(e, _pot.ptr<float>());
 	}
 
 	void CGraphPairwise::setEdges(std::optional<byte> group, const Mat& pot)
 	{
-#ifdef ENABLE_PPL
-		size_t size = m_vEdges.size();
-		size_t rangeSize = size / (concurrency::GetProcessorCount() * 10);
-		rangeSize = MAX(1, rangeSize);
-		//printf("Processors: %d\n", concurrency::GetProcessorCount());
-		concurrency::parallel_for(size_t(0), size, rangeSize, [group, &pot, size, rangeSize, this](size_t i) {
-			for (int j = 0; (j < rangeSize) && (i + j < size); j++) {
-				ptr_edge_t& pEdge = m_vEdges[i + j];
-				if (!group || pEdge->group_id == group.value())
-					pot.copyTo(pEdge->Pot);
-			}
-		});
-#else 			
-		for (ptr_edge_t& pEdge : m_vEdges) {
-			if(!group || pEdge->group_id == group.value())
-					pot.copyTo(pEdge->Pot);	
+		const byte nStates = getNumStates();
+		DGM_ASSERT_MSG((pot.cols == nStates) && (pot.rows == nStates), "Potential size (%d x %d) does not match (%d x %d)", pot.cols, pot.rows, nStates, nStates);
+		DGM_ASSERT(pot.type() == CV_32FC1);
+
+		// The edges refer to one shared copy of the potentials instead of having individual copies
+		const Mat _pot = pot.clone();
+		if (group) {
+			m_vGroupPot[group.value()] = _pot;
+			m_vGroupDist[group.value()].reset();
+		} else {
+			std::fill(m_vGroupPot.begin(), m_vGroupPot.end(), _pot);
+			std::fill(m_vGroupDist.begin(), m_vGroupDist.end(), std::nullopt);
 		}
-#endif
+		const bool potts = isPotts(_pot.ptr<float>(), nStates);
+
+		for (size_t e = 0; e < getNumEdges(); e++)
+			if (!group || m_vEdgeGroup[e] == group.value()) {
+				m_vEdgeIsSet[e]	   = true;
+				m_vEdgeIsShared[e] = true;
+				m_vEdgeIsPotts[e]  = potts;
+			}
+	}
+
+	void CGraphPairwise::setDistanceEdges(std::optional<byte> group, EdgeDistance dist, float lambda, float truncation)
+	{
+		const byte nStates = getNumStates();
+		DGM_ASSERT_MSG(lambda >= 0, "The weight of the distance must be non-negative");
+		DGM_ASSERT_MSG(truncation >= 0, "The truncation value of the distance must be non-negative");
+
+		// The truncation beyond the largest distance has no effect
+		const float maxDist = dist == EdgeDistance::linear ? static_cast<float>(nStates - 1) : static_cast<float>((nStates - 1) * (nStates - 1));
+		truncation = MIN(truncation, maxDist);
+
+		Mat pot(nStates, nStates, CV_32FC1);
+		for (int y = 0; y < nStates; y++) {
+			float *pPot = pot.ptr<float>(y);
+			for (int x = 0; x < nStates; x++) {
+				const float d = static_cast<float>(dist == EdgeDistance::linear ? abs(x - y) : (x - y) * (x - y));
+				pPot[x] = expf(-lambda * MIN(d, truncation));
+			} // x
+		} // y
+		setEdges(group, pot);
+
+		const DistancePot distPot = { dist, lambda, truncation };
+		if (group) m_vGroupDist[group.value()] = distPot;
+		else std::fill(m_vGroupDist.begin(), m_vGroupDist.end(), distPot);
 	}
 
 	// Return edge potential matrix
 	void CGraphPairwise::getEdge(size_t srcNode, size_t dstNode, Mat &pot) const
 	{
-		DGM_ASSERT_MSG(srcNode < m_vNodes.size(), "The source node index %zu is out of range %zu", srcNode, m_vNodes.size());
-		DGM_ASSERT_MSG(dstNode < m_vNodes.size(), "The destination node index %zu is out of range %zu", dstNode, m_vNodes.size());
+		DGM_ASSERT_MSG(srcNode < getNumNodes(), "The source node index %zu is out of range %zu", srcNode, getNumNodes());
+		DGM_ASSERT_MSG(dstNode < getNumNodes(), "The destination node index %zu is out of range %zu", dstNode, getNumNodes());
 
-		vec_size_t::const_iterator e_t = std::find_if(m_vNodes[srcNode]->to.cbegin(), m_vNodes[srcNode]->to.cend(), [&](size_t e) { return (m_vEdges[e]->node2 == dstNode); });
-		DGM_ASSERT_MSG(e_t != m_vNodes[srcNode]->to.end(), "The edge (%zu)->(%zu) is not found", srcNode, dstNode);
-		if (m_vEdges[*e_t]->Pot.empty()) {
+		size_t e = findEdge(srcNode, dstNode);
+		DGM_ASSERT_MSG(e != NO_EDGE, "The edge (%zu)->(%zu) is not found", srcNode, dstNode);
+		if (!m_vEdgeIsSet[e]) {
  			DGM_WARNING("Edge Potential is empty");
 			if (!pot.empty()) pot.release();
-		} else m_vEdges[*e_t]->Pot.copyTo(pot);
+		} else Mat(getNumStates(), getNumStates(), CV_32FC1, const_cast<float *>(getEdgePot(e))).copyTo(pot);
 	}
 
 	void CGraphPairwise::setEdgeGroup(size_t srcNode, size_t dstNode, byte group)
 	{
-		DGM_ASSERT_MSG(srcNode < m_vNodes.size(), "The source node index %zu is out of range %zu", srcNode, m_vNodes.size());
-		DGM_ASSERT_MSG(dstNode < m_vNodes.size(), "The destination node index %zu is out of range %zu", dstNode, m_vNodes.size());
+		DGM_ASSERT_MSG(srcNode < getNumNodes(), "The source node index %zu is out of range %zu", srcNode, getNumNodes());
+		DGM_ASSERT_MSG(dstNode < getNumNodes(), "The destination node index %zu is out of range %zu", dstNode, getNumNodes());
 
-		vec_size_t::const_iterator e_t = std::find_if(m_vNodes[srcNode]->to.cbegin(), m_vNodes[srcNode]->to.cend(), [&](size_t e) { return (m_vEdges[e]->node2 == dstNode); });
-		DGM_ASSERT_MSG(e_t != m_vNodes[srcNode]->to.end(), "The edge (%zu)->(%zu) is not found", srcNode, dstNode);
-		m_vEdges[*e_t]->group_id = group;
+		size_t e = findEdge(srcNode, dstNode);
+		DGM_ASSERT_MSG(e != NO_EDGE, "The edge (%zu)->(%zu) is not found", srcNode, dstNode);
+		if (m_vEdgeIsShared[e] && m_vEdgeGroup[e] != group) setEdgePot(e, getEdgePot(e));		// the edge keeps the potentials of its old group
+		m_vEdgeGroup[e] = group;
 	}
 
 	byte CGraphPairwise::getEdgeGroup(size_t srcNode, size_t dstNode) const
 	{
-		DGM_ASSERT_MSG(srcNode < m_vNodes.size(), "The source node index %zu is out of range %zu", srcNode, m_vNodes.size());
-		DGM_ASSERT_MSG(dstNode < m_vNodes.size(), "The destination node index %zu is out of range %zu", dstNode, m_vNodes.size());
+		DGM_ASSERT_MSG(srcNode < getNumNodes(), "The source node index %zu is out of range %zu", srcNode, getNumNodes());
+		DGM_ASSERT_MSG(dstNode < getNumNodes(), "The destination node index %zu is out of range %zu", dstNode, getNumNodes());
 
-		vec_size_t::const_iterator e_t = std::find_if(m_vNodes[srcNode]->to.cbegin(), m_vNodes[srcNode]->to.cend(), [&](size_t e) { return (m_vEdges[e]->node2 == dstNode); });
-		DGM_ASSERT_MSG(e_t != m_vNodes[srcNode]->to.end(), "The edge (%zu)->(%zu) is not found", srcNode, dstNode);
+		size_t e = findEdge(srcNode, dstNode);
+		DGM_ASSERT_MSG(e != NO_EDGE, "The edge (%zu)->(%zu) is not found", srcNode, dstNode);
 
-		return m_vEdges[*e_t]->group_id;
+		return m_vEdgeGroup[e];
 	}
 
 	void CGraphPairwise::removeEdge(size_t srcNode, size_t dstNode)
 	{
-		DGM_ASSERT_MSG(srcNode < m_vNodes.size(), "The source node index %zu is out of range %zu", srcNode, m_vNodes.size());
-		DGM_ASSERT_MSG(dstNode < m_vNodes.size(), "The destination node index %zu is out of range %zu", dstNode, m_vNodes.size());
+		DGM_ASSERT_MSG(srcNode < getNumNodes(), "The source node index %zu is out of range %zu", srcNode, getNumNodes());
+		DGM_ASSERT_MSG(dstNode < getNumNodes(), "The destination node index %zu is out of range %zu", dstNode, getNumNodes());
 
-		vec_size_t::const_iterator e_t = std::find_if(m_vNodes[srcNode]->to.cbegin(), m_vNodes[srcNode]->to.cend(), [&](size_t e) { return (m_vEdges[e]->node2 == dstNode); });
+		size_t e = findEdge(srcNode, dstNode);
+		DGM_ASSERT_MSG(e != NO_EDGE, "The edge (%zu)->(%zu) is not found", srcNode, dstNode);
 
-		DGM_ASSERT_MSG(e_t != m_vNodes[srcNode]->to.end(), "The edge (%zu)->(%zu) is not found", srcNode, dstNode);
-
-		removeEdge(*e_t);
+		removeEdge(e);
 	}
 
 	bool CGraphPairwise::isEdgeExists(size_t srcNode, size_t dstNode) const
 	{
-		DGM_ASSERT_MSG(srcNode < m_vNodes.size(), "The source node index %zu is out of range %zu", srcNode, m_vNodes.size());
-		DGM_ASSERT_MSG(dstNode < m_vNodes.size(), "The destination node index %zu is out of range %zu", dstNode, m_vNodes.size());
-		
-		auto e_t = std::find_if(m_vNodes[srcNode]->to.cbegin(), m_vNodes[srcNode]->to.cend(), [&](size_t e) { return (m_vEdges[e]->node2 == dstNode); });
+		DGM_ASSERT_MSG(srcNode < getNumNodes(), "The source node index %zu is out of range %zu", srcNode, getNumNodes());
+		DGM_ASSERT_MSG(dstNode < getNumNodes(), "The destination node index %zu is out of range %zu", dstNode, getNumNodes());
 
-		if (e_t == m_vNodes[srcNode]->to.cend()) return false;
-		else									 return true;
+		return findEdge(srcNode, dstNode) != NO_EDGE;
 	}
 
 
     // ------------------------------ PRIVATE ------------------------------
-	///@todo Optimize the edge removement
+	size_t CGraphPairwise::findEdge(size_t srcNode, size_t dstNode) const
+	{
+		size_t e_t = m_vNodeFirstTo[srcNode];
+		size_t e_f = m_vNodeFirstFrom[dstNode];
+		// Walk both lists simultaneously: the search ends with the shorter one
+		while (e_t != NO_EDGE && e_f != NO_EDGE) {
+			if (m_vEdgeNode2[e_t] == dstNode) return e_t;
+			if (m_vEdgeNode1[e_f] == srcNode) return e_f;
+			e_t = m_vEdgeNextTo[e_t];
+			e_f = m_vEdgeNextFrom[e_f];
+		}
+		return NO_EDGE;
+	}
+
 	void CGraphPairwise::removeEdge(size_t edge)
 	{
-		DGM_ASSERT_MSG(edge < m_vEdges.size(), "Edge %zu is out of range %zu", edge, m_vEdges.size());
+		DGM_ASSERT_MSG(edge < getNumEdges(), "Edge %zu is out of range %zu", edge, getNumEdges());
+
+		size_t srcNode = m_vEdgeNode1[edge];
+		size_t dstNode = m_vEdgeNode2[edge];
+
+		// The edge index remains reserved, the edge is excluded from the adjacency lists only
+		m_vEdgeIsSet[edge]	  = false;
+		m_vEdgeIsShared[edge] = false;
+
+		size_t *pE = &m_vNodeFirstTo[srcNode];
+		while (*pE != edge) {
+			DGM_ASSERT(*pE != NO_EDGE);
+			pE = &m_vEdgeNextTo[*pE];
+		}
+		*pE = m_vEdgeNextTo[edge];
+
+		pE = &m_vNodeFirstFrom[dstNode];
+		while (*pE != edge) {
+			DGM_ASSERT(*pE != NO_EDGE);
+			pE = &m_vEdgeNextFrom[*pE];
+		}
+		*pE = m_vEdgeNextFrom[edge];
+
+		m_vEdgeNextTo[edge] = NO_EDGE;
+		m_vEdgeNextFrom[edge] = NO_EDGE;
+		m_topologyVersion++;
+	}
+
+	void CGraphPairwise::buildAdjacency(void)
+	{
+		if (m_adjacencyVersion == m_topologyVersion) return;
 
-		size_t srcNode = m_vEdges[edge]->node1;
-		size_t dstNode = m_vEdges[edge]->node2;
+		const size_t nNodes = getNumNodes();
 
-		m_vEdges[edge]->Pot.release();
-		//m_vEdges.erase(m_vEdges.begin() + edge);
-		
-		vec_size_t::const_iterator e_t = std::find(m_vNodes[srcNode]->to.cbegin(), m_vNodes[srcNode]->to.cend(), edge);
-		DGM_ASSERT(e_t != m_vNodes[srcNode]->to.cend());
-		m_vNodes[srcNode]->to.erase(e_t);
-		
-		vec_size_t::const_iterator e_f = std::find(m_vNodes[dstNode]->from.cbegin(), m_vNodes[dstNode]->from.cend(), edge);
-		DGM_ASSERT(e_f != m_vNodes[dstNode]->from.cend());
-		m_vNodes[dstNode]->from.erase(e_f);
+		auto build = [nNodes](const vec_size_t &vFirst, const vec_size_t &vNext, vec_size_t &vOffsets, vec_size_t &vEdges) {
+			vOffsets.assign(nNodes + 1, 0);
+			for (size_t n = 0; n < nNodes; n++) {
+				size_t nEdges = 0;
+				for (size_t e = vFirst[n]; e != NO_EDGE; e = vNext[e]) nEdges++;
+				vOffsets[n + 1] = vOffsets[n] + nEdges;
+			}
+			vEdges.resize(vOffsets[nNodes]);
+			// The linked lists store the newest edge first: fill in backwards to keep the order of edge creation
+			for (size_t n = 0; n < nNodes; n++) {
+				size_t i = vOffsets[n + 1];
+				for (size_t e = vFirst[n]; e != NO_EDGE; e = vNext[e]) vEdges[--i] = e;
+			}
+		};
+
+		build(m_vNodeFirstTo, m_vEdgeNextTo, m_vToOffsets, m_vTo);
+		build(m_vNodeFirstFrom, m_vEdgeNextFrom, m_vFromOffsets, m_vFrom);
+		m_adjacencyVersion = m_topologyVersion;
+	}
+
+	void CGraphPairwise::colorNodes(std::vector<vec_size_t> &vvColorNodes) const
+	{
+		const size_t NO_COLOR = static_cast<size_t>(-1);
+		const size_t nNodes   = getNumNodes();
+
+		vvColorNodes.clear();
+		vec_size_t vColor(nNodes, NO_COLOR);
+		vec_size_t vUsedBy;																				// vUsedBy[c] == n if color c is taken by a neighbor of node n
+		for (size_t n = 0; n < nNodes; n++) {
+			for (size_t e_t : getToEdges(n))	if (vColor[m_vEdgeNode2[e_t]] != NO_COLOR) vUsedBy[vColor[m_vEdgeNode2[e_t]]] = n;
+			for (size_t e_f : getFromEdges(n))	if (vColor[m_vEdgeNode1[e_f]] != NO_COLOR) vUsedBy[vColor[m_vEdgeNode1[e_f]]] = n;
+			
+			size_t c = 0;
+			while (c < vUsedBy.size() && vUsedBy[c] == n) c++;											// the smallest free color
+			if (c == vUsedBy.size()) {
+				vUsedBy.push_back(NO_COLOR);
+				vvColorNodes.emplace_back();
+			}
+			vColor[n] = c;
+			vvColorNodes[c].push_back(n);
+		}
 	}
-}
 
+	void CGraphPairwise::allocateEdgePots(void)
+	{
+		const size_t size	= getNumStates() * getNumStates();
+		const size_t nNew	= std::count(m_vEdgePot.begin(), m_vEdgePot.end(), m_vZeroPot.data());
+		if (nNew == 0) return;
+
+		// The free tables of the last page are used first, and one new page is taken for the rest of the new tables
+		float *pFree = m_nPoolFree ? m_vEdgePotPool.back().data() + m_vEdgePotPool.back().size() - m_nPoolFree * size : NULL;
+		float *pPot	 = NULL;
+		if (nNew > m_nPoolFree) {
+			m_vEdgePotPool.emplace_back((nNew - m_nPoolFree) * size, 0.0f);		// moving the pages in the pool does not move their data
+			pPot = m_vEdgePotPool.back().data();
+		}
+		for (float *&pEdgePot : m_vEdgePot)
+			if (pEdgePot == m_vZeroPot.data()) {
+				if (m_nPoolFree) {
+					pEdgePot = pFree;
+					pFree += size;
+					m_nPoolFree--;
+				}
+				else {
+					pEdgePot = pPot;
+					pPot += size;
+				}
+			}
+	}
+
+	float * CGraphPairwise::getIndividualEdgePot(size_t edge)
+	{
+		if (m_vEdgePot[edge] != m_vZeroPot.data()) return m_vEdgePot[edge];
+
+		const size_t size = getNumStates() * getNumStates();
+		std::lock_guard<std::mutex> lock(m_mtxEdgePot);
+		if (m_nPoolFree == 0) {
+			// Moving the pages in the pool does not move their data
+			m_nPoolFree = MAX(1, EDGE_POT_PAGE / size);
+			m_vEdgePotPool.emplace_back(m_nPoolFree * size, 0.0f);
+		}
+		vec_float_t &page = m_vEdgePotPool.back();
+		m_vEdgePot[edge] = page.data() + page.size() - m_nPoolFree * size;
+		m_nPoolFree--;
+		return m_vEdgePot[edge];
+	}
+
+	void CGraphPairwise::setEdgePot(size_t edge, const float *pPot)
+	{
+		const byte nStates = getNumStates();
+		memcpy(getIndividualEdgePot(edge), pPot, nStates * nStates * sizeof(float));
+		m_vEdgeIsSet[edge]	  = true;
+		m_vEdgeIsShared[edge] = false;
+		m_vEdgeIsPotts[edge]  = isPotts(pPot, nStates);
+	}
+
+	void CGraphPairwise::setArcPot(size_t edge12, size_t edge21, const float *pPot)
+	{
+		const byte nStates = getNumStates();
+		float *pPot12 = getIndividualEdgePot(edge12);
+		float *pPot21 = getIndividualEdgePot(edge21);
+		for (byte y = 0; y < nStates; y++)
+			for (byte x = 0; x < nStates; x++)
+				pPot12[y * nStates + x] = pPot21[x * nStates + y] = sqrtf(pPot[y * nStates + x]);
+		const bool potts = isPotts(pPot12, nStates);			// the transposed Potts matrix is also a Potts matrix
+		for (size_t e : { edge12, edge21 }) {
+			m_vEdgeIsSet[e]		= true;
+			m_vEdgeIsShared[e]	= false;
+			m_vEdgeIsPotts[e]	= potts;
+		}
+	}
+}
@@ -3,48 +3,45 @@
 #pragma once
 
 #include "IGraphPairwise.h"
+#include <mutex>
 
 namespace DirectGraphicalModels
 {
-	// =============================== Node Structure ==============================
+	// ============================ Edge Range Structure ===========================
 	/**
-	* @brief %Node structure
-	* @details Basic info for each node.
+	* @brief Range of edge indexes
+	* @details A lightweight view of a part of the adjacency array, which allows for iterating over the incoming or outgoing edges of a node:
+	* @code
+	* for (size_t e_t : graph.getToEdges(node)) { ... }
+	* @endcode
 	*/
-	struct Node {
-		size_t		id;		    ///< %Node ID
-		Mat			Pot;	    ///< %Node potentials: Mat(size: nStates x 1; type: CV_32FC1)
-		byte		sol;
-		vec_size_t	to;		    ///< Array of edge ids, pointing to the Child vertices
-		vec_size_t	from;	    ///< Array of edge ids, coming from the Parent vertices
+	struct EdgeRange {
+		const size_t	* pBegin;	///< Pointer to the first edge index
+		const size_t	* pEnd;		///< Pointer to the position following the last edge index
 
-		Node(void) = delete;
-		Node(size_t _id, const Mat &p = EmptyMat) : id(_id), Pot(p.empty() ? Mat() : p.clone()), sol(0) {}
+		const size_t	* begin(void) const { return pBegin; }
+		const size_t	* end(void) const { return pEnd; }
+		size_t			  size(void) const { return static_cast<size_t>(pEnd - pBegin); }
+		bool			  empty(void) const { return pBegin == pEnd; }
 	};
-	using ptr_node_t = std::unique_ptr<Node>;
-	using vec_node_t = std::vector<ptr_node_t>;
 
-	// =============================== Edge Structure ==============================
-	/**
-	* @brief %Edge structure
-	* @details Basic item stored in adjacency list.
-	*/
-	struct Edge {
-		size_t	  node1;		///< First (source) node in edge
-		size_t	  node2;		///< Second (destination) node in edge
-		Mat		  Pot;			///< The edge potentials: Mat(size: nStates x nStates; type: CV_32FC1)
-		byte	  group_id;		///< ID of the group, to which the edge belongs
-
-		Edge(void) = delete;
-		Edge(size_t n1, size_t n2, byte group = 0, const Mat &p = EmptyMat) : node1(n1), node2(n2), Pot(p.empty() ? Mat() : p.clone()), group_id(group) {}
+	/// Types of the distance between the states, for the edge potentials set with CGraphPairwise::setDistanceEdges()
+	enum class EdgeDistance : byte {
+		linear,			///< Truncated linear distance: \f$ \min(|s_1 - s_2|, t) \f$
+		quadratic		///< Truncated quadratic distance: \f$ \min((s_1 - s_2)^2, t) \f$
 	};
-	using	ptr_edge_t = std::unique_ptr<Edge>;
-	using	vec_edge_t = std::vector<ptr_edge_t>;
 
 	// ================================ Graph Class ================================
 	/**
 	* @brief Pairwise graph class
 	* @ingroup moduleGraph
+	* @details The graph is stored as a structure of arrays: all node potentials are kept in one contiguous block of \a nNodes x \a nStates values, 
+	* and the individual edge potentials - in a pool of \a nStates x \a nStates tables, where a table is taken only for an edge, which gets its own 
+	* potentials. The pool grows in pages and never moves the tables already in use. The potentials, assigned with setEdges() to a whole group of edges, are not copied to every edge: the edges 
+	* refer to one shared potential table of their group instead. Setting the potential of a single edge with setEdge() creates its individual copy 
+	* (copy-on-write), so that the other edges of the group are not affected. The graph topology is stored in the index arrays 
+	* (linked lists of incoming and outgoing edges for every node), which allow for fast adding and removing of edges. Before inference, the topology 
+	* is compressed into the CSR (compressed sparse row) adjacency arrays, on which the inference classes operate directly.
 	* @author Sergey G. Kosov, sergey.kosov@project-10.de
 	*/
 	class CGraphPairwise : public IGraphPairwise
@@ -55,6 +52,8 @@ namespace DirectGraphicalModels
 		friend class CInferLBP;
 		friend class CInferViterbi;
 		friend class CInferTRW;
+		friend class CInferRBP;
+		friend class CGraphLayeredExt;
 
         
 	public:
@@ -62,18 +61,26 @@ namespace DirectGraphicalModels
 		* @brief Constructor
 		* @param nStates the number of States (classes)
 		*/
-		DllExport CGraphPairwise(byte nStates) : IGraphPairwise(nStates), m_IDx(0) {}
+		DllExport CGraphPairwise(byte nStates) : IGraphPairwise(nStates), m_vZeroPot(nStates * nStates, 0.0f), m_vGroupPot(256), m_vGroupDist(256) {}
         DllExport virtual ~CGraphPairwise(void) = default;
 
 		// CGraph
 		DllExport void		reset(void) override;
 		DllExport size_t	addNode		  (const Mat &pot = EmptyMat) override;
 		DllExport void		setNode       (size_t node, const Mat &pot) override;
+		/**
+		* @brief Sets or changes the potentials of multiple nodes at once
+		* @details The potentials are copied directly into the node storage, without creating a matrix for every node.
+		* > This function supports parallel computing
+		* @param start_node The index of the first node
+		* @param pots The node potentials: Mat(size: nNodes x nStates; type: CV_32FC1)
+		*/
+		DllExport void		setNodes	  (size_t start_node, const Mat &pots) override;
 		DllExport void		getNode       (size_t node, Mat &pot) const override;
 		DllExport void		getChildNodes (size_t node, vec_size_t &vNodes) const override;
 		DllExport void		getParentNodes(size_t node, vec_size_t &vNodes) const override;
-		DllExport size_t	getNumNodes(void) const override { return m_vNodes.size(); }
-		DllExport size_t	getNumEdges(void) const override { return m_vEdges.size(); } 
+		DllExport size_t	getNumNodes(void) const override { return m_vNodeSol.size(); }
+		DllExport size_t	getNumEdges(void) const override { return m_vEdgeNode1.size(); } 
 		
 //     DllExport virtual void      marginalize(const vec_size_t &nodes);
 		
@@ -85,28 +92,184 @@ namespace DirectGraphicalModels
 		DllExport byte		getEdgeGroup(size_t srcNode, size_t dstNode) const override;
 		DllExport void		removeEdge	(size_t srcNode, size_t dstNode) override;
 		DllExport bool		isEdgeExists(size_t srcNode, size_t dstNode) const override;
-
-#ifdef DEBUG_MODE
 		/**
-		* @brief Returns the edge container
-		* @warning Using this function is not safe. It is added exclusively for the debugging purposes.
-		* @return The edge container.
+		* @brief Sets the truncated distance potentials to the edges
+		* @details The potentials of the edges depend only on the distance between the states of the nodes: 
+		* \f$ pot(s_1, s_2) = e^{-\lambda\cdot\min(d(s_1, s_2), t)} \f$, where \f$ d \f$ is either the linear \f$ |s_1 - s_2| \f$ or the quadratic 
+		* \f$ (s_1 - s_2)^2 \f$ distance and \f$ t \f$ is the truncation value. Such potentials suit the ordered states, \a e.g. disparities or motion vectors.
+		* The max-product inference algorithms (CInferViterbi and CInferTRW) calculate the messages for these edges in linear time using the distance transform,
+		* the other algorithms use the potential matrix, as if it was set with setEdges().
+		* @param group The edge group ID. If \b std::nullopt, the potentials are set to all edges of the graph
+		* @param dist The type of the distance
+		* @param lambda The weight \f$ \lambda \geq 0 \f$ of the distance
+		* @param truncation The truncation value \f$ t \f$ of the distance
 		*/
-		DllExport vec_edge_t* getEdgesContainer(void) { return &m_vEdges; }
-#endif
+		DllExport void		setDistanceEdges(std::optional<byte> group, EdgeDistance dist, float lambda, float truncation);
+		using IGraphPairwise::addNodes;
+		/**
+		* @brief Adds multiple nodes at once
+		* @details The potentials of the new nodes are not set.
+		* @param nNodes The number of new nodes
+		* @return The index of the first new node
+		*/
+		DllExport size_t	addNodes(size_t nNodes);
+		/**
+		* @brief Adds multiple directed edges at once
+		* @details This function allocates the memory once for all the new edges and does not check whether the edges already exist: 
+		* the caller must guarantee that every edge is unique, \a e.g. when the graph topology is known in advance. The potentials of the new edges are not set.
+		* @param vSrcNodes The source nodes of the edges
+		* @param vDstNodes The destination nodes of the edges
+		* @param vGroups The group IDs of the edges
+		*/
+		DllExport void		addEdges(const vec_size_t &vSrcNodes, const vec_size_t &vDstNodes, const vec_byte_t &vGroups);
+
+
 
 	private:
+		/// Parameters of the truncated distance potentials
+		struct DistancePot {
+			EdgeDistance	dist;			///< Type of the distance
+			float			lambda;			///< Weight of the distance
+			float			truncation;		///< Truncation value of the distance
+		};
+
+		static constexpr size_t	NO_EDGE = static_cast<size_t>(-1);		///< End of an edge list
+		static constexpr size_t	EDGE_POT_PAGE = 1 << 16;				///< Number of values in one page of the individual edge potentials pool
+
+		/**
+		* @brief Returns the index of the specified edge
+		* @param srcNode index of the source node
+		* @param dstNode index of the destination node
+		* @return The index of the edge (\a srcNode, \a dstNode) or \b NO_EDGE if the edge does not exist
+		*/
+		size_t				findEdge(size_t srcNode, size_t dstNode) const;
 		/**
 		* @brief Removes the specified edge
 		* @param edge index of the edge
 		*/
-		DllExport void				removeEdge(size_t edge);
+		DllExport void		removeEdge(size_t edge);
+		/**
+		* @brief Builds the CSR adjacency arrays
+		* @details The arrays are rebuilt only if the graph topology was changed since the last call.
+		* The inference classes must call this function before using getToEdges() and getFromEdges().
+		*/
+		void				buildAdjacency(void);
+		/**
+		* @brief Colors the nodes of the graph
+		* @details The greedy coloring assigns different colors to every two nodes, connected with an edge. The nodes are colored in the order of their 
+		* indexes, thus the regular grids get 2 colors for 4-connectivity (red-black or checkerboard coloring) and 4 colors for 8-connectivity.
+		* > Needs the CSR adjacency arrays to be built with buildAdjacency()
+		* @param[out] vvColorNodes The nodes of every color
+		*/
+		void				colorNodes(std::vector<vec_size_t> &vvColorNodes) const;
+		/**
+		* @brief Allocates the individual edge potentials for all the edges of the graph, which do not have them yet
+		* @details This function takes the free tables of the last page of the pool and one new page for the rest of such edges at once. It is useful before the potentials of all the edges are set 
+		* individually, \a e.g. with setArcPot(). It must not be called concurrently with any other function of the graph.
+		*/
+		void				allocateEdgePots(void);
+		/**
+		* @brief Returns the individual potentials of the edge
+		* @details If the edge does not have individual potentials yet, a new table is taken from the pool.
+		* This function is thread-safe for different edges, while no edges are being added.
+		* @param edge index of the edge
+		* @return The pointer to the \a nStates x \a nStates individual edge potentials (row-major order)
+		*/
+		float			  * getIndividualEdgePot(size_t edge);
+		/**
+		* @brief Sets the individual potentials of the edge
+		* @details This function is thread-safe for different edges
+		* @param edge index of the edge
+		* @param pPot pointer to the \a nStates x \a nStates edge potentials (row-major order)
+		*/
+		void				setEdgePot(size_t edge, const float *pPot);
+		/**
+		* @brief Sets the individual potentials of the arc
+		* @details As IGraphPairwise::setArc() does, this function assigns the square root of the potential to the first edge and its transpose - to the second edge.
+		* The potentials are written directly into the edge storage. This function is thread-safe for different edges
+		* @param edge12 index of the first edge of the arc
+		* @param edge21 index of the second (opposite) edge of the arc
+		* @param pPot pointer to the \a nStates x \a nStates arc potentials (row-major order)
+		*/
+		void				setArcPot(size_t edge12, size_t edge21, const float *pPot);
+		/**
+		* @brief Returns the outgoing edges of the node
+		* @details Needs the CSR adjacency arrays to be built with buildAdjacency()
+		* @param node index of the node
+		* @return The range of indexes of the edges, coming from the node \b node
+		*/
+		EdgeRange			getToEdges(size_t node) const { return { m_vTo.data() + m_vToOffsets[node], m_vTo.data() + m_vToOffsets[node + 1] }; }
+		/**
+		* @brief Returns the incoming edges of the node
+		* @details Needs the CSR adjacency arrays to be built with buildAdjacency()
+		* @param node index of the node
+		* @return The range of indexes of the edges, pointing to the node \b node
+		*/
+		EdgeRange			getFromEdges(size_t node) const { return { m_vFrom.data() + m_vFromOffsets[node], m_vFrom.data() + m_vFromOffsets[node + 1] }; }
+		/**
+		* @brief Returns the potentials of the node
+		* @param node index of the node
+		* @return The pointer to the \a nStates node potentials
+		*/
+		float			  * getNodePot(size_t node) { return m_vNodePot.data() + node * getNumStates(); }
+		/**
+		* @brief Returns the potentials of the edge
+		* @details The potentials are either the individual potentials of the edge, or the shared potentials of the edge group
+		* @param edge index of the edge
+		* @return The pointer to the \a nStates x \a nStates edge potentials (row-major order)
+		*/
+		const float		  * getEdgePot(size_t edge) const { return m_vEdgeIsShared[edge] ? m_vGroupPot[m_vEdgeGroup[edge]].ptr<float>() : m_vEdgePot[edge]; }
+		/**
+		* @brief Checks whether the edge potentials have the (contrast-sensitive) Potts form
+		* @details The Potts potentials have arbitrary values on the main diagonal and one constant value for all off-diagonal elements.
+		* This property is detected when the edge potentials are set, and allows the inference classes to compute the messages in linear time.
+		* @param edge index of the edge
+		* @retval true if the edge potentials have the Potts form
+		* @retval false otherwise
+		*/
+		bool				isEdgePotts(size_t edge) const { return m_vEdgeIsPotts[edge] != 0; }
+		/**
+		* @brief Returns the parameters of the truncated distance potentials of the edge
+		* @param edge index of the edge
+		* @return The pointer to the parameters of the edge potentials, set with setDistanceEdges(), or \b NULL if the edge potentials have another form
+		*/
+		const DistancePot * getEdgeDistance(size_t edge) const 
+		{ 
+			const std::optional<DistancePot> &dist = m_vGroupDist[m_vEdgeGroup[edge]];
+			return m_vEdgeIsShared[edge] && dist ? &dist.value() : NULL; 
+		}
 
 
 	private:
-		size_t		m_IDx;			// = 0;	Primary Key
-		vec_node_t	m_vNodes;		// Nodes container
-		vec_edge_t	m_vEdges;		// Edges container
+		// Nodes
+		vec_float_t			m_vNodePot;			///< Node potentials: nNodes x nStates
+		vec_byte_t			m_vNodeSol;			///< Node solutions (used by TRW inference)
+		vec_byte_t			m_vNodeIsSet;		///< Flags indicating whether the node potentials are set
+		vec_size_t			m_vNodeFirstTo;		///< Index of the first outgoing edge of the node
+		vec_size_t			m_vNodeFirstFrom;	///< Index of the first incoming edge of the node
+		// Edges
+		std::vector<float *> m_vEdgePot;		///< Individual edge potentials: nEdges pointers to the tables in m_vEdgePotPool, or to m_vZeroPot for the edges without individual potentials
+		std::vector<vec_float_t> m_vEdgePotPool;	///< Pool of the individual edge potentials: pages of nStates x nStates tables
+		size_t				m_nPoolFree	= 0;	///< Number of free tables in the last page of the pool
+		vec_float_t			m_vZeroPot;			///< Zero potentials: nStates x nStates
+		std::mutex			m_mtxEdgePot;		///< Mutex for allocation of the individual edge potentials
+		vec_size_t			m_vEdgeNode1;		///< First (source) node of the edge
+		vec_size_t			m_vEdgeNode2;		///< Second (destination) node of the edge
+		vec_byte_t			m_vEdgeGroup;		///< ID of the group, to which the edge belongs
+		vec_byte_t			m_vEdgeIsSet;		///< Flags indicating whether the edge potentials are set
+		vec_byte_t			m_vEdgeIsShared;	///< Flags indicating whether the edge refers to the shared potentials of its group
+		vec_byte_t			m_vEdgeIsPotts;		///< Flags indicating whether the edge potentials have the Potts form
+		vec_mat_t			m_vGroupPot;		///< Shared edge potentials of the edge groups: 256 x Mat(size: nStates x nStates; type: CV_32FC1)
+		std::vector<std::optional<DistancePot>>	m_vGroupDist;	///< Parameters of the shared truncated distance potentials of the edge groups: 256
+		vec_size_t			m_vEdgeNextTo;		///< Index of the next outgoing edge of the source node
+		vec_size_t			m_vEdgeNextFrom;	///< Index of the next incoming edge of the destination node
+		// CSR adjacency
+		size_t				m_topologyVersion	= 1;	///< Revision of the graph topology: incremented whenever the nodes or edges are added or removed
+		size_t				m_adjacencyVersion	= 0;	///< Revision of the graph topology, which the CSR adjacency arrays correspond to
+		vec_size_t			m_vToOffsets;		///< Offsets of the outgoing edge lists in m_vTo: nNodes + 1
+		vec_size_t			m_vTo;				///< Outgoing edges of all nodes
+		vec_size_t			m_vFromOffsets;		///< Offsets of the incoming edge lists in m_vFrom: nNodes + 1
+		vec_size_t			m_vFrom;			///< Incoming edges of all nodes
 	};
 }
 
@@ -93,7 +93,7 @@ namespace DirectGraphicalModels
 		* @brief Fills the graph edges with potentials
 		* @details This function uses \b edgeTrainer class in oerder to achieve edge potentials from feature vectors, stored in \b featureVectors
 		* and fills with them the graph edges
-		* > This function supports PPL
+		* > This function supports parallel computing
 		* @param edgeTrainer A pointer to the edge trainer
 		* @param featureVectors Multi-channel matrix, each element of which is a multi-dimensinal point: Mat(type: CV_8UC<nFeatures>)
 		* @param vParams Array of control parameters. Please refer to the concrete model implementation of the CTrainEdge::calculateEdgePotentials() function for more details
@@ -107,7 +107,7 @@ namespace DirectGraphicalModels
 		* @brief Fills the graph edges with potentials
 		* @details This function uses \b edgeTrainer class in oerder to achieve edge potentials from feature vectors, stored in \b featureVectors
 		* and fills with them the graph edges
-		* > This function supports PPL
+		* > This function supports parallel computing
 		* @param edgeTrainer A pointer to the edge trainer
 		* @param featureVectors  Vector of size \a nFeatures, each element of which is a single feature - image: Mat(type: CV_8UC1)
 		* @param vParams Array of control parameters. Please refer to the concrete model implementation of the CTrainEdge::calculateEdgePotentials() function for more details
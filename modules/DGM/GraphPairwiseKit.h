@@ -8,6 +8,7 @@
 
 #include "MessagePassing.h"
 #include "InferLBP.h"
+#include "InferRBP.h"
 #include "InferTRW.h"
 #include "InferViterbi.h"
 
@@ -21,7 +22,8 @@ namespace DirectGraphicalModels
 	enum class INFER { 
 		LBP,		///< Loopy Belief Propagation inference
 		TRW,		///< Convergent Tree-Reweighted inference
-		Viterbi		///< Viterbi inference
+		Viterbi,	///< Viterbi inference
+		RBP			///< Residual Belief Propagation inference
 	};
 
 	// ================================ Pairwise Graph Kit Class ===============================
@@ -45,6 +47,7 @@ namespace DirectGraphicalModels
 			switch (infer)
 			{
 			case INFER::LBP:	 m_pInfer = std::make_unique<CInferLBP>(m_graph); break;
+			case INFER::RBP:	 m_pInfer = std::make_unique<CInferRBP>(m_graph); break;
 			case INFER::TRW:	 m_pInfer = std::make_unique<CInferTRW>(m_graph); break;
 			case INFER::Viterbi: m_pInfer = std::make_unique<CInferViterbi>(m_graph); break;
 			default: DGM_ASSERT_MSG(false, "Unknown inference method");
@@ -29,5 +29,20 @@ namespace DirectGraphicalModels {
 		* will be the same size and type as the input one: Mat(size: nNodes x nStates; type: CV_32FC1)
 		*/
 		virtual void apply(const Mat &src, Mat &dst) const = 0;
+		/**
+		* @brief Applies an edge model to the node potentials of a dense graph in the log-domain
+		* @details This function calculates the logarithm of the result of apply() and adds it to the accumulator \b dst. 
+		* It allows to combine the messages from multiple edge models in one container without intermediate exponentiation. 
+		* The default implementation uses apply(); derived classes should override it with a direct calculation.
+		* @param[in] src The dense graph node potentials in form Mat(size: nNodes x nStates; type: CV_32FC1)
+		* @param[in,out] dst The accumulator for the log-messages: Mat(size: nNodes x nStates; type: CV_32FC1)
+		*/
+		virtual void applyLog(const Mat &src, Mat &dst) const
+		{
+			Mat tmp;
+			apply(src, tmp);
+			log(tmp, tmp);
+			dst += tmp;
+		}
 	};
 }
\ No newline at end of file
@@ -9,6 +9,13 @@
 namespace DirectGraphicalModels 
 {
 	class CGraph;
+
+	/// Statistics of the iterative inference
+	struct InferStats {
+		unsigned int	nIt			= 0;	///< The number of performed iterations
+		float			residual	= 0;	///< The residual of the last iteration: the largest change of a message (or of a node potential for the dense graphs)
+		double			msPerIt		= 0;	///< The average time of one iteration in milliseconds
+	};
 	
 	// ================================ Infer Class ===============================
 	/**
@@ -31,8 +38,8 @@ namespace DirectGraphicalModels
 		/**
 		* @brief Inference
 		* @details This function estimates the marginal potentials for each graph node, and stores them as node potentials
-		* > This function modifies Node::Pot containers of graph nodes
-		* @param nIt Number of iterations
+		* > This function modifies the node potentials of the graph
+		* @param nIt Number of iterations. The iterative algorithms stop earlier, if the residual of an iteration is below the tolerance (see setTolerance())
 		* @note This function must not to be linear, \a i.e. \f$ infer(\alpha\times N)\not\equiv\alpha\times infer(N) \f$
 		* @note This function substitutes the graph nodes' potentials with estimated marginal potentials
 		*/
@@ -41,7 +48,7 @@ namespace DirectGraphicalModels
 		* @brief Approximate decoding
 		* @details This function calls first inference @ref infer() and then, using resulting marginal probabilities, estimates the most
 		* probable configuration of states (classes) in the graph via CDecode::decode().
-		* > This function modifies Node::Pot containers of graph nodes
+		* > This function modifies the node potentials of the graph
 		* @param nIt Number of iterations
 		* @param lossMatrix (optional) The loss matrix \f$L\f$ (size: nStates x nStates; type: CV_32FC1).
 		* It must be a quadratic zero-diagonal matrix, whith all non-diagonal elements \f$L_{i,j} > 0, \forall i\neq j\f$.
@@ -72,6 +79,25 @@ namespace DirectGraphicalModels
 		* @return The potential values for each node of the graph.
 		*/
 		DllExport vec_float_t	getPotentials(byte state) const;
+		/**
+		* @brief Sets the convergence tolerance
+		* @details The iterative algorithms (\a e.g. CInferLBP, CInferTRW, CInferDense) stop before performing \b nIt iterations (see infer()), if the residual 
+		* of an iteration, \a i.e. the largest change of a message (or of a node potential for the dense graphs), is below the tolerance. 
+		* Thus the number of iterations in infer() may be generous, without paying for it on the graphs, which converge fast.
+		* @param tolerance The convergence tolerance. Zero value disables the early stopping.
+		*/
+		DllExport void			setTolerance(float tolerance) { m_tolerance = tolerance; }
+		/**
+		* @brief Returns the convergence tolerance
+		* @return The convergence tolerance
+		*/
+		DllExport float			getTolerance(void) const { return m_tolerance; }
+		/**
+		* @brief Returns the statistics of the last inference
+		* @details The statistics is collected only by the iterative algorithms
+		* @return The number of performed iterations, the residual of the last iteration and the average time of one iteration
+		*/
+		DllExport const InferStats& getStats(void) const { return m_stats; }
 
 
 	protected:
@@ -81,8 +107,13 @@ namespace DirectGraphicalModels
 		*/
 		CGraph& getGraph(void) const { return m_graph; }
 
+
+	protected:
+		InferStats	m_stats;					///< The statistics of the last inference
+
         
 	private:
 		CGraph & m_graph;
+		float	 m_tolerance = 0;			///< The convergence tolerance
 	};
 }
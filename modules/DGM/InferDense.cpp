@@ -1,22 +1,11 @@
 #include "InferDense.h"
 #include "IEdgeModel.h"
+#include "parallel.h"
+#include "macroses.h"
 
 namespace DirectGraphicalModels
 {
 	namespace {
-		template<typename T>
-		void normalize(const Mat &src, Mat dst) {
-			if(dst.empty()) dst = Mat(src.size(), src.type());
-			for (int y = 0; y < src.rows; y++) {
-				const T *pSrc = src.ptr<T>(y);
-				T *pDst = dst.ptr<T>(y);
-				T sum = 0;
-				for (int x = 0; x < src.cols; x++) sum += pSrc[x];
-				if (sum > DBL_EPSILON)
-					for (int x = 0; x < src.cols; x++) pDst[x] = pSrc[x] / sum;
-			} // y
-		}
-		
 		template<typename T>
 		void myexp(const Mat &src, Mat &dst)
 		{
@@ -33,32 +22,100 @@ namespace DirectGraphicalModels
 					pDst[x] = expf(pSrc[x] - max);
 			} // y
 		}
+
+		// dst = softmax(src) in one pass over the log-potentials src, which are overwritten; returns the largest absolute change of the elements of dst
+		float softmax(float *src, float *dst, int n)
+		{
+			// Find the max and subtract it so that the exp doesn't explode
+			float max = src[0];
+			for (int x = 1; x < n; x++)
+				if (src[x] > max) max = src[x];
+
+			float sum = 0;
+			for (int x = 0; x < n; x++) {
+				src[x] = expf(src[x] - max);
+				sum += src[x];
+			}
+
+			float res = 0;
+			for (int x = 0; x < n; x++) {
+				const float val = src[x] / sum;
+				res = MAX(res, std::abs(val - dst[x]));
+				dst[x] = val;
+			}
+			return res;
+		}
 	}
 	
 	void CInferDense::infer(unsigned int nIt)
 	{
 		// ====================================== Initialization ======================================
-		Mat nodePotentials	= getGraphDense().getNodePotentials();
-		Mat	nodePotentials0	= nodePotentials.clone();
-		Mat	temp			= Mat(nodePotentials.size(), nodePotentials.type());
-		Mat	tmp;
+		Mat			nodePotentials	= getGraphDense().getNodePotentials();		// Q: the marginals
+		const int	nNodes			= nodePotentials.rows;
+		const int	nStates			= nodePotentials.cols;
+		Mat			logPot0			= Mat(nodePotentials.size(), CV_32FC1);		// log of the unary potentials
+		Mat			acc				= Mat(nodePotentials.size(), CV_32FC1);		// accumulator for the log-messages
+		vec_float_t	vResidual(nNodes);
+
+		// The edge models are applied concurrently, every one into its own container
+		const auto	&vpEdgeModels	= getGraphDense().getEdgeModels();
+		const int	nModels			= static_cast<int>(vpEdgeModels.size());
+		vec_mat_t	vMsg(nModels > 1 ? nModels - 1 : 0);
+		for (Mat &msg : vMsg) msg = Mat(nodePotentials.size(), CV_32FC1);
+
+		for (int n = 0; n < nNodes; n++) {
+			const float *pPot		= nodePotentials.ptr<float>(n);
+			float		*pLogPot0	= logPot0.ptr<float>(n);
+			for (int s = 0; s < nStates; s++) pLogPot0[s] = logf(MAX(FLT_MIN, pPot[s]));
+		}
 
 		// =================================== Calculating potentials ==================================	
+		m_stats = InferStats();
+		int64 ticks = getTickCount();
+		logPot0.copyTo(acc);
+		for (int n = 0; n < nNodes; n++)
+			softmax(acc.ptr<float>(n), nodePotentials.ptr<float>(n), nStates);	// Q_0 = normalize(pot_0)
+
 		for (unsigned int i = 0; i < nIt; i++) {
 #ifdef DEBUG_PRINT_INFO
 			if (i == 0) printf("\n");
 			if (i % 5 == 0) printf("--- It: %d ---\n", i);
 #endif
-			normalize<float>(nodePotentials, nodePotentials);
-			
-			// Add up all pairwise potentials
-			temp.setTo(1);
-			for (auto &edgePotModel : getGraphDense().getEdgeModels()) {
-				edgePotModel->apply(nodePotentials, tmp);					// tmp = f(pot_i)
-				multiply(temp, tmp, temp);									// temp *= exp(tmp)
+			// Calculate all pairwise log-potentials: the first model adds to log pot_0 in acc, the others write to their own containers
+			logPot0.copyTo(acc);
+			for (Mat &msg : vMsg) msg.setTo(0);
+#ifdef ENABLE_PARALLEL
+			parallel::parallel_for(0, nModels, [&](int m) {
+#else
+			for (int m = 0; m < nModels; m++) {
+#endif
+				vpEdgeModels[m]->applyLog(nodePotentials, m == 0 ? acc : vMsg[m - 1]);	// acc += f(Q_i)
 			}
+#ifdef ENABLE_PARALLEL
+			);
+#endif
+
+			// Q_(i+1) = softmax(log pot_0 + sum f(Q_i))
+#ifdef ENABLE_PARALLEL
+			parallel::parallel_for(0, nNodes, [&](int n) {
+#else
+			for (int n = 0; n < nNodes; n++) {
+#endif
+				float *pAcc = acc.ptr<float>(n);
+				for (const Mat &msg : vMsg) {
+					const float *pMsg = msg.ptr<float>(n);
+					for (int s = 0; s < nStates; s++) pAcc[s] += pMsg[s];
+				}
+				vResidual[n] = softmax(pAcc, nodePotentials.ptr<float>(n), nStates);
+			}
+#ifdef ENABLE_PARALLEL
+			);
+#endif
 
-			multiply(nodePotentials0, temp, nodePotentials);				// pot_(i+1) = pot_0 * next
+			m_stats.nIt = i + 1;
+			m_stats.residual = nNodes ? *std::max_element(vResidual.begin(), vResidual.end()) : 0;
+			if (m_stats.residual < getTolerance()) break;
 		} // iter
+		m_stats.msPerIt = m_stats.nIt ? 1000.0 * (getTickCount() - ticks) / getTickFrequency() / m_stats.nIt : 0;
 	}
 }
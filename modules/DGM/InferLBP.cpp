@@ -1,40 +1,97 @@
 #include "InferLBP.h"
 #include "GraphPairwise.h"
+#include "parallel.h"
+#include "macroses.h"
 
 namespace DirectGraphicalModels
 {
 	void CInferLBP::calculateMessages(unsigned int nIt)
 	{
-		const byte		nStates = getGraph().getNumStates();				// number of states
+		if (m_checkerboard) {
+			calculateMessagesCheckerboard(nIt);
+			return;
+		}
+
+		CGraphPairwise	& graph		= getGraphPairwise();
+		const byte		  nStates	= graph.getNumStates();				// number of states
+		vec_float_t		  vResidual(graph.getNumNodes());					// the residuals of the messages, sent by each node
 		
 		// ======================== Main loop (iterative messages calculation) ========================
-#ifndef ENABLE_PPL
-		float *temp = new float[nStates];
-#endif
+		m_stats = InferStats();
 		for (unsigned int i = 0; i < nIt; i++) {								// iterations
 #ifdef DEBUG_PRINT_INFO
 			if (i == 0) printf("\n");
 			if (i % 5 == 0) printf("--- It: %d ---\n", i);
 #endif
-#ifdef ENABLE_PPL
-			concurrency::parallel_for_each(getGraphPairwise().m_vNodes.begin(), getGraphPairwise().m_vNodes.end(), [&, nStates](ptr_node_t &node) {		// all nodes
-				float *temp = new float[nStates];
+#ifdef ENABLE_PARALLEL
+			parallel::parallel_for(size_t(0), graph.getNumNodes(), [&, nStates](size_t n) {		// all nodes
 #else
-			std::for_each(getGraphPairwise().m_vNodes.begin(), getGraphPairwise().m_vNodes.end(), [&](ptr_node_t &node) {
+			for (size_t n = 0; n < graph.getNumNodes(); n++) {
 #endif
+				float temp[256];												// the number of states does not exceed 255
 				// Calculate a message to each neighbor
-				for (size_t e_t : node->to) {									// outgoing edges
-					Edge *edge_to = getGraphPairwise().m_vEdges[e_t].get();		// current outgoing edge
-					calculateMessage(*edge_to, temp, getMessageTemp(e_t), m_maxSum);
-				} // e_t;
-#ifdef ENABLE_PPL
-				delete[] temp;
-#endif
+				vResidual[n] = 0;
+				for (size_t e_t : graph.getToEdges(n)) {						// outgoing edges
+					calculateMessage(e_t, temp, getMessageTemp(e_t), m_maxSum);
+					vResidual[n] = MAX(vResidual[n], getResidual(getMessageTemp(e_t), getMessage(e_t), nStates));
+				}
+#ifdef ENABLE_PARALLEL
 			}); // nodes
+#else
+			} // nodes
+#endif
 			swapMessages();														// Coping data from msg_temp to msg
+
+			m_stats.nIt = i + 1;
+			m_stats.residual = vResidual.empty() ? 0 : *std::max_element(vResidual.begin(), vResidual.end());
+			if (m_stats.residual < getTolerance()) break;
 		} // iterations
-#ifndef ENABLE_PPL
-		delete[] temp;
+	}
+
+	// The nodes of one color are not connected with each other: the messages, sent by these nodes, depend only on the messages from the nodes
+	// of other colors, and may be updated in place in parallel
+	void CInferLBP::calculateMessagesCheckerboard(unsigned int nIt)
+	{
+		CGraphPairwise	& graph		= getGraphPairwise();
+		const byte		  nStates	= graph.getNumStates();				// number of states
+		
+		std::vector<vec_size_t> vvColorNodes;
+		graph.colorNodes(vvColorNodes);
+		vec_float_t		  vResidual(graph.getNumNodes());					// the residuals of the messages, sent by each node
+
+		// ======================== Main loop (iterative messages calculation) ========================
+		m_stats = InferStats();
+		for (unsigned int i = 0; i < nIt; i++) {								// iterations
+#ifdef DEBUG_PRINT_INFO
+			if (i == 0) printf("\n");
+			if (i % 5 == 0) printf("--- It: %d ---\n", i);
 #endif
+			for (const vec_size_t &vNodes : vvColorNodes) {						// colors
+#ifdef ENABLE_PARALLEL
+				parallel::parallel_for(size_t(0), vNodes.size(), [&, nStates](size_t k) {		// nodes of one color
+#else
+				for (size_t k = 0; k < vNodes.size(); k++) {
+#endif
+					float temp[256];											// the number of states does not exceed 255
+					float msg[256];
+					// Calculate a message to each neighbor
+					const size_t n = vNodes[k];
+					vResidual[n] = 0;
+					for (size_t e_t : graph.getToEdges(n)) {					// outgoing edges
+						calculateMessage(e_t, temp, msg, m_maxSum);
+						vResidual[n] = MAX(vResidual[n], getResidual(msg, getMessage(e_t), nStates));
+						memcpy(getMessage(e_t), msg, nStates * sizeof(float));
+					}
+#ifdef ENABLE_PARALLEL
+				}); // nodes
+#else
+				} // nodes
+#endif
+			} // colors
+
+			m_stats.nIt = i + 1;
+			m_stats.residual = vResidual.empty() ? 0 : *std::max_element(vResidual.begin(), vResidual.end());
+			if (m_stats.residual < getTolerance()) break;
+		} // iterations
 	}
 }
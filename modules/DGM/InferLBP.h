@@ -11,6 +11,11 @@ namespace DirectGraphicalModels
 	/**
 	* @ingroup moduleDecode
 	* @brief Sum product Loopy Belief Propagation inference class
+	* @details By default, the messages are updated with the synchronous (flooding) schedule: all new messages are calculated from the messages of the 
+	* previous iteration. With the checkerboard schedule (see setCheckerboard()), the nodes are split into the groups of independent nodes (\a e.g. 
+	* the "red" and "black" nodes of a 4-connected grid), and every iteration updates the messages, sent by the nodes of one group after another. 
+	* The messages are updated in place, thus only half of the message memory is needed, and the new messages are used in the same iteration, 
+	* what usually results in faster convergence.
 	* @author Sergey G. Kosov, sergey.kosov@project-10.de
 	*/
 	class CInferLBP : public CMessagePassing
@@ -20,18 +25,36 @@ namespace DirectGraphicalModels
 		* @brief Constructor
 		* @param graph The graph
 		*/			
-		DllExport CInferLBP(CGraphPairwise &graph) : CMessagePassing(graph), m_maxSum(false) {}
+		DllExport CInferLBP(CGraphPairwise &graph) : CMessagePassing(graph), m_maxSum(false), m_checkerboard(false) {}
 		DllExport virtual ~CInferLBP(void) = default;
 
+		/**
+		* @brief Sets the checkerboard schedule of the message updates
+		* @param checkerboard Flag indicating whether the checkerboard (true) or the synchronous (false) schedule should be applied
+		*/
+		DllExport void			setCheckerboard(bool checkerboard) { m_checkerboard = checkerboard; }
+		/**
+		* @brief Checks whether the checkerboard schedule of the message updates is applied
+		* @retval true if the checkerboard schedule is applied
+		* @retval false if the synchronous schedule is applied
+		*/
+		DllExport bool			isCheckerboard(void) const { return m_checkerboard; }
+
 
 	protected:
 		DllExport virtual void	calculateMessages(unsigned int nIt);
+		bool					isTempMessagesNeeded(void) const override { return !m_checkerboard; }
 		void					setMaxSum(bool maxSum) { m_maxSum = maxSum; }
-		bool					isMaxSum(void) const { return m_maxSum; }
+		bool					isMaxSum(void) const override { return m_maxSum; }
+
+
+	private:
+		void					calculateMessagesCheckerboard(unsigned int nIt);
 
 
 	private:
 		bool m_maxSum;			///< Flag indicating weather the max-sum LBP (Viterbi algorithm) should be applied
+		bool m_checkerboard;	///< Flag indicating weather the checkerboard schedule should be applied
 	};
 
 }
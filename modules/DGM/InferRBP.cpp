@@ -0,0 +1,144 @@
+#include "InferRBP.h"
+#include "GraphPairwise.h"
+#include "parallel.h"
+#include "random.h"
+#include "macroses.h"
+#include <queue>
+
+namespace DirectGraphicalModels
+{
+	namespace {
+		using entry_t = std::pair<float, size_t>;				// (residual, edge)
+
+		// Priority queue of the edges, ordered by their residuals
+		struct CResidualQueue {
+			std::priority_queue<entry_t>	queue;
+			std::mutex						mtx;
+		};
+	}
+
+	void CInferRBP::calculateMessages(unsigned int nIt)
+	{
+		CGraphPairwise	& graph		 = getGraphPairwise();
+		const byte		  nStates	 = graph.getNumStates();					// number of states
+		const size_t	  nNodes	 = graph.getNumNodes();
+		const size_t	  nEdges	 = graph.getNumEdges();
+		const size_t	  maxUpdates = static_cast<size_t>(nIt) * nEdges;
+		const float		  tolerance	 = getTolerance();
+
+#ifdef ENABLE_PARALLEL
+		const size_t	  nThreads	 = m_relaxed ? parallel::getNumThreads() : 1;
+#else
+		const size_t	  nThreads	 = 1;
+#endif
+		// With several threads: several queues per thread to reduce the contention, and the locks for the nodes,
+		// which protect the incoming messages of the node and the new outgoing messages with their residuals
+		const size_t					nQueues = nThreads > 1 ? 2 * nThreads : 1;
+		const size_t					nLocks	= nThreads > 1 ? MAX(1, MIN(nNodes, 4096)) : 1;
+		std::vector<CResidualQueue>		vQueues(nQueues);
+		std::vector<std::mutex>			vLocks(nLocks);
+		vec_float_t						vResidual(nEdges);					// the residuals of the new messages in msg_temp
+
+		auto push = [&](size_t edge, float residual) {
+			CResidualQueue &q = vQueues[nQueues > 1 ? random::u<size_t>(0, nQueues - 1) : 0];
+			std::lock_guard<std::mutex> lock(q.mtx);
+			q.queue.emplace(residual, edge);
+		};
+		// Takes the top entry of the better one of two random queues, or of any non-empty queue
+		auto pop = [&](entry_t &entry) {
+			size_t best = 0;
+			if (nQueues > 1) {
+				const size_t q1 = random::u<size_t>(0, nQueues - 1);
+				const size_t q2 = random::u<size_t>(0, nQueues - 1);
+				float top1 = -1, top2 = -1;
+				{ std::lock_guard<std::mutex> lock(vQueues[q1].mtx); if (!vQueues[q1].queue.empty()) top1 = vQueues[q1].queue.top().first; }
+				{ std::lock_guard<std::mutex> lock(vQueues[q2].mtx); if (!vQueues[q2].queue.empty()) top2 = vQueues[q2].queue.top().first; }
+				best = top1 >= top2 ? q1 : q2;
+			}
+			for (size_t k = 0; k < nQueues; k++) {
+				CResidualQueue &q = vQueues[(best + k) % nQueues];
+				std::lock_guard<std::mutex> lock(q.mtx);
+				if (!q.queue.empty()) {
+					entry = q.queue.top();
+					q.queue.pop();
+					return true;
+				}
+			}
+			return false;
+		};
+
+		// ====================================== Initialization ======================================
+#ifdef ENABLE_PARALLEL
+		parallel::parallel_for(size_t(0), nNodes, [&, nStates](size_t n) {
+#else
+		for (size_t n = 0; n < nNodes; n++) {
+#endif
+			float temp[256];													// the number of states does not exceed 255
+			for (size_t e_t : graph.getToEdges(n)) {
+				calculateMessage(e_t, temp, getMessageTemp(e_t));
+				vResidual[e_t] = getResidual(getMessageTemp(e_t), getMessage(e_t), nStates);
+			}
+		}
+#ifdef ENABLE_PARALLEL
+		);
+#endif
+		for (size_t e = 0; e < nEdges; e++)
+			if (vResidual[e] > tolerance) push(e, vResidual[e]);
+
+		// ======================== Main loop (prioritized messages calculation) ========================
+		std::atomic<size_t> nUpdates(0);
+		std::atomic<size_t> nBusy(0);											// number of threads, which may push new entries
+		auto worker = [&, nStates](size_t) {
+			float temp[256];
+			for (;;) {
+				nBusy++;
+				entry_t entry;
+				if (nUpdates >= maxUpdates || !pop(entry)) {
+					nBusy--;
+					if (nUpdates >= maxUpdates || nBusy == 0) break;			// all queues are empty and no thread may fill them
+					std::this_thread::yield();
+					continue;
+				}
+
+				const size_t srcNode = graph.m_vEdgeNode1[entry.second];
+				const size_t dstNode = graph.m_vEdgeNode2[entry.second];
+				std::mutex &srcLock = vLocks[srcNode % nLocks];
+				std::mutex &dstLock = vLocks[dstNode % nLocks];
+				if (&srcLock == &dstLock) srcLock.lock();
+				else std::lock(srcLock, dstLock);
+
+				if (vResidual[entry.second] == entry.first) {					// otherwise the entry is outdated
+					// Update the message
+					memcpy(getMessage(entry.second), getMessageTemp(entry.second), nStates * sizeof(float));
+					vResidual[entry.second] = 0;
+					nUpdates++;
+
+					// Recalculate the messages, which depend on the updated message
+					for (size_t e_t : graph.getToEdges(dstNode)) {
+						if (graph.m_vEdgeNode2[e_t] == srcNode) continue;
+						calculateMessage(e_t, temp, getMessageTemp(e_t));
+						vResidual[e_t] = getResidual(getMessageTemp(e_t), getMessage(e_t), nStates);
+						if (vResidual[e_t] > tolerance) push(e_t, vResidual[e_t]);
+					} // e_t
+				}
+
+				srcLock.unlock();
+				if (&srcLock != &dstLock) dstLock.unlock();
+				nBusy--;
+			}
+		};
+
+#ifdef ENABLE_PARALLEL
+		if (nThreads > 1) parallel::parallel_for(size_t(0), nThreads, worker);
+		else
+#endif
+		worker(0);
+
+		m_nUpdates = nUpdates;
+		m_stats.nIt = nEdges ? static_cast<unsigned int>((m_nUpdates + nEdges - 1) / nEdges) : 0;
+		m_stats.residual = vResidual.empty() ? 0 : *std::max_element(vResidual.begin(), vResidual.end());
+#ifdef DEBUG_PRINT_INFO
+		printf("\n%zu message updates (%.2f iterations)\n", m_nUpdates, nEdges ? static_cast<float>(m_nUpdates) / nEdges : 0.0f);
+#endif
+	}
+}
@@ -0,0 +1,65 @@
+// Residual Belief Propagation inference class interface
+#pragma once
+
+#include "MessagePassing.h"
+
+namespace DirectGraphicalModels
+{
+	// ==================== Residual Belief Propagation Infer Class ==================
+	/**
+	* @ingroup moduleDecode
+	* @brief Sum product Residual Belief Propagation inference class
+	* @details Instead of recalculating all the messages in every iteration, like CInferLBP does, this class keeps the residuals of the messages,
+	* \a i.e. the changes, which the messages would undergo if they were updated now, in a priority queue and always updates the message with the
+	* largest residual first. After an update, only the messages, which depend on the updated message, are recalculated. The inference stops, when
+	* all the residuals are below the tolerance (see setTolerance(), 1e-5 by default), thus the parts of the graph, which have already converged, cost nothing
+	* (G. Elidan, I. McGraw and D. Koller, "Residual Belief Propagation: Informed Scheduling for Asynchronous Message Passing", 2006).
+	*
+	* The relaxed variant (see setRelaxed()) updates the messages in parallel. The threads take the messages from several priority queues,
+	* thus the messages are updated only approximately in order of their residuals.
+	*/
+	class CInferRBP : public CMessagePassing
+	{
+	public:
+		/**
+		* @brief Constructor
+		* @param graph The graph
+		*/
+		DllExport CInferRBP(CGraphPairwise &graph) : CMessagePassing(graph) { setTolerance(1e-5f); }
+		DllExport virtual ~CInferRBP(void) = default;
+
+		/**
+		* @brief Sets the relaxed (multi-threaded) variant of the algorithm
+		* @details > This function has effect only with parallel computing (\b ENABLE_PPL or \b ENABLE_THREADPOOL options)
+		* @param relaxed Flag indicating whether the messages should be updated in parallel with relaxed priorities (true) or sequentially in
+		* exact order of their residuals (false)
+		*/
+		DllExport void		setRelaxed(bool relaxed) { m_relaxed = relaxed; }
+		/**
+		* @brief Checks whether the relaxed (multi-threaded) variant of the algorithm is applied
+		* @retval true if the messages are updated in parallel with relaxed priorities
+		* @retval false if the messages are updated sequentially in exact order of their residuals
+		*/
+		DllExport bool		isRelaxed(void) const { return m_relaxed; }
+		/**
+		* @brief Returns the number of message updates
+		* @return The number of message updates, performed during the last inference
+		*/
+		DllExport size_t	getNumUpdates(void) const { return m_nUpdates; }
+
+
+	protected:
+		/**
+		* @brief Calculates the messages
+		* @details The number of performed updates divided by \a nEdges is reported as the number of iterations in m_stats
+		* @param nIt The maximal number of iterations: the inference stops after \b nIt x \a nEdges message updates, even if the messages have not converged
+		*/
+		DllExport virtual void	calculateMessages(unsigned int nIt);
+		bool					isTempMessagesNeeded(void) const override { return true; }
+
+
+	private:
+		bool	m_relaxed	= false;	///< Flag indicating weather the relaxed variant of the algorithm should be applied
+		size_t	m_nUpdates	= 0;		///< The number of message updates, performed during the last inference
+	};
+}
@@ -6,36 +6,39 @@ namespace DirectGraphicalModels
 {
 	void CInferTRW::infer(unsigned int nIt)
 	{
-		const byte nStates = getGraph().getNumStates();					// number of states (classes)
+		CGraphPairwise	& graph		= getGraphPairwise();
+		const byte		  nStates	= graph.getNumStates();					// number of states (classes)
+		DGM_IF_WARNING(isLogDomain(), "The log-domain is not supported by the algorithm.");
 
 		// ====================================== Initialization ======================================			
+		graph.buildAdjacency();
 		createMessages(1.0f);
 
 		// =================================== Calculating messages ==================================	
 
+		int64 ticks = getTickCount();
 		calculateMessages(nIt);
+		m_stats.msPerIt = m_stats.nIt ? 1000.0 * (getTickCount() - ticks) / getTickFrequency() / m_stats.nIt : 0;
 
 		// =================================== Calculating beliefs ===================================	
 
-		for (ptr_node_t &node : getGraphPairwise().m_vNodes) {
+		for (size_t n = 0; n < graph.getNumNodes(); n++) {
+			float *pot = graph.getNodePot(n);
 			// backward edges
-			for (size_t e_f : node->from) {
-				Edge * edge_from = getGraphPairwise().m_vEdges[e_f].get();
-				if (edge_from->node1 > edge_from->node2) continue;
-				Node *src = getGraphPairwise().m_vNodes[edge_from->node1].get();
-				for (byte s = 0; s < nStates; s++) node->Pot.at<float>(s, 0) *= edge_from->Pot.at<float>(src->sol, s);
+			for (size_t e_f : graph.getFromEdges(n)) {
+				size_t src = graph.m_vEdgeNode1[e_f];
+				if (src > n) continue;
+				const float *pPot = graph.getEdgePot(e_f) + graph.m_vNodeSol[src] * nStates;		// row src.sol of edge_from.Pot
+				for (byte s = 0; s < nStates; s++) pot[s] *= pPot[s];
 			}
 			// forward edges
-			for (size_t e_t : node->to) {
-				Edge *edge_to = getGraphPairwise().m_vEdges[e_t].get();
-				if (edge_to->node1 > edge_to->node2) continue;
+			for (size_t e_t : graph.getToEdges(n)) {
+				if (n > graph.m_vEdgeNode2[e_t]) continue;
 				float *msg = getMessage(e_t);
-				for (byte s = 0; s < nStates; s++) node->Pot.at<float>(s, 0) *= msg[s];
+				for (byte s = 0; s < nStates; s++) pot[s] *= msg[s];
 			}
 
-			Point extremumLoc;
-			minMaxLoc(node->Pot, NULL, NULL, NULL, &extremumLoc);
-			node->sol = static_cast<byte> (extremumLoc.y);
+			graph.m_vNodeSol[n] = static_cast<byte>(std::max_element(pot, pot + nStates) - pot);
 		}
 
 		deleteMessages();
@@ -43,33 +46,40 @@ namespace DirectGraphicalModels
 
 	void CInferTRW::calculateMessages(unsigned int nIt)
 	{
-		const    byte	  nStates	= getGraph().getNumStates();										// number of states
-		float			* data		= new float[nStates];
-		float			* temp		= new float[nStates];
+		CGraphPairwise	& graph		= getGraphPairwise();
+		const    byte	  nStates	= graph.getNumStates();												// number of states
+		const	 size_t	  nNodes	= graph.getNumNodes();												// number of nodes
+		const	 size_t	  nEdges	= graph.getNumEdges();												// number of edges
+		vec_float_t		  data(nStates);
+		vec_float_t		  temp(nStates);
+		// Both passes update the same messages with different data: the residual is measured between the messages of two successive iterations,
+		// which are copied only for the early stopping
+		const	 bool	  earlyStopping = getTolerance() > 0;
+		vec_float_t		  vPrev(earlyStopping ? nEdges * nStates : 0);
 
 		// main loop
+		m_stats = InferStats();
 		for (unsigned int i = 0; i < nIt; i++) {										// iterations
+			if (earlyStopping && nEdges) memcpy(vPrev.data(), getMessage(0), nEdges * nStates * sizeof(float));
 	#ifdef DEBUG_PRINT_INFO
 			if (i == 0) printf("\n");
 			if (i % 5 == 0) printf("--- It: %d ---\n", i);
 	#endif
 			// Forward pass
-			std::for_each(getGraphPairwise().m_vNodes.begin(), getGraphPairwise().m_vNodes.end(), [&](ptr_node_t &node) {
-				memcpy(data, node->Pot.data, nStates * sizeof(float));					// data = node.pot
+			for (size_t n = 0; n < nNodes; n++) {
+				memcpy(data.data(), graph.getNodePot(n), nStates * sizeof(float));		// data = node.pot
 
 				int	nForward = 0;
-				for (size_t e_t : node->to) {
-					Edge *edge_to = getGraphPairwise().m_vEdges[e_t].get();
-					if (edge_to->node1 > edge_to->node2) continue;
+				for (size_t e_t : graph.getToEdges(n)) {
+					if (n > graph.m_vEdgeNode2[e_t]) continue;
 					float *msg = getMessage(e_t);
 					for (byte s = 0; s < nStates; s++) data[s] *= msg[s];				// data = node.pot * edge_to.msg
 					nForward++;
 				} // e_t
 			
 				int	nBackward = 0;
-				for (size_t e_f : node->from) {
-					Edge *edge_from = getGraphPairwise().m_vEdges[e_f].get();
-					if (edge_from->node1 > edge_from->node2) continue;
+				for (size_t e_f : graph.getFromEdges(n)) {
+					if (graph.m_vEdgeNode1[e_f] > n) continue;
 					float *msg = getMessage(e_f);
 					for (byte s = 0; s < nStates; s++) data[s] *= msg[s];				// data = node.pot * edge_to.msg * edge_from.msg
 					nBackward++;
@@ -78,29 +88,25 @@ namespace DirectGraphicalModels
 				for (byte s = 0; s < nStates; s++) data[s] = static_cast<float>(fastPow(data[s], 1.0f / MAX(nForward, nBackward)));
 
 				// pass messages from i to nodes with higher m_ordering
-				for (size_t e_t : node->to) {
-					Edge *edge_to = getGraphPairwise().m_vEdges[e_t].get();
-					if (edge_to->node1 < edge_to->node2) calculateMessage(getMessage(e_t), *edge_to, temp, data);
-				} // e_t
-			});
+				for (size_t e_t : graph.getToEdges(n))
+					if (n < graph.m_vEdgeNode2[e_t]) calculateMessage(getMessage(e_t), e_t, temp.data(), data.data());
+			}
 
 			// Backward pass
-			std::for_each(getGraphPairwise().m_vNodes.rbegin(), getGraphPairwise().m_vNodes.rend(), [&](ptr_node_t &node) {
-				memcpy(data, node->Pot.data, nStates * sizeof(float));							// data = node.pot
+			for (size_t n = nNodes; n-- > 0; ) {
+				memcpy(data.data(), graph.getNodePot(n), nStates * sizeof(float));				// data = node.pot
 
 				int	nForward = 0;
-				for (size_t e_t : node->to) {
-					Edge *edge_to = getGraphPairwise().m_vEdges[e_t].get();
-					if (edge_to->node1 > edge_to->node2) continue;
+				for (size_t e_t : graph.getToEdges(n)) {
+					if (n > graph.m_vEdgeNode2[e_t]) continue;
 					float *msg = getMessage(e_t);
 					for (byte s = 0; s < nStates; s++) data[s] *= msg[s];
 					nForward++;
 				} // e_t
 			
 				int	nBackward = 0;
-				for (size_t e_f : node->from) {
-					Edge *edge_from = getGraphPairwise().m_vEdges[e_f].get();
-					if (edge_from->node1 > edge_from->node2) continue;
+				for (size_t e_f : graph.getFromEdges(n)) {
+					if (graph.m_vEdgeNode1[e_f] > n) continue;
 					float *msg = getMessage(e_f);
 					for (byte s = 0; s < nStates; s++) data[s] *= msg[s];
 					nBackward++;
@@ -113,26 +119,33 @@ namespace DirectGraphicalModels
 				for (byte s = 0; s < nStates; s++) data[s] = static_cast<float>(fastPow(data[s], 1.0f / MAX(nForward, nBackward)));
 
 				// pass messages from i to nodes with smaller m_ordering
-				for (size_t e_f : node->from) {
-					Edge *edge_from = getGraphPairwise().m_vEdges[e_f].get();
-					if (edge_from->node1 < edge_from->node2) calculateMessage(getMessage(e_f), *edge_from, temp, data);
-				} // e_f
-			}); // All Nodes
+				for (size_t e_f : graph.getFromEdges(n))
+					if (graph.m_vEdgeNode1[e_f] < n) calculateMessage(getMessage(e_f), e_f, temp.data(), data.data());
+			} // All Nodes
+
+			m_stats.nIt = i + 1;
+			if (!earlyStopping) continue;
+			m_stats.residual = 0;
+			for (size_t e = 0; e < nEdges; e++)
+				m_stats.residual = MAX(m_stats.residual, getResidual(getMessage(e), vPrev.data() + e * nStates, nStates));
+			if (m_stats.residual < getTolerance()) break;
 		} // iterations
-
-		delete[] data;
-		delete[] temp;
 	}
 
 	// Updates edge->msg = F(data, edge.Pot)
-	void CInferTRW::calculateMessage(float *msg, Edge &edge, float *temp, float *data)
+	void CInferTRW::calculateMessage(float *msg, size_t edge, float *temp, float *data)
 	{
-		const byte nStates = getGraph().getNumStates();
+		const byte	  nStates	= getGraph().getNumStates();
+		const float * pEdgePot	= getGraphPairwise().getEdgePot(edge);
 
 		for (byte s = 0; s < nStates; s++) temp[s] = data[s] / MAX(FLT_EPSILON, msg[s]); 				// tmp = gamma * data / edge.msg
 
-		for (byte y = 0; y < nStates; y++) {
-			float *pPot = edge.Pot.ptr<float>(y);
+		if (getGraphPairwise().isEdgePotts(edge))
+			MaxProductPotts(pEdgePot, nStates, temp, msg);											// msg[y] = max(tmp[y] * edge.Pot(y, y), max_{x != y}(tmp[x]) * edge.Pot(y, x))
+		else if (const CGraphPairwise::DistancePot *pDist = getGraphPairwise().getEdgeDistance(edge))
+			DistanceTransform(temp, nStates, pDist->dist, pDist->lambda, pDist->truncation, msg);				// msg[y] = max_x(tmp[x] * edge.Pot(y, x))
+		else for (byte y = 0; y < nStates; y++) {
+			const float *pPot = pEdgePot + y * nStates;
 			float max = temp[0] * pPot[0];																// vMin = tmp + edge.Pot(0, kdest)
 			for (byte x = 1; x < nStates; x++) {
 				float val = temp[x] * pPot[x];
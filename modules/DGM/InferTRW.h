@@ -6,14 +6,13 @@
 
 namespace DirectGraphicalModels
 {
-	struct Edge;
-	
 	// ==================== Microsoft TRW Decode Class ==================
 	/**
 	* @ingroup moduleDecode
 	* @brief Tree-reweighted inference class
 	* @details This class is based on the Tree-reweighted message passing algorithm (a modification of a max-poduct LBP algorithm), 
 	* described in the paper <a href="http://pub.ist.ac.at/~vnk/papers/TRW-S-PAMI.pdf" target="_blank">Convergent Tree-reweighted Message Passing for Energy Minimization</a>
+	* @note The residual is measured with a copy of all messages, thus it is measured (and reported in getStats()) only when the early stopping is enabled with setTolerance()
 	* @author Sergey G. Kosov, sergey.kosov@project-10.de
 	*/
 	class CInferTRW : public CMessagePassing
@@ -31,6 +30,6 @@ namespace DirectGraphicalModels
 
 	protected:
 		DllExport virtual void	calculateMessages(unsigned int nIt);
-		void					calculateMessage(float* msg, Edge& edge, float* temp, float* data);
+		void					calculateMessage(float* msg, size_t edge, float* temp, float* data);
 	};
 }
@@ -172,6 +172,12 @@ namespace DirectGraphicalModels
         return m_alpha;
 	}
 
+	void CKDGauss::precompute(void)
+	{
+		getSigmaInv();
+		getAlpha();
+	}
+
 	double CKDGauss::getValue(const Mat& x, Mat &X, Mat &p1, Mat &p2) const
 	{
 		// Assertions
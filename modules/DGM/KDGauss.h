@@ -144,6 +144,13 @@ namespace DirectGraphicalModels
 		*/
 		DllExport long double	getAlpha(void) const;
 		/**
+		* @brief Precomputes \f$\Sigma^{-1}\f$ and \f$\alpha\f$
+		* @details These values are otherwise evaluated lazily on the first call of getAlpha(), getValue() or getMahalanobisDistance().
+		* After this function is called, these methods do not modify the object and thus may be called concurrently from multiple threads.
+		* The precomputed values are reset by any further modification of the Gaussian distribution.
+		*/
+		DllExport void			precompute(void);
+		/**
 		* @brief Returns unscaled value of the Gaussian function
 		* @details This function returns unscaled value of the Gaussian function, \a i.e. \f$ \exp\big( -\frac{1}{2}(x-\mu)^T\Sigma^{-1}(x-\mu)\big) \f$. In order to
 		* get the value of \f$ \mathcal{N}_k(\mu,\Sigma) \f$, the output of this function must be multiplied with \f$ \alpha \f$ from the getAlpha() function.
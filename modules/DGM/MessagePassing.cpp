@@ -1,91 +1,208 @@
 #include "MessagePassing.h"
 #include "GraphPairwise.h"
+#include "parallel.h"
+#include "simd.h"
 #include "macroses.h"
+#include <unordered_map>
 
 namespace DirectGraphicalModels
 {
+	namespace {
+		const float MAX_ENERGY = -logf(FLT_MIN);															// energy of the smallest normalized potential
+
+		// Returns the energy of the potential; the zero potentials get the largest finite energy
+		inline float energy(float pot) { return -logf(MAX(FLT_MIN, pot)); }
+
+		// dst[x] = min_y(f[y] + lambda * (x - y)^2): the lower envelope of parabolas
+		void lowerEnvelope(const float* f, byte size, float lambda, float* dst)
+		{
+			float	z[257];																			// boundaries between the parabolas
+			byte	idx[256];																		// locations of the parabolas in the lower envelope
+			auto intersect = [&](int q, int p) { return ((f[q] + lambda * q * q) - (f[p] + lambda * p * p)) / (2 * lambda * (q - p)); };
+
+			int k = 0;
+			idx[0] = 0;
+			z[0] = -FLT_MAX;
+			z[1] = FLT_MAX;
+			for (int q = 1; q < size; q++) {
+				float s = intersect(q, idx[k]);
+				while (s <= z[k]) s = intersect(q, idx[--k]);
+				k++;
+				idx[k] = static_cast<byte>(q);
+				z[k] = s;
+				z[k + 1] = FLT_MAX;
+			} // q
+			k = 0;
+			for (int x = 0; x < size; x++) {
+				while (z[k + 1] < x) k++;
+				const float d = static_cast<float>(x - idx[k]);
+				dst[x] = f[idx[k]] + lambda * d * d;
+			} // x
+		}
+	}
+
 	void CMessagePassing::infer(unsigned int nIt)
 	{
-		const byte   nStates = getGraph().getNumStates();
+		CGraphPairwise	& graph		= getGraphPairwise();
+		const byte		  nStates	= graph.getNumStates();
 
 		// ====================================== Initialization ======================================
-		createMessages(1.0f / nStates);				// msg[] = 1 / nStates; msg_temp[] = 1 / nStates;
+		graph.buildAdjacency();
+		if (m_logDomain) {
+			createMessages(0.0f, isTempMessagesNeeded());						// msg[] = -log(1); msg_temp[] = -log(1)
+			for (float &pot : graph.m_vNodePot) pot = energy(pot);				// the node potentials are replaced with the energies
+			if (isMaxSum()) createEdgeEnergies();
+		} 
+		else createMessages(1.0f / nStates, isTempMessagesNeeded());			// msg[] = 1 / nStates; msg_temp[] = 1 / nStates;
 
 		// =================================== Calculating messages ==================================
+		int64 ticks = getTickCount();
 		calculateMessages(nIt);
+		m_stats.msPerIt = m_stats.nIt ? 1000.0 * (getTickCount() - ticks) / getTickFrequency() / m_stats.nIt : 0;
 
 		// =================================== Calculating beliefs ===================================
-#ifdef ENABLE_PPL
-		concurrency::parallel_for_each(getGraphPairwise().m_vNodes.begin(), getGraphPairwise().m_vNodes.end(), [&, nStates](ptr_node_t &node) {
+#ifdef ENABLE_PARALLEL
+		parallel::parallel_for(size_t(0), graph.getNumNodes(), [&, nStates](size_t n) {
 #else
-		std::for_each(getGraphPairwise().m_vNodes.begin(), getGraphPairwise().m_vNodes.end(), [&,nStates](ptr_node_t &node) {
+		for (size_t n = 0; n < graph.getNumNodes(); n++) {
 #endif
-			for (size_t e_f : node->from) {
-				float *msg = getMessage(e_f);				// message of current incoming edge
-				float epsilon = FLT_EPSILON;
-				for (byte s = 0; s < nStates; s++) { 		// states
-					// node->Pot.at<float>(s,0) *= msg[s];
-					node->Pot.at<float>(s, 0) = (epsilon + node->Pot.at<float>(s, 0)) * (epsilon + msg[s]);		// Soft multiplication
-				} //s
-			} // e_f
+			float *pot = graph.getNodePot(n);
+			if (m_logDomain) {
+				for (size_t e_f : graph.getFromEdges(n))
+					simd::add(pot, getMessage(e_f), nStates);						// energy = energy + msg
+				
+				// Conversion to the potentials: the smallest energy gets the potential 1, thus the sum may not underflow
+				const float minEnergy = *std::min_element(pot, pot + nStates);
+				for (byte s = 0; s < nStates; s++) pot[s] = pot[s] - minEnergy < MAX_ENERGY ? expf(minEnergy - pot[s]) : 0.0f;
+				simd::div(pot, simd::sum(pot, nStates), nStates);
+			}
+			else {
+				for (size_t e_f : graph.getFromEdges(n))
+					simd::softMul(pot, getMessage(e_f), FLT_EPSILON, nStates);	// pot = (epsilon + pot) * (epsilon + msg): soft multiplication
 			
-			// Normalization
-			float SUM_pot = 0;
-			for (byte s = 0; s < nStates; s++)				// states
-				SUM_pot += node->Pot.at<float>(s, 0);
-			for (byte s = 0; s < nStates; s++) {			// states
-				node->Pot.at<float>(s, 0) /= SUM_pot;
-				DGM_ASSERT_MSG(!std::isnan(node->Pot.at<float>(s, 0)), "The lower precision boundary for the potential of the node %zu is reached.\n \
-						SUM_pot = %f\n", node->id, SUM_pot);
+				// Normalization
+				float SUM_pot = simd::sum(pot, nStates);
+				// the potentials are positive, thus pot / SUM_pot is NaN only if SUM_pot is not finite
+				DGM_ASSERT_MSG(std::isfinite(SUM_pot) && SUM_pot > 0, "The lower precision boundary for the potential of the node %zu is reached.\n \
+						SUM_pot = %f\n", n, SUM_pot);
+				simd::div(pot, SUM_pot, nStates);
 			}
-		});
+		}
+#ifdef ENABLE_PARALLEL
+		);
+#endif
 
 		deleteMessages();
+		m_vEdgeEnergy.clear();
+		m_vEdgeEnergy.shrink_to_fit();
 	}
 
 	// dst: usually edge msg or edge msg_temp
-	void CMessagePassing::calculateMessage(const Edge& edge_to, float* temp, float* dst, bool maxSum)
+	void CMessagePassing::calculateMessage(size_t e_t, float* temp, float* dst, bool maxSum)
 	{
-		Node		* node = getGraphPairwise().m_vNodes[edge_to.node1].get();		// source node
-		const byte	  nStates = getGraph().getNumStates();							// number of states
+		if (m_logDomain) {
+			calculateMessageLog(e_t, temp, dst, maxSum);
+			return;
+		}
+
+		CGraphPairwise	& graph		= getGraphPairwise();
+		const size_t	  srcNode	= graph.m_vEdgeNode1[e_t];							// source node
+		const size_t	  dstNode	= graph.m_vEdgeNode2[e_t];							// destination node
+		const byte		  nStates	= graph.getNumStates();								// number of states
 
 		// Compute temp = product of all incoming msgs except e_t
-		for (byte s = 0; s < nStates; s++) temp[s] = node->Pot.at<float>(s, 0);		// temp = node.Pot
-
-		for (size_t e_f : node->from) {												// incoming edges
-			Edge *edge_from = getGraphPairwise().m_vEdges[e_f].get();				// current incoming edge
-			if (edge_from->node1 != edge_to.node2) {
-				float *msg = getMessage(e_f);										// message of current incoming edge
-				for (byte s = 0; s < nStates; s++)
-					temp[s] *= msg[s];												// temp = temp * msg
-			}
-		} // e_f
+		memcpy(temp, graph.getNodePot(srcNode), nStates * sizeof(float));				// temp = node.Pot
+
+		for (size_t e_f : graph.getFromEdges(srcNode))									// incoming edges
+			if (graph.m_vEdgeNode1[e_f] != dstNode) 
+				simd::mul(temp, getMessage(e_f), nStates);								// temp = temp * msg
 
 		// Compute new message: new_msg = (edge_to.Pot^2)^t x temp
-		float Z = MatMul(edge_to.Pot, temp, dst, maxSum);
+		const CGraphPairwise::DistancePot *pDist = maxSum ? graph.getEdgeDistance(e_t) : NULL;
+		float Z;
+		if (graph.isEdgePotts(e_t))	Z = MatMulPotts(graph.getEdgePot(e_t), nStates, temp, dst, maxSum);
+		else if (pDist)				Z = DistanceTransform(temp, nStates, pDist->dist, 2 * pDist->lambda, pDist->truncation, dst);		// Pot^2 doubles the weight
+		else						Z = MatMul(graph.getEdgePot(e_t), nStates, temp, dst, maxSum);
 
 		// Normalization and setting new values
 		if (Z > FLT_EPSILON)
-			for (byte s = 0; s < nStates; s++)
-				dst[s] /= Z;
+			simd::div(dst, Z, nStates);
 		else
 			for (byte s = 0; s < nStates; s++)
 				dst[s] = 1.0f / nStates;
 	}
 
-	void CMessagePassing::createMessages(std::optional<float> val)
+	// dst: usually edge msg or edge msg_temp
+	void CMessagePassing::calculateMessageLog(size_t e_t, float* temp, float* dst, bool maxSum)
+	{
+		CGraphPairwise	& graph		= getGraphPairwise();
+		const size_t	  srcNode	= graph.m_vEdgeNode1[e_t];							// source node
+		const size_t	  dstNode	= graph.m_vEdgeNode2[e_t];							// destination node
+		const byte		  nStates	= graph.getNumStates();								// number of states
+
+		// Compute temp = sum of all incoming msgs except e_t
+		memcpy(temp, graph.getNodePot(srcNode), nStates * sizeof(float));				// temp = node.Energy
+
+		for (size_t e_f : graph.getFromEdges(srcNode))									// incoming edges
+			if (graph.m_vEdgeNode1[e_f] != dstNode)
+				simd::add(temp, getMessage(e_f), nStates);								// temp = temp + msg
+
+		// Compute new message
+		if (maxSum) {																	// new_msg = min_y(temp[y] + edge_to.Energy[y][x])
+			const CGraphPairwise::DistancePot *pDist = graph.getEdgeDistance(e_t);
+			if (graph.isEdgePotts(e_t))	MinSumPotts(graph.getEdgePot(e_t), nStates, temp, dst);
+			else if (pDist)				DistanceTransformLog(temp, nStates, pDist->dist, 2 * pDist->lambda, pDist->truncation, dst);		// Pot^2 doubles the weight
+			else						MinSum(getEdgeEnergy(e_t), nStates, temp, dst);
+		}
+		else {																			// new_msg = -log((edge_to.Pot^2)^t x exp(-temp))
+			// log-sum-exp: the energies are shifted by their minimum, thus the largest term of the sums is not smaller than the edge potential
+			// The terms below FLT_MIN are flushed to zero: the denormal numbers would slow down the multiplications
+			const float minEnergy = *std::min_element(temp, temp + nStates);
+			for (byte s = 0; s < nStates; s++) temp[s] = temp[s] - minEnergy < MAX_ENERGY ? expf(minEnergy - temp[s]) : 0.0f;
+			if (graph.isEdgePotts(e_t))	MatMulPotts(graph.getEdgePot(e_t), nStates, temp, dst);
+			else						MatMul(graph.getEdgePot(e_t), nStates, temp, dst);
+			for (byte s = 0; s < nStates; s++) dst[s] = energy(dst[s]);
+		}
+
+		// Normalization: the smallest energy is 0
+		const float minEnergy = *std::min_element(dst, dst + nStates);
+		for (byte s = 0; s < nStates; s++) dst[s] -= minEnergy;
+	}
+
+	void CMessagePassing::createEdgeEnergies(void)
+	{
+		CGraphPairwise	& graph		= getGraphPairwise();
+		const size_t	  nEdges	= graph.getNumEdges();
+		const size_t	  size		= static_cast<size_t>(graph.getNumStates()) * graph.getNumStates();
+
+		std::unordered_map<const float *, size_t> offsets;								// offsets of the energies of the potential tables
+		m_vEdgeEnergy.clear();
+		m_vEdgeEnergyOffset.assign(nEdges, 0);
+		for (size_t e = 0; e < nEdges; e++) {
+			if (graph.isEdgePotts(e) || graph.getEdgeDistance(e)) continue;
+			const float *pPot = graph.getEdgePot(e);
+			auto res = offsets.emplace(pPot, m_vEdgeEnergy.size());
+			if (res.second)																// new potential table
+				for (size_t i = 0; i < size; i++) m_vEdgeEnergy.push_back(2 * energy(pPot[i]));		// energy of Pot^2
+			m_vEdgeEnergyOffset[e] = res.first->second;
+		}
+	}
+
+	void CMessagePassing::createMessages(std::optional<float> val, bool temp)
 	{
 		const size_t nEdges = getGraph().getNumEdges();
 		const byte	nStates	= getGraph().getNumStates();
 		
 		m_msg = new float[nEdges * nStates];
 		DGM_ASSERT_MSG(m_msg, "Out of Memory");
-		m_msg_temp = new float[nEdges * nStates];
-		DGM_ASSERT_MSG(m_msg_temp, "Out of Memory");
+		if (temp) {
+			m_msg_temp = new float[nEdges * nStates];
+			DGM_ASSERT_MSG(m_msg_temp, "Out of Memory");
+		} else m_msg_temp = NULL;
 
 		if (val) {
 			std::fill(m_msg, m_msg + nEdges * nStates, val.value());
-			std::fill(m_msg_temp, m_msg_temp + nEdges * nStates, val.value());
+			if (m_msg_temp) std::fill(m_msg_temp, m_msg_temp + nEdges * nStates, val.value());
 		}
 	}
 
@@ -118,22 +235,145 @@ namespace DirectGraphicalModels
 		return m_msg_temp ? m_msg_temp + edge * getGraph().getNumStates() : NULL;
 	}
 
-	// dst = (M * M)^T x v
-	float CMessagePassing::MatMul(const Mat& M, const float* v, float* dst, bool maxSum)
+	float CMessagePassing::getResidual(const float* msg1, const float* msg2, byte nStates)
 	{
 		float res = 0;
+		for (byte s = 0; s < nStates; s++) res = MAX(res, fabsf(msg1[s] - msg2[s]));
+		return res;
+	}
+
+	// dst = (M * M)^T x v
+	float CMessagePassing::MatMul(const float* M, byte size, const float* v, float* dst, bool maxSum)
+	{
 		DGM_ASSERT(dst);
-		for (int x = 0; x < M.cols; x++) {
+		std::fill(dst, dst + size, 0.0f);
+		// Row-wise traversal: the matrix is read sequentially
+		for (byte y = 0; y < size; y++) {
+			if (maxSum) simd::sqrMulMax(dst, M + y * size, v[y], size);				// dst[x] = max(dst[x], v[y] * M[y][x]^2)
+			else		simd::sqrMulAdd(dst, M + y * size, v[y], size);				// dst[x] += v[y] * M[y][x]^2
+		} // y
+		
+		return simd::sum(dst, size);
+	}
+
+	// dst = (M * M)^T x v, where M has equal off-diagonal elements
+	float CMessagePassing::MatMulPotts(const float* M, byte size, const float* v, float* dst, bool maxSum)
+	{
+		DGM_ASSERT(dst);
+		const float c = M[1];																// off-diagonal element
+		if (maxSum) MaxProductPotts(M, size, v, dst, true);									// dst[x] = max(v[x] * M[x][x]^2, max_{y != x}(v[y]) * c^2)
+		else {
+			// dst[x] = v[x] * M[x][x]^2 + (sum(v) - v[x]) * c^2
 			float sum = 0;
-			for (int y = 0; y < M.rows; y++) {
-				float m = M.at<float>(y, x);
-				float prod = v[y] * m * m;
-				if (maxSum) { if (prod > sum) sum = prod; }
-				else sum += prod;
-			} // y
-			dst[x] = sum;
-			res += sum;
-		} // x
+			for (byte y = 0; y < size; y++) sum += v[y];
+			for (byte x = 0; x < size; x++) {
+				const float d = M[x * size + x];
+				dst[x] = v[x] * d * d + (sum - v[x]) * c * c;
+			} // x
+		}
+
+		return simd::sum(dst, size);
+	}
+
+	// dst[x] = max(v[x] * M[x][x], max_{y != x}(v[y]) * c), where c is the off-diagonal element
+	void CMessagePassing::MaxProductPotts(const float* M, byte size, const float* v, float* dst, bool square)
+	{
+		DGM_ASSERT(dst);
+		const float c = square ? M[1] * M[1] : M[1];										// off-diagonal element
+		byte  argmax1 = 0;
+		float max1 = v[0];
+		float max2 = 0;
+		for (byte y = 1; y < size; y++)
+			if (v[y] > max1) {
+				max2 = max1;
+				max1 = v[y];
+				argmax1 = y;
+			}
+			else if (v[y] > max2) max2 = v[y];
+		for (byte x = 0; x < size; x++) {
+			const float d = square ? M[x * size + x] * M[x * size + x] : M[x * size + x];
+			dst[x] = MAX(v[x] * d, (x == argmax1 ? max2 : max1) * c);
+		} // x
+	}
+
+	// dst[x] = max_y(v[y] * exp(-lambda * min(d(x, y), truncation)))
+	float CMessagePassing::DistanceTransform(const float* v, byte size, EdgeDistance dist, float lambda, float truncation, float* dst)
+	{
+		DGM_ASSERT(dst);
+		float vmax = 0;
+		for (byte y = 0; y < size; y++) if (v[y] > vmax) vmax = v[y];
+
+		if (dist == EdgeDistance::linear) {
+			// dst[x] = max(v[x], dst[x - 1] * a, dst[x + 1] * a)
+			const float a = expf(-lambda);
+			dst[0] = v[0];
+			for (int x = 1; x < size; x++) dst[x] = MAX(v[x], dst[x - 1] * a);								// forward pass
+			for (int x = size - 2; x >= 0; x--) dst[x] = MAX(dst[x], dst[x + 1] * a);						// backward pass
+		}
+		else if (lambda > 0) {
+			// dst[x] = exp(-min_y(f[y] + lambda * (x - y)^2)), where f = -log(v)
+			float f[256];
+			for (byte y = 0; y < size; y++) f[y] = energy(v[y]);
+			lowerEnvelope(f, size, lambda, dst);
+			for (byte x = 0; x < size; x++) dst[x] = expf(-dst[x]);
+		}
+		else std::copy(v, v + size, dst);
+
+		// Truncation: dst[x] = max(dst[x], max(v) * exp(-lambda * truncation))
+		const float t = vmax * expf(-lambda * truncation);
+		float res = 0;
+		for (byte x = 0; x < size; x++) {
+			if (dst[x] < t) dst[x] = t;
+			res += dst[x];
+		}
 		return res;
 	}
+
+	// dst[x] = min_y(v[y] + E[y][x])
+	void CMessagePassing::MinSum(const float* E, byte size, const float* v, float* dst)
+	{
+		DGM_ASSERT(dst);
+		std::fill(dst, dst + size, FLT_MAX);
+		// Row-wise traversal: the matrix is read sequentially
+		for (byte y = 0; y < size; y++)
+			simd::addMin(dst, E + y * size, v[y], size);										// dst[x] = min(dst[x], v[y] + E[y][x])
+	}
+
+	// dst[x] = min(v[x] + E[x][x], min_{y != x}(v[y]) + E_c), where E = -log(M * M) and E_c is the off-diagonal energy
+	void CMessagePassing::MinSumPotts(const float* M, byte size, const float* v, float* dst)
+	{
+		DGM_ASSERT(dst);
+		const float c = 2 * energy(M[1]);													// off-diagonal energy
+		byte  argmin1 = 0;
+		float min1 = v[0];
+		float min2 = FLT_MAX;
+		for (byte y = 1; y < size; y++)
+			if (v[y] < min1) {
+				min2 = min1;
+				min1 = v[y];
+				argmin1 = y;
+			}
+			else if (v[y] < min2) min2 = v[y];
+		for (byte x = 0; x < size; x++)
+			dst[x] = MIN(v[x] + 2 * energy(M[x * size + x]), (x == argmin1 ? min2 : min1) + c);
+	}
+
+	// dst[x] = min_y(v[y] + lambda * min(d(x, y), truncation))
+	void CMessagePassing::DistanceTransformLog(const float* v, byte size, EdgeDistance dist, float lambda, float truncation, float* dst)
+	{
+		DGM_ASSERT(dst);
+		if (dist == EdgeDistance::linear) {
+			// dst[x] = min(v[x], dst[x - 1] + lambda, dst[x + 1] + lambda)
+			dst[0] = v[0];
+			for (int x = 1; x < size; x++) dst[x] = MIN(v[x], dst[x - 1] + lambda);							// forward pass
+			for (int x = size - 2; x >= 0; x--) dst[x] = MIN(dst[x], dst[x + 1] + lambda);					// backward pass
+		}
+		else if (lambda > 0) lowerEnvelope(v, size, lambda, dst);
+		else std::copy(v, v + size, dst);
+
+		// Truncation: dst[x] = min(dst[x], min(v) + lambda * truncation)
+		const float t = *std::min_element(v, v + size) + lambda * truncation;
+		for (byte x = 0; x < size; x++)
+			if (dst[x] > t) dst[x] = t;
+	}
 }
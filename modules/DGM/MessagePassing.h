@@ -7,12 +7,14 @@
 
 namespace DirectGraphicalModels
 {
-	struct Edge;
-
 	// ==================== Message Passing Base Abstract Class ==================
 	/**
 	* @ingroup moduleDecode
 	* @brief Abstract base class for message passing inference algorithmes
+	* @details By default, the messages are calculated from the potentials with the products and normalized with the divisions, what may reach the 
+	* lower precision boundary with many states and high-degree nodes. In the log-domain (see setLogDomain()), the potentials are converted to the energies 
+	* \f$ -\log(pot) \f$, the products of the messages are replaced with the sums and the normalization - with the subtraction of the smallest energy. 
+	* The max-product algorithms become min-sum and the sum-product algorithms use the log-sum-exp, thus the messages may not underflow.
 	* @author Sergey G. Kosov, sergey.kosov@project-10.de
 	*/
 	class CMessagePassing : public CInfer
@@ -26,6 +28,19 @@ namespace DirectGraphicalModels
 		DllExport virtual ~CMessagePassing(void) = default;
 		
 		DllExport virtual void	  infer(unsigned int nIt = 1);
+		/**
+		* @brief Sets the log-domain calculation of the messages
+		* @details > CInferTRW does not support the log-domain
+		* @param logDomain Flag indicating whether the messages should be calculated with the energies in the log-domain (true) or with the 
+		* potentials (false)
+		*/
+		DllExport void			  setLogDomain(bool logDomain) { m_logDomain = logDomain; }
+		/**
+		* @brief Checks whether the messages are calculated in the log-domain
+		* @retval true if the messages are calculated with the energies in the log-domain
+		* @retval false if the messages are calculated with the potentials
+		*/
+		DllExport bool			  isLogDomain(void) const { return m_logDomain; }
 
 
 	protected:
@@ -37,23 +52,41 @@ namespace DirectGraphicalModels
 		/**
 		* @brief Calculates messages, associated with the edges of corresponding graphical model
 		* @details > This function may modify Edge::msg and Edge::msg_temp containers of graph edges
+		*
+		* The function must fill in the number of performed iterations and the residual of the last iteration in m_stats
 		* @param nIt Number of iterations
 		*/
 		virtual void calculateMessages(unsigned int nIt) = 0;
 		/**
 		* @brief Calculates one message for the specified edge \b edge
 		* @details > PPL-safe function.
-		* @param[in] edge Graph edge
+		* > The CSR adjacency arrays of the graph must be built with CGraphPairwise::buildAdjacency()
+		* @param[in] edge Index of the graph edge
 		* @param[in] temp Auxilary array of \b nStates values. Introduced for higher perfomance reasons.
-		* @param[out] dst Destination array for calculated message. Usually \b edge->msg or \b edge->msg_temp.
+		* @param[out] dst Destination array for calculated message. Usually getMessage(edge) or getMessageTemp(edge).
 		* @param[in] maxSum Flag indicating weather the message must be calculated according to the \a sum-product (false) or \a max-product (true) algorithm.
 		*/
-		void	calculateMessage(const Edge& edge, float* temp, float* dst, bool maxSum = false);
+		void	calculateMessage(size_t edge, float* temp, float* dst, bool maxSum = false);
+		/**
+		* @brief Checks whether the algorithm calculates the messages according to the \a max-product algorithm
+		* @details The log-domain edge energies are prepared only for the \a max-product (min-sum) algorithms
+		* @retval true if the messages are calculated according to the \a max-product algorithm
+		* @retval false otherwise (default)
+		*/
+		virtual bool isMaxSum(void) const { return false; }
+		/**
+		* @brief Checks whether the algorithm needs the temp messages
+		* @details The temp messages are needed for the synchronous schedules, which calculate the new messages from the old ones.
+		* @retval true if the temp messages must be allocated by createMessages()
+		* @retval false otherwise (default)
+		*/
+		virtual bool isTempMessagesNeeded(void) const { return false; }
 		/**
 		* @brief Allocates memory for Edge::msg and Edge::msg_temp containers for all edges in the graph
 		* @param val Default value to fill in the Edge::msg and Edge::msg_temp containers 
+		* @param temp Flag indicating whether the Edge::msg_temp container should be allocated
 		*/
-		void	createMessages(std::optional<float> val = std::nullopt);
+		void	createMessages(std::optional<float> val = std::nullopt, bool temp = false);
 		/**
 		* @brief Deletes memory for Edge::msg and Edge::msg_temp containers for all edges in the graph
 		*/
@@ -71,24 +104,126 @@ namespace DirectGraphicalModels
 		/**
 		* @brief Returns the pointer to the edge temp messages
 		* @param edge The %Edge index
-		* @return The pointer to the edge temp messages
+		* @return The pointer to the edge temp messages or \b NULL if the temp messages are not allocated
 		*/
 		float*	getMessageTemp(size_t edge);
 		/**
 		* @brief Specific matrix multiplication
 		* @details This function calculates the result of multiplying square of matrix \b M by vector \b v as following:
 		* \f$\vec{dst} = (M\cdot M)^\top\times\vec{v}\f$
-		* @param[in] M Matrix: Mat(size: \a M.height x \a M.width; type: CV_32FC1)
-		* @param[in] v Vector of length \a M.height
-		* @param[out] dst Resulting vector of length \a M.width.
+		* @param[in] M Square matrix of size \b size x \b size in row-major order
+		* @param[in] size The size of the matrix
+		* @param[in] v Vector of length \b size
+		* @param[out] dst Resulting vector of length \b size.
 		* @param[in] maxSum Flag indicating weather the \a max-sum multiplication should be performed
 		* @return The sum of all elemts in vector \b dst
 		*/
-		static float MatMul(const Mat& M, const float* v, float* dst, bool maxSum = false);
+		DllExport static float MatMul(const float* M, byte size, const float* v, float* dst, bool maxSum = false);
+		/**
+		* @brief Specific matrix multiplication for the Potts matrices
+		* @details This function calculates the same result as MatMul() in linear time, provided that all off-diagonal elements of the matrix \b M
+		* are equal (see CGraphPairwise::isEdgePotts())
+		* @param[in] M Square matrix of size \b size x \b size in row-major order
+		* @param[in] size The size of the matrix
+		* @param[in] v Vector of length \b size
+		* @param[out] dst Resulting vector of length \b size.
+		* @param[in] maxSum Flag indicating weather the \a max-sum multiplication should be performed
+		* @return The sum of all elemts in vector \b dst
+		*/
+		DllExport static float MatMulPotts(const float* M, byte size, const float* v, float* dst, bool maxSum = false);
+		/**
+		* @brief Max-product of the Potts matrix and a vector
+		* @details This function calculates \f$ dst[x] = \max(v[x]\cdot M[x][x], \max_{y\neq x}v[y]\cdot c) \f$ in linear time, where \f$ c \f$ is 
+		* the off-diagonal element of the Potts matrix \b M (see CGraphPairwise::isEdgePotts()), with the help of the two largest elements of \b v
+		* @param[in] M Square matrix of size \b size x \b size in row-major order
+		* @param[in] size The size of the matrix
+		* @param[in] v Vector of length \b size
+		* @param[out] dst Resulting vector of length \b size.
+		* @param[in] square Flag indicating weather the elements of the matrix \b M should be squared, \a i.e. \f$ M\cdot M \f$ should be used
+		*/
+		DllExport static void MaxProductPotts(const float* M, byte size, const float* v, float* dst, bool square = false);
+		/**
+		* @brief Max-product of the truncated distance matrix and a vector
+		* @details This function calculates \f$ dst[x] = \max_y v[y]\cdot e^{-\lambda\cdot\min(d(x, y), t)} \f$ in linear time using the distance transform 
+		* (see CGraphPairwise::setDistanceEdges()): the linear distance is propagated with one forward and one backward pass, and the quadratic distance - 
+		* with the lower envelope of parabolas in the log-domain (P. Felzenszwalb and D. Huttenlocher, "Efficient Belief Propagation for Early Vision", 2006)
+		* @param[in] v Vector of length \b size
+		* @param[in] size The size of the vector
+		* @param[in] dist The type of the distance \f$ d \f$
+		* @param[in] lambda The weight \f$ \lambda \f$ of the distance
+		* @param[in] truncation The truncation value \f$ t \f$ of the distance
+		* @param[out] dst Resulting vector of length \b size.
+		* @return The sum of all elemts in vector \b dst
+		*/
+		DllExport static float DistanceTransform(const float* v, byte size, EdgeDistance dist, float lambda, float truncation, float* dst);
+		/**
+		* @brief Returns the residual of a message
+		* @param msg1 The message of length \b nStates
+		* @param msg2 The other message of length \b nStates
+		* @param nStates The number of states
+		* @return The largest absolute difference between the elements of the messages
+		*/
+		DllExport static float getResidual(const float* msg1, const float* msg2, byte nStates);
+		/**
+		* @brief Min-sum product of the energy matrix and a vector
+		* @details This function is the log-domain counterpart of the \a max-product MatMul(): \f$ dst[x] = \min_y(v[y] + E[y][x]) \f$
+		* @param[in] E Square matrix of the edge energies of size \b size x \b size in row-major order
+		* @param[in] size The size of the matrix
+		* @param[in] v Vector of energies of length \b size
+		* @param[out] dst Resulting vector of length \b size.
+		*/
+		DllExport static void MinSum(const float* E, byte size, const float* v, float* dst);
+		/**
+		* @brief Min-sum product of the Potts matrix and a vector
+		* @details This function is the log-domain counterpart of the \a max-product MatMulPotts(): it calculates the same result as 
+		* MinSum() with the energies \f$ E = -\log(M\cdot M) \f$ in linear time
+		* @param[in] M Square matrix of the edge potentials of size \b size x \b size in row-major order
+		* @param[in] size The size of the matrix
+		* @param[in] v Vector of energies of length \b size
+		* @param[out] dst Resulting vector of length \b size.
+		*/
+		DllExport static void MinSumPotts(const float* M, byte size, const float* v, float* dst);
+		/**
+		* @brief Min-sum product of the truncated distance matrix and a vector
+		* @details This function is the log-domain counterpart of DistanceTransform(): \f$ dst[x] = \min_y(v[y] + \lambda\cdot\min(d(x, y), t)) \f$
+		* @param[in] v Vector of energies of length \b size
+		* @param[in] size The size of the vector
+		* @param[in] dist The type of the distance \f$ d \f$
+		* @param[in] lambda The weight \f$ \lambda \f$ of the distance
+		* @param[in] truncation The truncation value \f$ t \f$ of the distance
+		* @param[out] dst Resulting vector of length \b size.
+		*/
+		DllExport static void DistanceTransformLog(const float* v, byte size, EdgeDistance dist, float lambda, float truncation, float* dst);
+
+
+	private:
+		/**
+		* @brief Calculates one message for the specified edge \b edge in the log-domain
+		* @details The node potentials must be converted to the energies. The messages are normalized, such that their smallest energy is 0.
+		* @param[in] edge Index of the graph edge
+		* @param[in] temp Auxilary array of \b nStates values
+		* @param[out] dst Destination array for calculated message
+		* @param[in] maxSum Flag indicating weather the message must be calculated according to the \a sum-product (false) or \a max-product (true) algorithm.
+		*/
+		void	calculateMessageLog(size_t edge, float* temp, float* dst, bool maxSum);
+		/**
+		* @brief Calculates the energies of the edge potentials for the min-sum algorithm
+		* @details The edges, which share the potentials, share the energies as well. The Potts and the truncated distance edges need no energies.
+		*/
+		void	createEdgeEnergies(void);
+		/**
+		* @brief Returns the pointer to the edge energies
+		* @param edge The %Edge index
+		* @return The pointer to the \a nStates x \a nStates edge energies \f$ -\log(pot^2) \f$ (row-major order)
+		*/
+		const float * getEdgeEnergy(size_t edge) const { return m_vEdgeEnergy.data() + m_vEdgeEnergyOffset[edge]; }
 
 
 	private:
-		float	* m_msg;			///< Message: Mat(size: nStates x 1; type: CV_32FC1)
-		float	* m_msg_temp;		///< Temp Message: Mat(size: nStates x 1; type: CV_32FC1)
+		float		* m_msg					= NULL;		///< Message: Mat(size: nStates x 1; type: CV_32FC1)
+		float		* m_msg_temp			= NULL;		///< Temp Message: Mat(size: nStates x 1; type: CV_32FC1)
+		bool		  m_logDomain			= false;	///< Flag indicating weather the messages should be calculated in the log-domain
+		vec_float_t	  m_vEdgeEnergy;					///< Energies of the edge potentials (shared by the edges with shared potentials)
+		vec_size_t	  m_vEdgeEnergyOffset;				///< Offset of the energies of every edge in m_vEdgeEnergy
 	};
 }
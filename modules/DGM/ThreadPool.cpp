@@ -0,0 +1,180 @@
+#include "ThreadPool.h"
+#include "macroses.h"
+
+namespace DirectGraphicalModels { namespace parallel {
+	namespace {
+		thread_local const CThreadPool	* t_pPool	= NULL;		// The pool, which owns the current thread
+		thread_local int				  t_idx		= -1;		// Index of the current worker thread in its pool
+	}
+
+	// Constructor
+	CThreadPool::CThreadPool(size_t nThreads)
+	{
+		start(nThreads);
+	}
+
+	// Destructor
+	CThreadPool::~CThreadPool(void)
+	{
+		stop();
+	}
+
+	CThreadPool & CThreadPool::getInstance(void)
+	{
+		static CThreadPool pool;
+		return pool;
+	}
+
+	void CThreadPool::setNumThreads(size_t nThreads)
+	{
+		stop();
+		start(nThreads);
+	}
+
+	void CThreadPool::run(int first, int last, int grainSize, const std::function<void(int, int)> &fn)
+	{
+		const int size = last - first;
+		if (size <= 0) return;
+
+		if (grainSize <= 0) grainSize = MAX(1, size / static_cast<int>(4 * getNumThreads()));
+		if (m_vWorkers.empty() || grainSize >= size) {
+			fn(first, last);
+			return;
+		}
+
+		CRunState state;
+		for (int i = first + grainSize; i < last; i += grainSize) {
+			const int chunk_last = MIN(i + grainSize, last);
+			submit([&fn, i, chunk_last] { fn(i, chunk_last); }, state);
+		}
+		try {
+			fn(first, first + grainSize);											// the calling thread processes the first chunk
+		}
+		catch (...) {
+			state.setException(std::current_exception());
+		}
+		wait(state);																// the submitted chunks refer to fn and state
+		if (state.pException) std::rethrow_exception(state.pException);
+	}
+
+	void CThreadPool::run(const std::vector<task_t> &vTasks)
+	{
+		if (vTasks.empty()) return;
+		if (m_vWorkers.empty()) {
+			for (const task_t &task : vTasks) task();
+			return;
+		}
+
+		CRunState state;
+		for (size_t t = 1; t < vTasks.size(); t++)
+			submit(vTasks[t], state);
+		try {
+			vTasks[0]();															// the calling thread processes the first task
+		}
+		catch (...) {
+			state.setException(std::current_exception());
+		}
+		wait(state);
+		if (state.pException) std::rethrow_exception(state.pException);
+	}
+
+	// ------------------------------ PRIVATE ------------------------------
+	void CThreadPool::start(size_t nThreads)
+	{
+		if (nThreads == 0) nThreads = MAX(1, std::thread::hardware_concurrency());
+
+		m_stop = false;
+		m_nQueued = 0;
+		for (size_t i = 0; i < nThreads - 1; i++) m_vQueues.push_back(std::make_unique<CTaskQueue>());
+		for (size_t i = 0; i < nThreads - 1; i++) m_vWorkers.emplace_back(&CThreadPool::workerLoop, this, static_cast<int>(i));
+	}
+
+	void CThreadPool::stop(void)
+	{
+		{
+			std::lock_guard<std::mutex> lock(m_mtx);
+			m_stop = true;
+		}
+		m_cv.notify_all();
+		for (std::thread &worker : m_vWorkers) worker.join();
+		m_vWorkers.clear();
+		m_vQueues.clear();
+	}
+
+	void CThreadPool::CRunState::setException(std::exception_ptr pEx)
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		if (!pException) pException = pEx;
+	}
+
+	void CThreadPool::submit(task_t task, CRunState &state)
+	{
+		const size_t nQueues = m_vQueues.size();
+		const size_t idx = (t_pPool == this) ? static_cast<size_t>(t_idx) : m_next++ % nQueues;
+
+		state.pending++;
+		{
+			std::lock_guard<std::mutex> lock(m_mtx);
+			m_nQueued++;
+		}
+		{
+			std::lock_guard<std::mutex> lock(m_vQueues[idx]->mtx);
+			m_vQueues[idx]->tasks.emplace_back(std::move(task), &state);
+		}
+		m_cv.notify_one();
+	}
+
+	void CThreadPool::wait(CRunState &state)
+	{
+		const int idx = (t_pPool == this) ? t_idx : -1;
+		while (state.pending > 0)
+			if (!runPendingTask(idx)) std::this_thread::yield();
+	}
+
+	// Executes one task: either the newest from the own queue, or the oldest from the other queues
+	bool CThreadPool::runPendingTask(int idx)
+	{
+		const int nQueues = static_cast<int>(m_vQueues.size());
+		std::pair<task_t, CRunState *> task(nullptr, NULL);
+
+		if (idx >= 0) {
+			std::lock_guard<std::mutex> lock(m_vQueues[idx]->mtx);
+			if (!m_vQueues[idx]->tasks.empty()) {
+				task = std::move(m_vQueues[idx]->tasks.back());
+				m_vQueues[idx]->tasks.pop_back();
+			}
+		}
+		for (int k = 1; !task.first && k <= nQueues; k++) {							// work stealing
+			const int i = (MAX(0, idx) + k) % nQueues;
+			if (i == idx) continue;
+			std::lock_guard<std::mutex> lock(m_vQueues[i]->mtx);
+			if (!m_vQueues[i]->tasks.empty()) {
+				task = std::move(m_vQueues[i]->tasks.front());
+				m_vQueues[i]->tasks.pop_front();
+			}
+		}
+		if (!task.first) return false;
+
+		m_nQueued--;
+		try {
+			task.first();
+		}
+		catch (...) {																// the exception is rethrown by run() in the calling thread
+			task.second->setException(std::current_exception());
+		}
+		task.second->pending--;
+		return true;
+	}
+
+	void CThreadPool::workerLoop(int idx)
+	{
+		t_pPool = this;
+		t_idx	= idx;
+		for (;;) {
+			if (runPendingTask(idx)) continue;
+			std::unique_lock<std::mutex> lock(m_mtx);
+			m_cv.wait(lock, [this] { return m_stop || m_nQueued > 0; });
+			if (m_stop) return;
+		}
+	}
+} }
@@ -0,0 +1,110 @@
+// Portable work-stealing thread pool class interface
+#pragma once
+
+#include "types.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+namespace DirectGraphicalModels { namespace parallel {
+	// ================================ Thread Pool Class ================================
+	/**
+	* @brief Portable work-stealing thread pool
+	* @details This class is the backend for the parallel algorithms of the @ref parallel namespace, when the library is built with
+	* \b ENABLE_THREADPOOL option (\a i.e. without Microsoft PPL). Every worker thread owns a task queue: it takes the tasks from the back of its
+	* own queue and steals the tasks from the front of the other queues, when its own queue is empty. The threads waiting for a group of tasks
+	* to complete are executing the pending tasks meanwhile, thus the nested parallel calls (\a e.g. in parallel::sortRows()) do not deadlock.
+	*/
+	class CThreadPool
+	{
+	public:
+		using task_t = std::function<void(void)>;
+
+		/**
+		* @brief Constructor
+		* @param nThreads The number of threads, which execute the tasks, including the calling thread.
+		* If \b 0, the number of hardware threads is used.
+		*/
+		DllExport CThreadPool(size_t nThreads = 0);
+		DllExport CThreadPool(const CThreadPool&) = delete;
+		DllExport ~CThreadPool(void);
+
+		const CThreadPool& operator= (const CThreadPool&) = delete;
+
+		/**
+		* @brief Returns the global instance of the thread pool
+		* @return The global thread pool, which is used by the parallel algorithms
+		*/
+		DllExport static CThreadPool&	getInstance(void);
+		/**
+		* @brief Changes the number of threads
+		* @details This function stops all the worker threads and starts \b nThreads - 1 new worker threads.
+		* @warning This function must not be called while any parallel algorithm is running.
+		* @param nThreads The number of threads, which execute the tasks, including the calling thread.
+		* If \b 0, the number of hardware threads is used.
+		*/
+		DllExport void					setNumThreads(size_t nThreads);
+		/**
+		* @brief Returns the number of threads
+		* @return The number of threads, which execute the tasks, including the calling thread
+		*/
+		DllExport size_t				getNumThreads(void) const { return m_vWorkers.size() + 1; }
+		/**
+		* @brief Runs the function \b fn for each chunk of the range [\b first; \b last)
+		* @details The range is split into chunks of at least \b grainSize elements, which are distributed among the threads.
+		* The function returns when all the chunks are processed. If a chunk throws an exception, the first thrown exception is rethrown
+		* to the caller after all the other chunks are completed.
+		* @param first The first index of the range
+		* @param last The index, following the last index of the range
+		* @param grainSize The minimal number of indexes in one chunk. If \b 0, the chunk size is chosen automatically.
+		* @param fn The function to run with arguments \a (chunk_first, chunk_last)
+		*/
+		DllExport void					run(int first, int last, int grainSize, const std::function<void(int, int)> &fn);
+		/**
+		* @brief Runs the given tasks in parallel
+		* @details The function returns when all the tasks are completed. If a task throws an exception, the first thrown exception is rethrown
+		* to the caller after all the other tasks are completed.
+		* @param vTasks The tasks to run
+		*/
+		DllExport void					run(const std::vector<task_t> &vTasks);
+
+
+	private:
+		// State of one call of run(), shared by all its tasks
+		struct CRunState {
+			std::atomic<size_t>	pending		{ 0 };		// Number of the submitted tasks, which are not completed yet
+			std::exception_ptr	pException;				// The first exception, thrown by the tasks
+			std::mutex			mtx;					// Mutex for the exception
+
+			void	setException(std::exception_ptr pEx);
+		};
+		
+		struct CTaskQueue {
+			std::deque<std::pair<task_t, CRunState *>>	tasks;
+			std::mutex									mtx;
+		};
+
+
+	private:
+		void	start(size_t nThreads);
+		void	stop(void);
+		void	submit(task_t task, CRunState &state);
+		void	wait(CRunState &state);
+		bool	runPendingTask(int idx);
+		void	workerLoop(int idx);
+
+
+	private:
+		std::vector<std::unique_ptr<CTaskQueue>>	m_vQueues;				///< Task queues: one per worker thread
+		std::vector<std::thread>					m_vWorkers;				///< Worker threads
+		std::atomic<size_t>							m_nQueued	{ 0 };		///< Number of tasks in all the queues
+		std::atomic<size_t>							m_next		{ 0 };		///< Round-robin counter for the tasks, submitted from outside the pool
+		std::atomic<bool>							m_stop		{ false };	///< Flag indicating whether the worker threads should exit
+		std::mutex									m_mtx;					///< Mutex for the sleeping worker threads
+		std::condition_variable						m_cv;					///< Condition variable for the sleeping worker threads
+	};
+} }
@@ -42,6 +42,35 @@ namespace DirectGraphicalModels
 	
 		return res;
 	}
+
+	void CTrainEdge::getEdgePotentials(const byte *pFeatureVectors1, const byte *pFeatureVectors2, size_t nEdges, const vec_float_t &vParams, float weight, float *pPots) const
+	{
+		calculateEdgePotentials(pFeatureVectors1, pFeatureVectors2, nEdges, vParams, pPots);
+
+		for (size_t e = 0; e < nEdges; e++)
+			for (byte y = 0; y < m_nStates; y++) {
+				float *pRes = pPots + (e * m_nStates + y) * m_nStates;
+				if (weight != 1.0f)
+					for (byte x = 0; x < m_nStates; x++) pRes[x] = powf(pRes[x], weight);
+
+				// Normalization
+				float  Sum = 0;
+				for (byte x = 0; x < m_nStates; x++) Sum += pRes[x];
+				if (Sum == 0) continue;
+				for (byte x = 0; x < m_nStates; x++) pRes[x] *= 100 / Sum;
+			} // y
+	}
+
+	void CTrainEdge::calculateEdgePotentials(const byte *pFeatureVectors1, const byte *pFeatureVectors2, size_t nEdges, const vec_float_t &vParams, float *pPots) const
+	{
+		const word nFeatures = getNumFeatures();
+		for (size_t e = 0; e < nEdges; e++) {
+			const Mat featureVector1(nFeatures, 1, CV_8UC1, const_cast<byte *>(pFeatureVectors1 + e * nFeatures));
+			const Mat featureVector2(nFeatures, 1, CV_8UC1, const_cast<byte *>(pFeatureVectors2 + e * nFeatures));
+			const Mat pot = calculateEdgePotentials(featureVector1, featureVector2, vParams);
+			pot.copyTo(lvalue_cast(Mat(m_nStates, m_nStates, CV_32FC1, pPots + e * m_nStates * m_nStates)));
+		}
+	}
     
     // returns the matrix filled with ones, except the diagonal values wich are set to <values>
     Mat CTrainEdge::getDefaultEdgePotentials(const vec_float_t &values)
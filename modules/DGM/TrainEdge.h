@@ -63,6 +63,19 @@ namespace DirectGraphicalModels
 		* @return %Edge potentials on success: Mat(size: nStates x nStates; type: CV_32FC1)
 		*/	
 		DllExport Mat			getEdgePotentials(const Mat &featureVector1, const Mat &featureVector2, const vec_float_t &vParams, float weight = 1.0f) const; 
+		/**
+		* @brief Returns the edge potentials for a batch of edges
+		* @details This function calls the batch version of calculateEdgePotentials() function, which may be implemented in derived classes without 
+		* allocating memory for every edge. After that, the resulting edge potentials are powered by parameter \b weight and normalized as in the single-edge version.
+		* > This function is thread-safe, if the calculateEdgePotentials() function of the derived class is thread-safe
+		* @param pFeatureVectors1 Pointer to the feature vectors, corresponding to the first nodes of the edges: \a nEdges x \a nFeatures values (row-major order)
+		* @param pFeatureVectors2 Pointer to the feature vectors, corresponding to the second nodes of the edges: \a nEdges x \a nFeatures values (row-major order)
+		* @param nEdges The number of edges
+		* @param vParams Array of control parameters. Please refer to the concrete model implementation of the calculateEdgePotentials() function for more details
+		* @param weight The weighting parameter
+		* @param[out] pPots Pointer to the resulting edge potentials: \a nEdges x \a nStates x \a nStates values (row-major order)
+		*/
+		DllExport void			getEdgePotentials(const byte *pFeatureVectors1, const byte *pFeatureVectors2, size_t nEdges, const vec_float_t &vParams, float weight, float *pPots) const;
         /**
          * @brief Returns the data-independent edge potentials
          * @details This function returns matrix with diagonal elements equal to the argument \b val, all the other elements are 1's, what imitates the Potts model.
@@ -95,5 +108,16 @@ namespace DirectGraphicalModels
 		* @returns The edge potential matrix: Mat(size: nStates x nStates; type: CV_32FC1)
 		*/	
 		DllExport virtual Mat	calculateEdgePotentials(const Mat &featureVector1, const Mat &featureVector2, const vec_float_t &vParams) const = 0;
+		/**
+		* @brief Calculates the edge potentials for a batch of edges
+		* @details The default implementation calls the single-edge calculateEdgePotentials() function for every edge. 
+		* Derived classes may override this function in order to calculate the potentials directly in the output array.
+		* @param pFeatureVectors1 Pointer to the feature vectors, corresponding to the first nodes of the edges: \a nEdges x \a nFeatures values (row-major order)
+		* @param pFeatureVectors2 Pointer to the feature vectors, corresponding to the second nodes of the edges: \a nEdges x \a nFeatures values (row-major order)
+		* @param nEdges The number of edges
+		* @param vParams Array of control parameters. Please refere to the concrete model implementation of the calculateEdgePotentials() function for more details
+		* @param[out] pPots Pointer to the resulting edge potentials: \a nEdges x \a nStates x \a nStates values (row-major order)
+		*/
+		DllExport virtual void	calculateEdgePotentials(const byte *pFeatureVectors1, const byte *pFeatureVectors2, size_t nEdges, const vec_float_t &vParams, float *pPots) const;
 	};
 }
@@ -94,8 +94,9 @@ namespace DirectGraphicalModels
 		DllExport virtual Mat	calculateEdgePotentials(const Mat &featureVector1, const Mat &featureVector2, const vec_float_t &vParams) const 
 		{
 			const float nodePotWeight = 1.0f;
-			m_pConcatenator->concatenate(featureVector1, featureVector2, const_cast<Mat &>(m_featureVector));
-			Mat pot = m_pTrainer->getNodePotentials(m_featureVector, nodePotWeight);
+			Mat featureVector(m_pConcatenator->getNumFeatures(), 1, CV_8UC1);		// per-call scratch keeps this function reentrant
+			m_pConcatenator->concatenate(featureVector1, featureVector2, featureVector);
+			Mat pot = m_pTrainer->getNodePotentials(featureVector, nodePotWeight);
 			Mat prior = m_pPrior->getPrior(100);
 
 			Mat res(m_nStates, m_nStates, CV_32FC1);
@@ -9,4 +9,15 @@ namespace DirectGraphicalModels
 		else if (vParams.size() == m_nStates)	return getDefaultEdgePotentials(vParams);
 		else DGM_ASSERT_MSG(false, "Wrong number of parameters: %zu. It must be either %d or %u", vParams.size(), 1, m_nStates);
     }
+
+	void CTrainEdgePotts::calculateEdgePotentials(const byte *, const byte *, size_t nEdges, const vec_float_t &vParams, float *pPots) const
+	{
+		DGM_ASSERT_MSG((vParams.size() == 1) || (vParams.size() == m_nStates), "Wrong number of parameters: %zu. It must be either %d or %u", vParams.size(), 1, m_nStates);
+
+		for (size_t e = 0; e < nEdges; e++) {
+			float *pPot = pPots + e * m_nStates * m_nStates;
+			std::fill(pPot, pPot + m_nStates * m_nStates, 1.0f);
+			for (byte s = 0; s < m_nStates; s++) pPot[s * m_nStates + s] = vParams.size() == 1 ? vParams[0] : vParams[s];
+		}
+	}
 }
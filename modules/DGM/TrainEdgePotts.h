@@ -49,5 +49,6 @@ namespace DirectGraphicalModels
 		* @return The edge potential matrix: Mat(size: nStates x nStates; type: CV_32FC1)
 		*/
 		DllExport virtual Mat	calculateEdgePotentials(const Mat &featureVector1, const Mat &featureVector2, const vec_float_t &vParams) const;
+		DllExport virtual void	calculateEdgePotentials(const byte *pFeatureVectors1, const byte *pFeatureVectors2, size_t nEdges, const vec_float_t &vParams, float *pPots) const;
 	};
 }
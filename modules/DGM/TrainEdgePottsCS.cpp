@@ -48,6 +48,17 @@ float penalizerExp (float x, float l)
 	return MAX(FLT_EPSILON, res);
 }
 
+// Penalizer, specified by the penalization approach
+float penalize(ePotPenalApproach penApproach, float x, float l)
+{
+	switch (penApproach) {
+		case eP_APP_PEN_CHAR:	return penalizerChar(x, l);
+		case eP_APP_PEN_PM:		return penalizerPM(x, l);
+		case eP_APP_PEN_EXP:	return penalizerExp(x, l);
+		default:				return 1.0f;
+	}
+}
+
 
 Mat	CTrainEdgePottsCS::calculateEdgePotentials(const Mat &featureVector1, const Mat &featureVector2, const vec_float_t &vParams) const
 {
@@ -64,16 +75,36 @@ Mat	CTrainEdgePottsCS::calculateEdgePotentials(const Mat &featureVector1, const
 	DGM_ASSERT_MSG((featureVector2.size().width == 1) && (featureVector2.size().height == getNumFeatures()),
 		"The second input feature vector has wrong size:(%d, %d)", featureVector2.size().width, featureVector2.size().height);
 
-	float penalty;
 	float dst = calculateContrast(featureVector1, featureVector2);
-	switch(m_penApproach) {
-		case eP_APP_PEN_CHAR:	penalty = penalizerChar(dst, vParams.back());	break;
-		case eP_APP_PEN_PM:		penalty = penalizerPM(dst, vParams.back());		break;
-		case eP_APP_PEN_EXP:	penalty = penalizerExp(dst, vParams.back());	break;
-	}
+	float penalty = penalize(m_penApproach, dst, vParams.back());
 
 	for (byte s = 0; s < m_nStates; s++) res.at<float>(s, s) = MAX(1.0f, res.at<float>(s, s) * penalty);
 
 	return res;
 }
+
+void CTrainEdgePottsCS::calculateEdgePotentials(const byte *pFeatureVectors1, const byte *pFeatureVectors2, size_t nEdges, const vec_float_t &vParams, float *pPots) const
+{
+	DGM_ASSERT_MSG((vParams.size() == 2) || (vParams.size() == m_nStates + 1), "Wrong number of parameters: %zu. It must be either %d or %u", vParams.size(), 2, m_nStates + 1);
+
+	CTrainEdgePotts::calculateEdgePotentials(pFeatureVectors1, pFeatureVectors2, nEdges, vec_float_t(vParams.begin(), vParams.end() - 1), pPots);
+
+	const word nFeatures = getNumFeatures();
+	for (size_t e = 0; e < nEdges; e++) {
+		const byte *pFv1 = pFeatureVectors1 + e * nFeatures;
+		const byte *pFv2 = pFeatureVectors2 + e * nFeatures;
+		float *pPot = pPots + e * m_nStates * m_nStates;
+
+		// Euclidean distance between the feature vectors, as in calculateContrast()
+		float dst = 0.0f;
+		for (word f = 0; f < nFeatures; f++) {
+			float d = static_cast<float>(pFv1[f]) - static_cast<float>(pFv2[f]);
+			dst += d * d;
+		}
+		dst = sqrtf(dst / nFeatures);
+		float penalty = penalize(m_penApproach, dst, vParams.back());
+
+		for (byte s = 0; s < m_nStates; s++) pPot[s * m_nStates + s] = MAX(1.0f, pPot[s * m_nStates + s] * penalty);
+	}
+}
 }
\ No newline at end of file
@@ -66,6 +66,7 @@ namespace DirectGraphicalModels
 		* > If \b featureVector1 or \b featureVector2 is empty, the function returns the test-data-independent Potts potential: @ref CTrainEdgePotts::calculateEdgePotentials()
 		*/		
 		DllExport virtual Mat	calculateEdgePotentials(const Mat &featureVector1, const Mat &featureVector2, const vec_float_t &vParams) const;
+		DllExport virtual void	calculateEdgePotentials(const byte *pFeatureVectors1, const byte *pFeatureVectors2, size_t nEdges, const vec_float_t &vParams, float *pPots) const;
 
 
 	private:
@@ -52,6 +52,19 @@ Mat	CTrainEdgePrior::calculateEdgePotentials(const Mat &featureVector1, const Ma
 	return res;
 }
 
+void CTrainEdgePrior::calculateEdgePotentials(const byte *pFeatureVectors1, const byte *pFeatureVectors2, size_t nEdges, const vec_float_t &vParams, float *pPots) const
+{
+	DGM_ASSERT_MSG(!m_prior.empty(), "The prior matrix is not trained");
+	CTrainEdgePottsCS::calculateEdgePotentials(pFeatureVectors1, pFeatureVectors2, nEdges, vParams, pPots);
+	
+	const Mat prior = m_prior.isContinuous() ? m_prior : m_prior.clone();
+	const float *pPrior = prior.ptr<float>();
+	for (size_t e = 0; e < nEdges; e++) {
+		float *pPot = pPots + e * m_nStates * m_nStates;
+		for (int i = 0; i < m_nStates * m_nStates; i++) pPot[i] *= pPrior[i];
+	}
+}
+
 inline void CTrainEdgePrior::loadPriorMatrix(void)
 {
 	if (!m_prior.empty()) m_prior.release();
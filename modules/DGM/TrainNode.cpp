@@ -12,10 +12,15 @@
 #include "TrainNodeCvANN.h"
 #include "TrainNodeCvSVM.h"
 
+#include "parallel.h"
 #include "macroses.h"
 
 namespace DirectGraphicalModels
 {
+	namespace {
+		const size_t BATCH_SIZE = 1024;		// Number of samples, processed with one call of the batch getNodePotentials() by the image-level functions
+	}
+
 	// Factory method
 	std::shared_ptr<CTrainNode> CTrainNode::create(byte nodeRandomModel, byte nStates, word nFeatures)
 	{
@@ -62,26 +67,24 @@ namespace DirectGraphicalModels
 		}
 
 		Mat res(featureVectors.size(), CV_32FC(m_nStates));
-#ifdef ENABLE_PPL
-		concurrency::parallel_for(0, res.rows, [&] (int y) {
-			Mat pot;
-			Mat vec(getNumFeatures(), 1, CV_8UC1);
+
+		// The pixels are processed in batches: the whole image is one sequence of pixels if the data is continuous, otherwise every row is a separate sequence
+		const bool		isContinuous = featureVectors.isContinuous() && (weights.empty() || weights.isContinuous());
+		const int		nRows		 = isContinuous ? 1 : res.rows;
+		const size_t	nCols		 = isContinuous ? res.total() : static_cast<size_t>(res.cols);
+		const int		nBatches	 = static_cast<int>((nCols + BATCH_SIZE - 1) / BATCH_SIZE);		// in every sequence
+#ifdef ENABLE_PARALLEL
+		parallel::parallel_for(0, nRows * nBatches, [&](int i) {
 #else
-		Mat pot;
-		Mat vec(getNumFeatures(), 1, CV_8UC1);
-		for (int y = 0; y < res.rows; y++) {
+		for (int i = 0; i < nRows * nBatches; i++) {
 #endif
-			const byte  *pFv = featureVectors.ptr<byte>(y);
-			const float *pW = weights.empty() ? NULL : weights.ptr<float>(y);
-			float		*pRes = res.ptr<float>(y);
-			for (int x = 0; x < res.cols; x++) {
-				float weight = pW ? pW[x] : 1.0f;
-				for (int f = 0; f < getNumFeatures(); f++) vec.at<byte>(f, 0) = pFv[getNumFeatures() * x + f];
-				pot = getNodePotentials(vec, weight, Z);
-				for (int s = 0; s < m_nStates; s++) pRes[m_nStates * x + s] = pot.at<float>(s, 0);
-			} // x
-		} // y	
-#ifdef ENABLE_PPL
+			const int		y			= i / nBatches;
+			const size_t	x			= (i % nBatches) * BATCH_SIZE;
+			const size_t	nSamples	= MIN(BATCH_SIZE, nCols - x);
+			const float		*pW			= weights.empty() ? NULL : weights.ptr<float>(y) + x;
+			getNodePotentials(featureVectors.ptr<byte>(y) + x * getNumFeatures(), pW, nSamples, res.ptr<float>(y) + x * m_nStates, Z);
+		}
+#ifdef ENABLE_PARALLEL
 		);
 #endif
 
@@ -92,38 +95,10 @@ namespace DirectGraphicalModels
 	{
 		DGM_ASSERT_MSG(featureVectors.size() == getNumFeatures(), "Number of features in the <featureVectors> (%zu) does not correspond to the specified (%d)", featureVectors.size(), getNumFeatures());
 		DGM_ASSERT(featureVectors[0].depth() == CV_8U);
-		if (!weights.empty()) {
-			DGM_ASSERT(featureVectors[0].size() == weights.size());
-			DGM_ASSERT(weights.type() == CV_32FC1);
-		}
 
-		Mat res(featureVectors[0].size(), CV_32FC(m_nStates));
-#ifdef ENABLE_PPL
-		concurrency::parallel_for(0, res.rows, [&](int y) {
-			Mat pot;
-			Mat vec(getNumFeatures(), 1, CV_8UC1);
-#else
-		Mat pot;
-		Mat vec(getNumFeatures(), 1, CV_8UC1);
-		for (int y = 0; y < res.rows; y++) {
-#endif
-			const byte  **pFv = new const byte *[getNumFeatures()];
-			for (word f = 0; f < getNumFeatures(); f++) pFv[f] = featureVectors[f].ptr<byte>(y);
-			const float *pW = weights.empty() ? NULL : weights.ptr<float>(y);
-			float		*pRes = res.ptr<float>(y);
-			for (int x = 0; x < res.cols; x++) {
-				float weight = pW ? pW[x] : 1.0f;
-				for (int f = 0; f < getNumFeatures(); f++) vec.at<byte>(f, 0) = pFv[f][x];
-				pot = getNodePotentials(vec, weight, Z);
-				for (int s = 0; s < m_nStates; s++) pRes[m_nStates * x + s] = pot.at<float>(s, 0);
-			} // x
-			delete[] pFv;
-		} // y	
-#ifdef ENABLE_PPL
-		);
-#endif
-
-		return res;
+		Mat fv;
+		merge(featureVectors, fv);
+		return getNodePotentials(fv, weights, Z);
 	}
 
 	Mat CTrainNode::getNodePotentials(const Mat &featureVector, float weight, float Z) const
@@ -135,14 +110,14 @@ namespace DirectGraphicalModels
 			"The input feature vector has wrong size:(%d, %d)", featureVector.size().width, featureVector.size().height);
 	
 		Mat res(m_nStates, 1, CV_32FC1, Scalar(0));
-		const_cast<Mat &>(m_mask).setTo(1);
-		calculateNodePotentials(featureVector, res, const_cast<Mat &>(m_mask));
+		Mat mask(m_nStates, 1, CV_8UC1, Scalar(1));
+		calculateNodePotentials(featureVector, res, mask);
 		if (weight != 1.0f) pow(res, weight, res);
 
 		// Normalization
 		float Sum = static_cast<float>(sum(res).val[0]);
 		if (Sum < FLT_EPSILON) {
-			res.setTo(FLT_EPSILON, m_mask);		// Case of too small potentials (make all the cases equaly small probable)
+			res.setTo(FLT_EPSILON, mask);		// Case of too small potentials (make all the cases equaly small probable)
 		} else {
 			if (Z > FLT_EPSILON)
 				res *= 100.0 / Z;
@@ -152,4 +127,45 @@ namespace DirectGraphicalModels
 
 		return res;
 	}
+
+	void CTrainNode::getNodePotentials(const byte *pFeatureVectors, const float *pWeights, size_t nSamples, float *pPotentials, float Z) const
+	{
+		std::fill(pPotentials, pPotentials + nSamples * m_nStates, 0.0f);
+		vec_byte_t vMasks(nSamples * m_nStates, 1);
+		calculateNodePotentials(pFeatureVectors, nSamples, pPotentials, vMasks.data());
+
+		for (size_t i = 0; i < nSamples; i++) {
+			float		* pPot	= pPotentials + i * m_nStates;
+			const byte	* pMask	= vMasks.data() + i * m_nStates;
+			const float	  weight = pWeights ? pWeights[i] : 1.0f;
+			if (weight != 1.0f)
+				for (byte s = 0; s < m_nStates; s++) pPot[s] = powf(pPot[s], weight);
+
+			// Normalization
+			double dSum = 0;
+			for (byte s = 0; s < m_nStates; s++) dSum += pPot[s];
+			const float Sum = static_cast<float>(dSum);
+			if (Sum < FLT_EPSILON) {
+				for (byte s = 0; s < m_nStates; s++)		// Case of too small potentials (make all the cases equaly small probable)
+					if (pMask[s]) pPot[s] = FLT_EPSILON;
+			} else {
+				const double k = Z > FLT_EPSILON ? 100.0 / Z : 100.0 / Sum;
+				for (byte s = 0; s < m_nStates; s++) pPot[s] = static_cast<float>(pPot[s] * k);
+			}
+		} // i
+	}
+
+	void CTrainNode::calculateNodePotentials(const byte *pFeatureVectors, size_t nSamples, float *pPotentials, byte *pMasks) const
+	{
+		const word nFeatures = getNumFeatures();
+		for (size_t i = 0; i < nSamples; i++) {
+			float	 *pPot = pPotentials + i * m_nStates;
+			const Mat featureVector(nFeatures, 1, CV_8UC1, const_cast<byte *>(pFeatureVectors + i * nFeatures));
+			Mat		  potential(m_nStates, 1, CV_32FC1, pPot);
+			Mat		  mask(m_nStates, 1, CV_8UC1, pMasks + i * m_nStates);
+			calculateNodePotentials(featureVector, potential, mask);
+			if (potential.ptr<float>() != pPot)														// the model has reallocated the potentials
+				potential.reshape(1, m_nStates).copyTo(lvalue_cast(Mat(m_nStates, 1, CV_32FC1, pPot)));
+		} // i
+	}
 }
@@ -41,6 +41,9 @@ namespace DirectGraphicalModels
 	* 
 	* delete t;
 	* @endcode
+	* The "getting data" phase is reentrant: after training, all the getNodePotentials() functions use only per-call scratch data and
+	* do not modify the trainer object. Thus, one trained object may serve concurrent requests from multiple threads without cloning.
+	* The derived classes must preserve this property in their implementations of calculateNodePotentials().
 	* See @ref demotrain for more details
 	* @author Sergey G. Kosov, sergey.kosov@project-10.de
 	*/
@@ -55,7 +58,6 @@ namespace DirectGraphicalModels
 		DllExport CTrainNode(byte nStates, word nFeatures)
 			    : CBaseRandomModel(nStates)
 				, ITrain(nStates, nFeatures)
-				, m_mask(nStates, 1, CV_8UC1)
 		{}
 		DllExport virtual ~CTrainNode(void) = default;
 	
@@ -120,6 +122,19 @@ namespace DirectGraphicalModels
 		* @return Normalized %node potentials on success: Mat(size: nStates x 1; type: CV_32FC1); 
 		*/		
 		DllExport Mat			getNodePotentials(const Mat &featureVector, float weight, float Z = 0.0f) const;
+		/**
+		* @brief Returns the node potentials for a batch of feature vectors
+		* @details This function calls the batch version of calculateNodePotentials() function once for all samples. After that,
+		* every resulting node potential is powered by its weight and normalized as in the single-sample version of getNodePotentials().
+		* @param pFeatureVectors Pointer to the feature vectors: \a nSamples x \a nFeatures values (row-major order)
+		* @param pWeights Pointer to the \a nSamples weighting parameters. If NULL, values 1 are used.
+		* @param nSamples The number of samples
+		* @param[out] pPotentials Pointer to the resulting node potentials: \a nSamples x \a nStates values (row-major order)
+		* @param Z The value of <a href="https://en.wikipedia.org/wiki/Partition_function_(statistical_mechanics)">partition function</a>.
+		* In order to convert potential to the probability, it is multiplied by \f$1/Z\f$.
+		* If \f$Z\leq0\f$, the resulting node potentials are normalized to 100, independently for each potential.
+		*/
+		DllExport void			getNodePotentials(const byte *pFeatureVectors, const float *pWeights, size_t nSamples, float *pPotentials, float Z = 0.0f) const;
 
 
 	protected:
@@ -133,10 +148,16 @@ namespace DirectGraphicalModels
 		* @param[in,out]	mask Relevant %Node potentials: Mat(size: nStates x 1; type: CV_8UC1). This parameter should be preinitialized and set to value 1 (all potentials are relevant).
 		*/		
 		DllExport virtual void calculateNodePotentials(const Mat &featureVector, Mat &potential, Mat &mask) const = 0;
-		
-
-	private:
-		Mat	m_mask;
+		/**
+		* @brief Calculates the node potentials for a batch of feature vectors
+		* @details The default implementation calls the single-sample calculateNodePotentials() function for every sample. 
+		* Derived classes may override this function in order to process all samples at once.
+		* @param[in]	pFeatureVectors Pointer to the feature vectors: \a nSamples x \a nFeatures values (row-major order)
+		* @param[in]	nSamples The number of samples
+		* @param[in,out]	pPotentials Pointer to the node potentials: \a nSamples x \a nStates values (row-major order). They should be preinitialized and set to value 0.
+		* @param[in,out]	pMasks Pointer to the relevant node potentials: \a nSamples x \a nStates values (row-major order). They should be preinitialized and set to value 1.
+		*/
+		DllExport virtual void calculateNodePotentials(const byte *pFeatureVectors, size_t nSamples, float *pPotentials, byte *pMasks) const;
 	};
 }
 
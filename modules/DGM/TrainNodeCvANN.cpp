@@ -109,4 +109,19 @@ namespace DirectGraphicalModels
 			if (pot < 0) pot = 0;
 		potential = potential.t();
 	}
+
+	void	CTrainNodeCvANN::calculateNodePotentials(const byte *pFeatureVectors, size_t nSamples, float *pPotentials, byte *) const
+	{
+		// All samples are converted and passed through the network at once
+		Mat fv, res;
+		Mat(static_cast<int>(nSamples), getNumFeatures(), CV_8UC1, const_cast<byte *>(pFeatureVectors)).convertTo(fv, CV_32FC1);
+		m_pANN->predict(fv, res);
+
+		for (int i = 0; i < fv.rows; i++) {
+			float		*pPot = pPotentials + i * m_nStates;
+			const float *pRes = res.ptr<float>(i);
+			for (byte s = 0; s < m_nStates; s++)
+				pPot[s] = MAX(0.0f, pRes[s]);
+		} // i
+	}
 }
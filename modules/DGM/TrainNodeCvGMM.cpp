@@ -130,4 +130,22 @@ void CTrainNodeCvGMM::calculateNodePotentials(const Mat &featureVector, Mat &pot
 	}
 	delete [] v;*/
 }
+
+void CTrainNodeCvGMM::calculateNodePotentials(const byte *pFeatureVectors, size_t nSamples, float *pPotentials, byte *pMasks) const
+{
+	// ml::EM::predict2() accepts one sample only, but the samples are converted once for the whole batch
+	Mat fv;
+	Mat(static_cast<int>(nSamples), getNumFeatures(), CV_8UC1, const_cast<byte *>(pFeatureVectors)).convertTo(fv, CV_64FC1);
+
+	// Min Coefficient approach
+	for (byte s = 0; s < m_nStates; s++) {					// state
+		if (m_vpEM[s]->isTrained()) {
+			for (int i = 0; i < fv.rows; i++)
+				pPotentials[i * m_nStates + s] = static_cast<float>(std::exp(m_vpEM[s]->predict2(fv.row(i), noArray())[0]) * m_minCoefficient);
+		} else {
+			for (int i = 0; i < fv.rows; i++)
+				pMasks[i * m_nStates + s] = 0;
+		}
+	} // s
+}
 }
@@ -112,4 +112,26 @@ namespace DirectGraphicalModels
 		if (n) potential /= n;
 		potential += m_params.bias;
 	}
+
+	void	CTrainNodeCvKNN::calculateNodePotentials(const byte *pFeatureVectors, size_t nSamples, float *pPotentials, byte *) const
+	{
+		// The nearest neighbors of all samples are found at once
+		Mat fv, result, neighborResponses;
+		Mat(static_cast<int>(nSamples), getNumFeatures(), CV_8UC1, const_cast<byte *>(pFeatureVectors)).convertTo(fv, CV_32FC1);
+		m_pKNN->findNearest(fv, static_cast<int>(m_params.maxNeighbors), result, neighborResponses);
+
+		int n = neighborResponses.cols;
+		for (int i = 0; i < fv.rows; i++) {
+			float		*pPot		= pPotentials + i * m_nStates;
+			const float *pResponse	= neighborResponses.ptr<float>(i);
+			for (int k = 0; k < n; k++) {
+				byte s = static_cast<byte>(pResponse[k]);
+				pPot[s] += 1.0f;
+			}
+			for (byte s = 0; s < m_nStates; s++) {
+				if (n) pPot[s] /= n;
+				pPot[s] += m_params.bias;
+			}
+		} // i
+	}
 }
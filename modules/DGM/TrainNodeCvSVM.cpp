@@ -86,4 +86,18 @@ namespace DirectGraphicalModels
 		potential.at<float>(s, 0) = 1.0f;
 		potential += 0.1f;
 	}
+
+	void CTrainNodeCvSVM::calculateNodePotentials(const byte *pFeatureVectors, size_t nSamples, float *pPotentials, byte *) const
+	{
+		// All samples are converted and classified at once
+		Mat fv, res;
+		Mat(static_cast<int>(nSamples), getNumFeatures(), CV_8UC1, const_cast<byte *>(pFeatureVectors)).convertTo(fv, CV_32FC1);
+		m_pSVM->predict(fv, res);
+
+		for (int i = 0; i < fv.rows; i++) {
+			float *pPot = pPotentials + i * m_nStates;
+			pPot[static_cast<byte>(res.at<float>(i, 0))] = 1.0f;
+			for (byte s = 0; s < m_nStates; s++) pPot[s] += 0.1f;
+		} // i
+	}
 }
@@ -35,6 +35,7 @@ namespace DirectGraphicalModels
 	{
 		m_vGaussianMixtures.clear();
 		m_minAlpha = 1;
+		m_vLogCoefficients.clear();
 	}
 
 	namespace {
@@ -62,12 +63,46 @@ namespace DirectGraphicalModels
 				res[i] = gaussianMixture[i].getNumPoints() >= samplesTreshold ? x.getKullbackLeiberDivergence(gaussianMixture[i]) : DBL_MAX;
 			return res;
 		}
+
+		// Calculates the inverse W = L^{-1} of the Cholesky factor of the covariance matrix: sigma = L * L^T,
+		// such that (x - mu)^T * sigma^{-1} * (x - mu) = |W * (x - mu)|^2
+		// Returns false if <sigma> is not positive definite
+		bool getInverseCholesky(const Mat &sigma, Mat &W)
+		{
+			const int k = sigma.rows;
+			Mat L = Mat::zeros(k, k, CV_64FC1);
+			for (int j = 0; j < k; j++) {
+				double d = sigma.at<double>(j, j);
+				for (int p = 0; p < j; p++) d -= L.at<double>(j, p) * L.at<double>(j, p);
+				if (d <= 0) return false;
+				L.at<double>(j, j) = sqrt(d);
+				for (int i = j + 1; i < k; i++) {
+					double v = sigma.at<double>(i, j);
+					for (int p = 0; p < j; p++) v -= L.at<double>(i, p) * L.at<double>(j, p);
+					L.at<double>(i, j) = v / L.at<double>(j, j);
+				}
+			}
+
+			// Forward substitution: L * W = I
+			W = Mat::zeros(k, k, CV_64FC1);
+			for (int c = 0; c < k; c++)
+				for (int i = c; i < k; i++) {
+					double v = (i == c) ? 1.0 : 0.0;
+					for (int p = c; p < i; p++) v -= L.at<double>(i, p) * W.at<double>(p, c);
+					W.at<double>(i, c) = v / L.at<double>(i, i);
+				}
+			return true;
+		}
+
+		const int BLOCK_SIZE = 256;		// number of samples evaluated with one matrix product by the frozen model
 	}
 
 	void CTrainNodeGMM::addFeatureVec(const Mat &featureVector, byte gt) {
 		// Assertions
 		DGM_ASSERT_MSG(gt < m_nStates, "The groundtruth value %u is out of range [0; %u)", gt, m_nStates);
 
+		if (!m_vLogCoefficients.empty()) m_vLogCoefficients.clear();		// the model is changing
+
 		Mat point;
 		featureVector.convertTo(point, CV_64FC1);
 
@@ -175,6 +210,7 @@ namespace DirectGraphicalModels
 		// getting the coefficients
 		for (GaussianMixture &gaussianMixture : m_vGaussianMixtures) {			// state
 			for (auto itGauss = gaussianMixture.begin(); itGauss != gaussianMixture.end(); itGauss++) {
+				itGauss->precompute();					// no lazy evaluation is left for getNodePotentials()
 				long double alpha = itGauss->getAlpha();
 				if (alpha > MAX_COEFFICIENT) {			// i.e. if (Coefficient = \infinitiy) delete Gaussian
 					gaussianMixture.erase(itGauss);
@@ -187,6 +223,7 @@ namespace DirectGraphicalModels
 		} // gaussianMixture
 
 		printStatus(m_vGaussianMixtures, m_minAlpha);
+		freeze();
 	}
 
 	void CTrainNodeGMM::saveFile(FILE *pFile) const
@@ -251,6 +288,7 @@ namespace DirectGraphicalModels
 				gauss.setMu(mu);
 				gauss.setSigma(sigma);
 				gauss.setNumPoints(nPoints);
+				gauss.precompute();
 
 				mu.release();
 				sigma.release();
@@ -258,10 +296,16 @@ namespace DirectGraphicalModels
 		} // gaussianMixture
 
 		fread(&m_minAlpha, sizeof(long double), 1, pFile);
+		freeze();
 	}
 
 	void CTrainNodeGMM::calculateNodePotentials(const Mat &featureVector, Mat &potential, Mat &mask) const
 	{
+		if (!m_vLogCoefficients.empty() && featureVector.isContinuous()) {
+			calculateNodePotentials(featureVector.ptr<byte>(), 1, potential.ptr<float>(), mask.ptr<byte>());
+			return;
+		}
+
 		Mat fv;
 		Mat aux1, aux2, aux3;
 
@@ -285,4 +329,103 @@ namespace DirectGraphicalModels
 			}
 		} // s
 	}
+
+	void CTrainNodeGMM::calculateNodePotentials(const byte *pFeatureVectors, size_t nSamples, float *pPotentials, byte *pMasks) const
+	{
+		const word nFeatures = getNumFeatures();
+
+		if (!m_vLogCoefficients.empty()) {
+			// Frozen model: W_g * x for all Gaussians and a block of samples with one matrix product; the rest in log-space
+			Mat X, Y;
+			for (size_t first = 0; first < nSamples; first += BLOCK_SIZE) {
+				const int nBlock = static_cast<int>(std::min<size_t>(BLOCK_SIZE, nSamples - first));
+				Mat(nBlock, nFeatures, CV_8UC1, const_cast<byte *>(pFeatureVectors + first * nFeatures)).convertTo(X, CV_32FC1);
+				gemm(X, m_W, 1.0, noArray(), 0.0, Y);
+				for (int i = 0; i < nBlock; i++) {
+					const float	* pY	= Y.ptr<float>(i);
+					float		* pPot	= pPotentials + (first + i) * m_nStates;
+					for (byte s = 0; s < m_nStates; s++) {				// state
+						if (m_vGaussOffsets[s] == m_vGaussOffsets[s + 1]) pMasks[(first + i) * m_nStates + s] = 0;
+						for (size_t g = m_vGaussOffsets[s]; g < m_vGaussOffsets[s + 1]; g++) {
+							const float * pYg	= pY + g * nFeatures;
+							const float * pWmu	= m_vWmu.data() + g * nFeatures;
+							float q = 0;									// squared Mahalanobis distance
+							for (word f = 0; f < nFeatures; f++) q += (pYg[f] - pWmu[f]) * (pYg[f] - pWmu[f]);
+							pPot[s] += expf(m_vLogCoefficients[g] - 0.5f * q);
+						} // g
+					} // s
+				} // i
+			} // first
+			return;
+		}
+
+		// The scaled coefficients of the Gaussians are the same for all samples
+		std::vector<std::vector<long double>> vvCoefficients(m_nStates);
+		for (byte s = 0; s < m_nStates; s++) {
+			const GaussianMixture &gaussianMixture = m_vGaussianMixtures[s];
+			size_t nAllPoints = 0;
+			for (const CKDGauss &gauss : gaussianMixture)
+				nAllPoints += gauss.getNumPoints();
+			for (const CKDGauss &gauss : gaussianMixture) {
+				double		k = static_cast<double>(gauss.getNumPoints()) / nAllPoints;
+				long double	aK = gauss.getAlpha() / m_minAlpha;
+				vvCoefficients[s].push_back(k * aK);
+			}
+		} // s
+
+		Mat fv(nFeatures, 1, CV_64FC1);
+		Mat aux1, aux2, aux3;
+		for (size_t i = 0; i < nSamples; i++) {
+			const byte	* pFv	= pFeatureVectors + i * nFeatures;
+			float		* pPot	= pPotentials + i * m_nStates;
+			for (word f = 0; f < nFeatures; f++) fv.at<double>(f, 0) = pFv[f];
+			for (byte s = 0; s < m_nStates; s++) {					// state
+				const GaussianMixture &gaussianMixture = m_vGaussianMixtures[s];
+				if (gaussianMixture.empty()) pMasks[i * m_nStates + s] = 0;
+				for (size_t g = 0; g < gaussianMixture.size(); g++)
+					pPot[s] += static_cast<float>(vvCoefficients[s][g] * gaussianMixture[g].getValue(fv, aux1, aux2, aux3));
+			} // s
+		} // i
+	}
+
+	// ---------------------- Private functions ----------------------
+
+	void CTrainNodeGMM::freeze(void)
+	{
+		const word nFeatures = getNumFeatures();
+		
+		m_vGaussOffsets.assign(1, 0);
+		for (const GaussianMixture &gaussianMixture : m_vGaussianMixtures)
+			m_vGaussOffsets.push_back(m_vGaussOffsets.back() + gaussianMixture.size());
+		const size_t nGausses = m_vGaussOffsets.back();
+
+		m_W = Mat(nFeatures, static_cast<int>(nGausses * nFeatures), CV_32FC1);
+		m_vWmu.resize(nGausses * nFeatures);
+		m_vLogCoefficients.clear();
+		if (nGausses == 0) return;
+
+		vec_float_t vLogCoefficients;
+		vLogCoefficients.reserve(nGausses);
+		Mat W, Wmu;
+		for (const GaussianMixture &gaussianMixture : m_vGaussianMixtures) {		// state
+			size_t nAllPoints = 0;
+			for (const CKDGauss &gauss : gaussianMixture)
+				nAllPoints += gauss.getNumPoints();
+			
+			for (const CKDGauss &gauss : gaussianMixture) {
+				if (!getInverseCholesky(gauss.getSigma(), W)) return;				// the model stays not frozen
+				const int g = static_cast<int>(vLogCoefficients.size());
+				Mat(W.t()).convertTo(m_W(Rect(g * nFeatures, 0, nFeatures, nFeatures)), CV_32FC1);
+				gemm(W, gauss.getMu(), 1.0, noArray(), 0.0, Wmu);
+				for (word f = 0; f < nFeatures; f++) m_vWmu[g * nFeatures + f] = static_cast<float>(Wmu.at<double>(f, 0));
+				
+				// The scaled coefficient may exceed the float range, but its logarithm is added to the exponent of the Gaussian:
+				// expf() overflows only where the float cast of the long double product overflows too
+				long double k = static_cast<long double>(gauss.getNumPoints()) / nAllPoints;
+				vLogCoefficients.push_back(static_cast<float>(logl(k) + logl(gauss.getAlpha()) - logl(m_minAlpha)));
+			} // gausses
+		} // gaussianMixture
+		
+		m_vLogCoefficients = vLogCoefficients;
+	}
 }
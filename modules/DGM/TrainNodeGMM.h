@@ -35,6 +35,10 @@ namespace DirectGraphicalModels
 	* @details This class implements the generative training mechanism, based on the idea of approximating the density of multi-dimensional random variables
 	* with an additive super-position of multivariate Gaussian distributions. The underlying algorithm is described in the paper
 	* <a href="http://www.project-10.de/Kosov/files/GCPR_2013.pdf" target="_blank">Sequential Gaussian Mixture Models for Two-Level Conditional Random Fields</a>
+	* After train() or loading from file, the model is frozen: the inverse Cholesky factors of all covariance matrices and the logarithms of all
+	* Gaussian coefficients are precomputed, and the node potentials are evaluated in log-space for blocks of samples with a single matrix product in float.
+	* If a covariance matrix is not positive definite, the model is not frozen and the node potentials are evaluated with CKDGauss::getValue().
+	* The frozen data is dropped when new feature vectors are added, until the model is trained again.
 	* @author Sergey G. Kosov, sergey.kosov@project-10.de
 	*/
 	class CTrainNodeGMM : public CTrainNode
@@ -75,6 +79,7 @@ namespace DirectGraphicalModels
 		* @param[in,out]	mask Relevant %Node potentials: Mat(size: nStates x 1; type: CV_8UC1). This parameter should be preinitialized and set to value 1 (all potentials are relevant).
 		*/
 		DllExport void calculateNodePotentials(const Mat &featureVector, Mat &potential, Mat &mask) const;
+		DllExport void calculateNodePotentials(const byte *pFeatureVectors, size_t nSamples, float *pPotentials, byte *pMasks) const;
 
 
 	private:
@@ -82,10 +87,20 @@ namespace DirectGraphicalModels
 		static const long double		MAX_COEFFICIENT;
 
 
+	private:
+		void							freeze(void);								// fills the frozen-model data from m_vGaussianMixtures
+
+
 	private:
 		TrainNodeGMMParams				m_params;
 		std::vector<GaussianMixture>	m_vGaussianMixtures;						// block of n-dimensional Gauss function	
 		long double						m_minAlpha = 1;								// auxilary coefficient for scaling gaussian coefficients
+		
+		// Frozen model: Gaussians of all states are stored one after another
+		Mat								m_W;										// the transposed inverse Cholesky factors W_g = L_g^{-1}: Mat(size: nFeatures x nGausses * nFeatures; type: CV_32FC1)
+		vec_float_t						m_vWmu;										// the products W_g * mu_g: nGausses * nFeatures values
+		vec_float_t						m_vLogCoefficients;							// log(pi_g * alpha_g / m_minAlpha): nGausses values; empty if the model is not frozen
+		vec_size_t						m_vGaussOffsets;							// index of the first Gaussian of each state: nStates + 1 values
 	};
 }
 
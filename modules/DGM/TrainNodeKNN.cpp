@@ -87,4 +87,22 @@ namespace DirectGraphicalModels
 		if (n) potential /= static_cast<double>(n);
 		potential += m_params.bias;
 	}
+
+	void CTrainNodeKNN::calculateNodePotentials(const byte *pFeatureVectors, size_t nSamples, float *pPotentials, byte *) const
+	{
+		const word nFeatures = getNumFeatures();
+		for (size_t i = 0; i < nSamples; i++) {
+			const Mat key(1, nFeatures, CV_8UC1, const_cast<byte *>(pFeatureVectors + i * nFeatures));
+			float	* pPot = pPotentials + i * m_nStates;
+
+			auto nearestNeighbors = m_pTree->findNearestNeighbors(key, m_params.maxNeighbors);
+			for (auto node : nearestNeighbors) pPot[node->getValue()] += 1.0f;
+
+			const size_t n = nearestNeighbors.size();
+			for (byte s = 0; s < m_nStates; s++) {
+				if (n) pPot[s] = static_cast<float>(pPot[s] / static_cast<double>(n));
+				pPot[s] += m_params.bias;
+			}
+		} // i
+	}
 }
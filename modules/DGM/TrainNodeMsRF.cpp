@@ -130,5 +130,29 @@ void CTrainNodeMsRF::calculateNodePotentials(const Mat &featureVector, Mat &pote
 	for (byte s = 0; s < m_nStates; s++) 
 		potential.at<float>(s, 0) = (1.0f - mudiness) * h.GetProbability(s);
 }
+
+void CTrainNodeMsRF::calculateNodePotentials(const byte *pFeatureVectors, size_t nSamples, float *pPotentials, byte *) const
+{
+	// All samples are passed through the forest at once
+	std::unique_ptr<sw::DataPointCollection> testData = std::unique_ptr<sw::DataPointCollection>(new sw::DataPointCollection());
+	testData->m_dimension = getNumFeatures();
+	testData->m_vData.assign(pFeatureVectors, pFeatureVectors + nSamples * getNumFeatures());
+
+	std::vector<std::vector<int>> leafNodeIndices;
+	m_pRF->Apply(*testData, leafNodeIndices);
+
+	for (size_t i = 0; i < nSamples; i++) {
+		sw::HistogramAggregator h(m_nStates);
+		for (size_t t = 0; t < m_pRF->TreeCount(); t++) {
+			int leafIndex = leafNodeIndices[t][i];
+			h.Aggregate(m_pRF->GetTree((t)).GetNode(leafIndex).TrainingDataStatistics);
+		} // t
+
+		float mudiness = static_cast<float> (0.5 * h.Entropy());
+
+		for (byte s = 0; s < m_nStates; s++) 
+			pPotentials[i * m_nStates + s] = (1.0f - mudiness) * h.GetProbability(s);
+	} // i
+}
 }
 #endif
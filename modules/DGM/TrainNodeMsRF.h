@@ -89,6 +89,7 @@ namespace DirectGraphicalModels
 		DllExport void saveFile(FILE *pFile) const { }
 		DllExport void loadFile(FILE *pFile) { }
 		DllExport void calculateNodePotentials(const Mat &featureVector, Mat &potential, Mat &mask) const;
+		DllExport void calculateNodePotentials(const byte *pFeatureVectors, size_t nSamples, float *pPotentials, byte *pMasks) const;
 
 
 	private:
@@ -2,6 +2,7 @@
 #include "PDFHistogram.h"
 #include "PDFHistogram2D.h"
 #include "PDFGaussian.h"
+#include "simd.h"
 #include "macroses.h"
 
 namespace DirectGraphicalModels
@@ -31,6 +32,7 @@ namespace DirectGraphicalModels
 			pdf->reset();
 		
 		m_vPDF2D.clear();
+		m_vLogLUT.clear();
 	}
 
 	void CTrainNodeBayes::addFeatureVec(const Mat &featureVector, byte gt)
@@ -40,6 +42,7 @@ namespace DirectGraphicalModels
 		DGM_ASSERT_MSG(featureVector.type() == CV_8UC1, "The feature vector has incorrect type");
 		
 		addNodeGroundTruth(gt);
+		if (!m_vLogLUT.empty()) m_vLogLUT.clear();		// the PDFs are changing
 
 		for (word f = 0; f < getNumFeatures(); f++) {
 			byte feature = featureVector.at<byte>(f, 0);
@@ -56,6 +59,7 @@ namespace DirectGraphicalModels
 	void CTrainNodeBayes::train(bool)
 	{
 		m_prior = getPrior(FLT_MAX);
+		buildLUT();
 	}
 
 	void CTrainNodeBayes::smooth(int nIt)
@@ -64,6 +68,7 @@ namespace DirectGraphicalModels
 			pdf->smooth(nIt);
 		for(auto &pdf: m_vPDF2D)
 			pdf->smooth(nIt);
+		if (!m_prior.empty()) buildLUT();
 	}
 
 	void CTrainNodeBayes::saveFile(FILE *pFile) const
@@ -85,10 +90,16 @@ namespace DirectGraphicalModels
 			pdf->loadFile(pFile);
 		for (auto &pdf: m_vPDF2D)
 			pdf->loadFile(pFile);
+		buildLUT();
 	} 
 
 	void CTrainNodeBayes::calculateNodePotentials(const Mat &featureVector, Mat &potential, Mat &mask) const
 	{
+		if (!m_vLogLUT.empty() && featureVector.isContinuous()) {
+			calculateNodePotentials(featureVector.ptr<byte>(), 1, potential.ptr<float>(), mask.ptr<byte>());
+			return;
+		}
+
 		m_prior.copyTo(potential);
 		for (byte s = 0; s < m_nStates; s++) {				// state
 			float	* pPot	= potential.ptr<float>(s);
@@ -104,4 +115,71 @@ namespace DirectGraphicalModels
 			} // f
 		} // s
 	}
+
+	void CTrainNodeBayes::calculateNodePotentials(const byte *pFeatureVectors, size_t nSamples, float *pPotentials, byte *pMasks) const
+	{
+		const word	  nFeatures = getNumFeatures();
+		
+		if (!m_vLogLUT.empty()) {
+			vec_float_t vLogPot(m_nStates);
+			for (size_t i = 0; i < nSamples; i++) {
+				const byte	* pFv	= pFeatureVectors + i * nFeatures;
+				float		* pPot	= pPotentials + i * m_nStates;
+				byte		* pMask	= pMasks + i * m_nStates;
+				std::copy(m_vLogPrior.begin(), m_vLogPrior.end(), vLogPot.begin());
+				for (word f = 0; f < nFeatures; f++)			// feature
+					simd::add(vLogPot.data(), m_vLogLUT.data() + (f * 256 + pFv[f]) * m_nStates, m_nStates);
+				for (byte s = 0; s < m_nStates; s++) {			// state
+					if (m_vStateMask[s]) pPot[s] = expf(vLogPot[s]);
+					else {
+						pPot[s] = 0;
+						pMask[s] = 0;
+					}
+				} // s
+			} // i
+			return;
+		}
+
+		const float * pPrior	= m_prior.ptr<float>();
+		for (size_t i = 0; i < nSamples; i++) {
+			const byte	* pFv	= pFeatureVectors + i * nFeatures;
+			float		* pPot	= pPotentials + i * m_nStates;
+			byte		* pMask	= pMasks + i * m_nStates;
+			for (byte s = 0; s < m_nStates; s++) {				// state
+				pPot[s] = pPrior[s];
+				for (word f = 0; f < nFeatures; f++) {			// feature
+					const ptr_pdf_t &pPDF = m_vPDF[f * m_nStates + s];
+					if (pPDF->isEstimated())
+						pPot[s] *= static_cast<float>(pPDF->getDensity(pFv[f]));
+					else {
+						pPot[s] = 0;
+						pMask[s] = 0;
+					}
+				} // f
+			} // s
+		} // i
+	}
+
+	// ---------------------- Private functions ----------------------
+
+	void CTrainNodeBayes::buildLUT(void)
+	{
+		const word	  nFeatures = getNumFeatures();
+		const float * pPrior	= m_prior.ptr<float>();
+
+		m_vLogPrior.resize(m_nStates);
+		for (byte s = 0; s < m_nStates; s++)
+			m_vLogPrior[s] = logf(pPrior[s]);
+
+		m_vStateMask.assign(m_nStates, 1);
+		m_vLogLUT.resize(nFeatures * 256 * m_nStates);
+		for (word f = 0; f < nFeatures; f++) {					// feature
+			for (byte s = 0; s < m_nStates; s++) {				// state
+				const ptr_pdf_t &pPDF = m_vPDF[f * m_nStates + s];
+				if (!pPDF->isEstimated()) m_vStateMask[s] = 0;
+				for (int v = 0; v < 256; v++)
+					m_vLogLUT[(f * 256 + v) * m_nStates + s] = pPDF->isEstimated() ? logf(static_cast<float>(pPDF->getDensity(v))) : 0.0f;
+			} // s
+		} // f
+	}
 }
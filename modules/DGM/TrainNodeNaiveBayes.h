@@ -14,6 +14,8 @@ namespace DirectGraphicalModels
 	* @brief Bayes training class 
 	* @details This class implements the <a href="http://en.wikipedia.org/wiki/Naive_Bayes_classifier" target="blank">naive Bayes classifier</a>,
 	* which is based on strong (naive) independence assumptions between the features.
+	* After training, the PDFs are evaluated for all 256 possible values of every feature and stored in a lookup table of log-densities,
+	* so that the node potentials are calculated with table lookups and additions only. The table is rebuilt by train(), smooth() and loading from file.
 	* @author Sergey G. Kosov, sergey.kosov@project-10.de
 	*/
 	class CTrainNodeBayes : public CTrainNode, private CPriorNode
@@ -68,11 +70,19 @@ namespace DirectGraphicalModels
 		* @param[in,out]	mask Relevant %Node potentials: Mat(size: nStates x 1; type: CV_8UC1). This parameter should be preinitialized and set to value 1 (all potentials are relevant).
 		*/
 		DllExport void calculateNodePotentials(const Mat &featureVector, Mat &potential, Mat &mask) const;
+		DllExport void calculateNodePotentials(const byte *pFeatureVectors, size_t nSamples, float *pPotentials, byte *pMasks) const;
+
+
+	private:
+		void					buildLUT(void);	// fills m_vLogLUT, m_vLogPrior and m_vStateMask from m_vPDF and m_prior
 
 
 	private:
 		std::vector<ptr_pdf_t>	m_vPDF;			///< The 1D PDF for node potentials	 [state][feature]
 		std::vector<ptr_pdf_t>	m_vPDF2D;		///< The 2D data histogram for node potentials and 2 features[state]
 		Mat						m_prior;		///< The class prior probability vector
+		vec_float_t				m_vLogLUT;		///< The log-densities of the 1D PDFs [feature][value][state]; empty if not built
+		vec_float_t				m_vLogPrior;	///< The logarithm of the class prior probability vector
+		vec_byte_t				m_vStateMask;	///< The relevant states: 0 if at least one PDF of the state is not estimated
 	};
 }
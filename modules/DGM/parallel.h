@@ -4,10 +4,132 @@
 #include "types.h"
 #include "macroses.h"
 #include "random.h"
+#ifdef ENABLE_THREADPOOL
+#include "ThreadPool.h"
+#endif
 
 namespace DirectGraphicalModels { namespace parallel {
+// ------------------------------------------- LOOPS -----------------------------------------
+// ------------- parallel algorithms with PPL or with the portable thread pool ---------------
+	/**
+	* @brief Returns the number of threads used by the parallel algorithms
+	* @return The number of threads: number of virtual processors with PPL, number of thread pool threads with the portable thread pool, 1 otherwise
+	*/
+	DllExport inline size_t getNumThreads(void)
+	{
+#if defined(ENABLE_PPL)
+		return MAX(1, concurrency::CurrentScheduler::Get()->GetNumberOfVirtualProcessors());
+#elif defined(ENABLE_THREADPOOL)
+		return CThreadPool::getInstance().getNumThreads();
+#else
+		return 1;
+#endif
+	}
+
+	/**
+	* @brief Sets the number of threads used by the parallel algorithms
+	* @details > This function has effect only with the portable thread pool (\b ENABLE_THREADPOOL option)
+	* @warning This function must not be called while any parallel algorithm is running.
+	* @param nThreads The number of threads. If \b 0, the number of hardware threads is used.
+	*/
+	DllExport inline void setNumThreads(size_t nThreads)
+	{
+#ifdef ENABLE_THREADPOOL
+		CThreadPool::getInstance().setNumThreads(nThreads);
+#else
+		DGM_IF_WARNING(nThreads != getNumThreads(), "The number of threads can be set only with the portable thread pool");
+#endif
+	}
+
+	/**
+	* @brief Parallel for loop
+	* @details Executes \b fn(i) for every \a i in range [\b first; \b last) in parallel. Equivalent of the \a concurrency::parallel_for() function.
+	* @param first The first index of the range
+	* @param last The index, following the last index of the range
+	* @param fn The function to execute for every index
+	*/
+	template <typename T, typename Function>
+	inline void parallel_for(T first, T last, const Function &fn)
+	{
+#if defined(ENABLE_PPL)
+		concurrency::parallel_for(first, last, fn);
+#elif defined(ENABLE_THREADPOOL)
+		CThreadPool::getInstance().run(0, static_cast<int>(last - first), 0, [first, &fn](int begin, int end) {
+			for (int i = begin; i < end; i++) fn(first + static_cast<T>(i));
+		});
+#else
+		for (T i = first; i < last; i++) fn(i);
+#endif
+	}
+
+	/**
+	* @brief Parallel for loop with step
+	* @details Executes \b fn(i) for every \a i = \b first + k * \b step in range [\b first; \b last) in parallel. Equivalent of the \a concurrency::parallel_for() function.
+	* @param first The first index of the range
+	* @param last The index, following the last index of the range
+	* @param step The increment value
+	* @param fn The function to execute for every index
+	*/
+	template <typename T, typename Function>
+	inline void parallel_for(T first, T last, T step, const Function &fn)
+	{
+#if defined(ENABLE_PPL)
+		concurrency::parallel_for(first, last, step, fn);
+#elif defined(ENABLE_THREADPOOL)
+		if (last <= first) return;
+		const int nSteps = static_cast<int>((last - first + step - 1) / step);
+		CThreadPool::getInstance().run(0, nSteps, 0, [first, step, &fn](int begin, int end) {
+			for (int k = begin; k < end; k++) fn(first + static_cast<T>(k) * step);
+		});
+#else
+		for (T i = first; i < last; i += step) fn(i);
+#endif
+	}
+
+	/**
+	* @brief Parallel for each loop
+	* @details Executes \b fn(*it) for every iterator \a it in range [\b first; \b last) in parallel. Equivalent of the \a concurrency::parallel_for_each() function.
+	* @param first The iterator, pointing to the first element
+	* @param last The iterator, pointing to the position following the last element
+	* @param fn The function to execute for every element
+	*/
+	template <typename Iterator, typename Function>
+	inline void parallel_for_each(Iterator first, Iterator last, const Function &fn)
+	{
+#if defined(ENABLE_PPL)
+		concurrency::parallel_for_each(first, last, fn);
+#elif defined(ENABLE_THREADPOOL)
+		CThreadPool::getInstance().run(0, static_cast<int>(std::distance(first, last)), 0, [first, &fn](int begin, int end) {
+			Iterator it = std::next(first, begin);
+			for (int i = begin; i < end; i++, ++it) fn(*it);
+		});
+#else
+		std::for_each(first, last, fn);
+#endif
+	}
+
+	/**
+	* @brief Executes two functions in parallel
+	* @details Equivalent of the \a concurrency::parallel_invoke() function.
+	* @param fn1 The first function
+	* @param fn2 The second function
+	*/
+	template <typename Function1, typename Function2>
+	inline void parallel_invoke(const Function1 &fn1, const Function2 &fn2)
+	{
+#if defined(ENABLE_PPL)
+		concurrency::parallel_invoke(fn1, fn2);
+#elif defined(ENABLE_THREADPOOL)
+		CThreadPool::getInstance().run({ fn1, fn2 });
+#else
+		fn1();
+		fn2();
+#endif
+	}
+
+
 // ------------------------------------------- GEMM ------------------------------------------
-// --------------------- fast generalized matrix multiplication with PPL ---------------------
+// ----------------- fast generalized matrix multiplication with parallel loops --------------
 	/// @cond
 	namespace impl {
 #ifdef ENABLE_AMP
@@ -54,7 +176,7 @@ namespace DirectGraphicalModels { namespace parallel {
 			r.synchronize();
 		}
 #endif
-#ifdef ENABLE_PPL
+#ifdef ENABLE_PARALLEL
 		inline void ppl_gemm(const Mat &A, const Mat &B, float alpha, Mat &res)
 		{
 			DGM_ASSERT(A.cols == B.rows);
@@ -63,7 +185,7 @@ namespace DirectGraphicalModels { namespace parallel {
 			DGM_ASSERT(res.cols == B.cols);
 
 			const Mat _B = B.t();
-			concurrency::parallel_for(0, res.rows, [&](int y) {
+			parallel_for(0, res.rows, [&](int y) {
 				float * pRes = res.ptr<float>(y);
 				const float * pA = A.ptr<float>(y);
 				for (int x = 0; x < res.cols; x++) {
@@ -84,7 +206,7 @@ namespace DirectGraphicalModels { namespace parallel {
 			DGM_ASSERT(res.cols == B.cols && res.cols == C.cols);
 
 			const Mat _B = B.t();
-			concurrency::parallel_for(0, res.rows, [&](int y) {
+			parallel_for(0, res.rows, [&](int y) {
 				float * pRes = res.ptr<float>(y);
 				const float * pA = A.ptr<float>(y);
 				const float * pC = C.ptr<float>(y);
@@ -115,7 +237,7 @@ namespace DirectGraphicalModels { namespace parallel {
 		if (C.empty()) impl::amp_gemm(A, B, alpha, res);
 		else impl::amp_gemm(A, B, alpha, C, beta, res);
 #else 
-#ifdef ENABLE_PPL
+#ifdef ENABLE_PARALLEL
 		if (C.empty()) impl::ppl_gemm(A, B, alpha, res);
 		else impl::ppl_gemm(A, B, alpha, C, beta, res);
 #else
@@ -126,7 +248,7 @@ namespace DirectGraphicalModels { namespace parallel {
 
 	
 	// -------------------------------------------- SORT -------------------------------------------
-	// --------------------------- fast sorting of Mat elements with PPL  --------------------------
+	// ------------------------ fast sorting of Mat elements with parallel loops -------------------
 	namespace {
         inline void Swap(Mat &a, Mat &b, Mat &tmp = EmptyMat)
 		{
@@ -174,7 +296,7 @@ namespace DirectGraphicalModels { namespace parallel {
 			}
 		}
 
-#ifdef ENABLE_PPL
+#ifdef ENABLE_PARALLEL
 		template <typename T>
 		inline void parallel_quick_sort(Mat &m, int x, int begin, int end, int threshold, int depthRemaining)
 		{
@@ -189,7 +311,7 @@ namespace DirectGraphicalModels { namespace parallel {
 					while (m.at<T>(_begin, x) < pivot) _begin++;
 					while (m.at<T>(_end,   x) > pivot) _end--;
 					if (_begin <= _end) {
-						Swap(m.row(_begin), m.row(_end));
+						Swap(lvalue_cast(m.row(_begin)), lvalue_cast(m.row(_end)));
 						_begin++;
 						_end--;
 					}
@@ -197,7 +319,7 @@ namespace DirectGraphicalModels { namespace parallel {
 
 				// recursion 
 				if (depthRemaining > 0)
-					concurrency::parallel_invoke(
+					parallel_invoke(
 						[&, x, begin, _end] { if (begin < _end)	parallel_quick_sort<T>(m, x, begin, _end, threshold, depthRemaining - 1); },
 						[&, x, end, _begin] { if (_begin < end)	parallel_quick_sort<T>(m, x, _begin, end, threshold, depthRemaining - 1); }
 				);
@@ -213,7 +335,7 @@ namespace DirectGraphicalModels { namespace parallel {
 	/**
 	* @brief Sorts the rows of the input matrix by the given dimension.
 	* @details The result of the sorting may is expressed as: \f$ m_{x,y} < m_{x,y+1}, \forall y \f$.
-	* > This function supports PPL.
+	* > This function supports parallel computing.
 	* @tparam T The type of elements in matrix.
 	* @param[in, out] m The input/output data, which rows should be sorted.
 	* @param x The dimension along which the matrix is sorted.
@@ -222,8 +344,8 @@ namespace DirectGraphicalModels { namespace parallel {
 	DllExport inline void sortRows(Mat &m, int x)
 	{
 		DGM_ASSERT(x < m.cols);
-#ifdef ENABLE_PPL
-		const int nCores = MAX(1, concurrency::CurrentScheduler::Get()->GetNumberOfVirtualProcessors());
+#ifdef ENABLE_PARALLEL
+		const int nCores = static_cast<int>(getNumThreads());
 		parallel_quick_sort<T>(m, x, 0, m.rows - 1, 200, static_cast<int>(log2f(float(nCores))) + 4);
 #else 
 		sequential_quick_sort<T>(m, x, 0, m.rows - 1, 200);
@@ -237,8 +359,8 @@ namespace DirectGraphicalModels { namespace parallel {
 			if (depth == m.cols) return;				// we are too deep
 			if (begin == end)    return;				// do not sort one element
 
-#ifdef ENABLE_PPL
-			const int nCores = MAX(1, concurrency::CurrentScheduler::Get()->GetNumberOfVirtualProcessors());
+#ifdef ENABLE_PARALLEL
+			const int nCores = static_cast<int>(getNumThreads());
 			parallel_quick_sort<T>(m, depth, begin, end, 200, static_cast<int>(log2f(float(nCores))) + 4);
 #else 
 			sequential_quick_sort<T>(m, depth, begin, end, 200);
@@ -260,7 +382,7 @@ namespace DirectGraphicalModels { namespace parallel {
 	/**
 	* @brief Sorts the rows of the input matrix
 	* @details 
-	* > This function supports PPL.
+	* > This function supports parallel computing.
 	* @tparam T The type of elements in matrix.
 	* @param[in, out] m The input/output data, which rows should be sorted.
 	*/
@@ -271,26 +393,25 @@ namespace DirectGraphicalModels { namespace parallel {
 	}
 
 	// ------------------------------------------- SUFFLE ------------------------------------------
-	// ----------------------- fast random shuffle of Mat elements with PPL  -----------------------
+	// -------------------- fast random shuffle of Mat elements with parallel loops -----------------
 	/**
 	* @brief Randomly shuffles the rows of the input matrix.
-	* @details > This function supports PPL.
-	* > When using PPL, the result of this function is biased.
+	* @details > This function supports parallel computing.
+	* > When using parallel computing, the result of this function is biased.
 	* @param[in,out] m The input/output data, which rows should be shffled.
 	* @todo Eliminate the bias, caused by parallel processing.
 	*/
 	DllExport inline void shuffleRows(Mat &m)
 	{
-#ifdef ENABLE_PPL
-		// int nCores = MAX(1, std::thread::hardware_concurrency());
-		int nCores = MAX(1, concurrency::CurrentScheduler::Get()->GetNumberOfVirtualProcessors());
+#ifdef ENABLE_PARALLEL
+		int nCores = static_cast<int>(getNumThreads());
 		int step = MAX(2, m.rows / (nCores * 10));
-		concurrency::parallel_for(0, m.rows, step, [step, &m](int S) {
+		parallel_for(0, m.rows, step, [step, &m](int S) {
 			Mat tmp;
 			int last = MIN(S + step, m.rows);
 			for (int s = last - 1; s > S; s--) {									// s = [last - 1; S + 1]
 				dword r = DirectGraphicalModels::random::u<dword>(S, s);			// r = [S; s] = [S; S + 1] -> [S; last - 1]
-				if (r != s) Swap(m.row(s), m.row(r), tmp);
+				if (r != s) Swap(lvalue_cast(m.row(s)), lvalue_cast(m.row(r)), tmp);
 			}
 		});
 #else	
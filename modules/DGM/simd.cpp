@@ -0,0 +1,542 @@
+#include "simd.h"
+#include "macroses.h"
+
+#ifdef ENABLE_SIMD
+	#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+		#define DGM_SIMD_X86
+		#include <immintrin.h>
+		#ifdef _MSC_VER
+			#include <intrin.h>
+		#endif
+	#elif defined(__ARM_NEON) || defined(_M_ARM64)
+		#define DGM_SIMD_NEON
+		#include <arm_neon.h>
+	#endif
+#endif
+
+// Enables the instruction set for one function, so that the rest of the library does not depend on the compiler flags
+#if defined(DGM_SIMD_X86) && !defined(_MSC_VER)
+	#define DGM_TARGET(isa) __attribute__((target(isa)))
+#else
+	#define DGM_TARGET(isa)
+#endif
+
+namespace DirectGraphicalModels { namespace simd {
+	namespace {
+		// Table of the kernels for one instruction set
+		struct CKernels {
+			void	(*mul)(float *dst, const float *src, size_t n);
+			void	(*softMul)(float *dst, const float *src, float epsilon, size_t n);
+			void	(*div)(float *dst, float val, size_t n);
+			float	(*sum)(const float *src, size_t n);
+			void	(*sqrMulAdd)(float *dst, const float *M, float v, size_t n);
+			void	(*sqrMulMax)(float *dst, const float *M, float v, size_t n);
+			void	(*add)(float *dst, const float *src, size_t n);
+			void	(*addMin)(float *dst, const float *E, float v, size_t n);
+			void	(*axpy)(float *dst, const float *src, float a, size_t n);
+		};
+
+		// ------------------------------ Scalar ------------------------------
+		void mul_scalar(float *dst, const float *src, size_t n)
+		{
+			for (size_t i = 0; i < n; i++) dst[i] *= src[i];
+		}
+		void softMul_scalar(float *dst, const float *src, float epsilon, size_t n)
+		{
+			for (size_t i = 0; i < n; i++) dst[i] = (epsilon + dst[i]) * (epsilon + src[i]);
+		}
+		void div_scalar(float *dst, float val, size_t n)
+		{
+			for (size_t i = 0; i < n; i++) dst[i] /= val;
+		}
+		float sum_scalar(const float *src, size_t n)
+		{
+			float res = 0;
+			for (size_t i = 0; i < n; i++) res += src[i];
+			return res;
+		}
+		void sqrMulAdd_scalar(float *dst, const float *M, float v, size_t n)
+		{
+			for (size_t i = 0; i < n; i++) dst[i] += v * M[i] * M[i];
+		}
+		void sqrMulMax_scalar(float *dst, const float *M, float v, size_t n)
+		{
+			for (size_t i = 0; i < n; i++) {
+				float prod = v * M[i] * M[i];
+				if (prod > dst[i]) dst[i] = prod;
+			}
+		}
+		void add_scalar(float *dst, const float *src, size_t n)
+		{
+			for (size_t i = 0; i < n; i++) dst[i] += src[i];
+		}
+		void addMin_scalar(float *dst, const float *E, float v, size_t n)
+		{
+			for (size_t i = 0; i < n; i++) {
+				float sum = v + E[i];
+				if (sum < dst[i]) dst[i] = sum;
+			}
+		}
+		void axpy_scalar(float *dst, const float *src, float a, size_t n)
+		{
+			for (size_t i = 0; i < n; i++) dst[i] += a * src[i];
+		}
+		const CKernels kernels_scalar = { mul_scalar, softMul_scalar, div_scalar, sum_scalar, sqrMulAdd_scalar, sqrMulMax_scalar, add_scalar, addMin_scalar, axpy_scalar };
+
+#ifdef DGM_SIMD_X86
+		// ------------------------------ SSE2 ------------------------------
+		DGM_TARGET("sse2") void mul_sse(float *dst, const float *src, size_t n)
+		{
+			size_t i = 0;
+			for (; i + 4 <= n; i += 4) _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_loadu_ps(dst + i), _mm_loadu_ps(src + i)));
+			for (; i < n; i++) dst[i] *= src[i];
+		}
+		DGM_TARGET("sse2") void softMul_sse(float *dst, const float *src, float epsilon, size_t n)
+		{
+			const __m128 eps = _mm_set1_ps(epsilon);
+			size_t i = 0;
+			for (; i + 4 <= n; i += 4) _mm_storeu_ps(dst + i, _mm_mul_ps(_mm_add_ps(eps, _mm_loadu_ps(dst + i)), _mm_add_ps(eps, _mm_loadu_ps(src + i))));
+			for (; i < n; i++) dst[i] = (epsilon + dst[i]) * (epsilon + src[i]);
+		}
+		DGM_TARGET("sse2") void div_sse(float *dst, float val, size_t n)
+		{
+			const __m128 d = _mm_set1_ps(val);
+			size_t i = 0;
+			for (; i + 4 <= n; i += 4) _mm_storeu_ps(dst + i, _mm_div_ps(_mm_loadu_ps(dst + i), d));
+			for (; i < n; i++) dst[i] /= val;
+		}
+		DGM_TARGET("sse2") float sum_sse(const float *src, size_t n)
+		{
+			__m128 acc = _mm_setzero_ps();
+			size_t i = 0;
+			for (; i + 4 <= n; i += 4) acc = _mm_add_ps(acc, _mm_loadu_ps(src + i));
+			acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+			acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 1));
+			float res = _mm_cvtss_f32(acc);
+			for (; i < n; i++) res += src[i];
+			return res;
+		}
+		DGM_TARGET("sse2") void sqrMulAdd_sse(float *dst, const float *M, float v, size_t n)
+		{
+			const __m128 w = _mm_set1_ps(v);
+			size_t i = 0;
+			for (; i + 4 <= n; i += 4) {
+				const __m128 m = _mm_loadu_ps(M + i);
+				_mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), _mm_mul_ps(_mm_mul_ps(w, m), m)));
+			}
+			for (; i < n; i++) dst[i] += v * M[i] * M[i];
+		}
+		DGM_TARGET("sse2") void sqrMulMax_sse(float *dst, const float *M, float v, size_t n)
+		{
+			const __m128 w = _mm_set1_ps(v);
+			size_t i = 0;
+			for (; i + 4 <= n; i += 4) {
+				const __m128 m = _mm_loadu_ps(M + i);
+				_mm_storeu_ps(dst + i, _mm_max_ps(_mm_loadu_ps(dst + i), _mm_mul_ps(_mm_mul_ps(w, m), m)));
+			}
+			for (; i < n; i++) dst[i] = MAX(dst[i], v * M[i] * M[i]);
+		}
+		DGM_TARGET("sse2") void add_sse(float *dst, const float *src, size_t n)
+		{
+			size_t i = 0;
+			for (; i + 4 <= n; i += 4) _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), _mm_loadu_ps(src + i)));
+			for (; i < n; i++) dst[i] += src[i];
+		}
+		DGM_TARGET("sse2") void addMin_sse(float *dst, const float *E, float v, size_t n)
+		{
+			const __m128 w = _mm_set1_ps(v);
+			size_t i = 0;
+			for (; i + 4 <= n; i += 4) _mm_storeu_ps(dst + i, _mm_min_ps(_mm_loadu_ps(dst + i), _mm_add_ps(w, _mm_loadu_ps(E + i))));
+			for (; i < n; i++) dst[i] = MIN(dst[i], v + E[i]);
+		}
+		DGM_TARGET("sse2") void axpy_sse(float *dst, const float *src, float a, size_t n)
+		{
+			const __m128 w = _mm_set1_ps(a);
+			size_t i = 0;
+			for (; i + 4 <= n; i += 4) _mm_storeu_ps(dst + i, _mm_add_ps(_mm_loadu_ps(dst + i), _mm_mul_ps(w, _mm_loadu_ps(src + i))));
+			for (; i < n; i++) dst[i] += a * src[i];
+		}
+		const CKernels kernels_sse = { mul_sse, softMul_sse, div_sse, sum_sse, sqrMulAdd_sse, sqrMulMax_sse, add_sse, addMin_sse, axpy_sse };
+
+		// ------------------------------ AVX2 ------------------------------
+		// The AVX kernels clear the upper halves of the registers on exit: the calling code may be compiled with the legacy SSE instructions
+		// and would suffer from the AVX-SSE transition penalties otherwise
+		DGM_TARGET("avx2") void mul_avx2(float *dst, const float *src, size_t n)
+		{
+			size_t i = 0;
+			for (; i + 8 <= n; i += 8) _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_loadu_ps(dst + i), _mm256_loadu_ps(src + i)));
+			for (; i < n; i++) dst[i] *= src[i];
+			_mm256_zeroupper();
+		}
+		DGM_TARGET("avx2") void softMul_avx2(float *dst, const float *src, float epsilon, size_t n)
+		{
+			const __m256 eps = _mm256_set1_ps(epsilon);
+			size_t i = 0;
+			for (; i + 8 <= n; i += 8) _mm256_storeu_ps(dst + i, _mm256_mul_ps(_mm256_add_ps(eps, _mm256_loadu_ps(dst + i)), _mm256_add_ps(eps, _mm256_loadu_ps(src + i))));
+			for (; i < n; i++) dst[i] = (epsilon + dst[i]) * (epsilon + src[i]);
+			_mm256_zeroupper();
+		}
+		DGM_TARGET("avx2") void div_avx2(float *dst, float val, size_t n)
+		{
+			const __m256 d = _mm256_set1_ps(val);
+			size_t i = 0;
+			for (; i + 8 <= n; i += 8) _mm256_storeu_ps(dst + i, _mm256_div_ps(_mm256_loadu_ps(dst + i), d));
+			for (; i < n; i++) dst[i] /= val;
+			_mm256_zeroupper();
+		}
+		DGM_TARGET("avx2") float sum_avx2(const float *src, size_t n)
+		{
+			__m256 acc = _mm256_setzero_ps();
+			size_t i = 0;
+			for (; i + 8 <= n; i += 8) acc = _mm256_add_ps(acc, _mm256_loadu_ps(src + i));
+			__m128 acc4 = _mm_add_ps(_mm256_castps256_ps128(acc), _mm256_extractf128_ps(acc, 1));
+			acc4 = _mm_add_ps(acc4, _mm_movehl_ps(acc4, acc4));
+			acc4 = _mm_add_ss(acc4, _mm_shuffle_ps(acc4, acc4, 1));
+			float res = _mm_cvtss_f32(acc4);
+			for (; i < n; i++) res += src[i];
+			_mm256_zeroupper();
+			return res;
+		}
+		DGM_TARGET("avx2") void sqrMulAdd_avx2(float *dst, const float *M, float v, size_t n)
+		{
+			const __m256 w = _mm256_set1_ps(v);
+			size_t i = 0;
+			for (; i + 8 <= n; i += 8) {
+				const __m256 m = _mm256_loadu_ps(M + i);
+				_mm256_storeu_ps(dst + i, _mm256_add_ps(_mm256_loadu_ps(dst + i), _mm256_mul_ps(_mm256_mul_ps(w, m), m)));
+			}
+			for (; i < n; i++) dst[i] += v * M[i] * M[i];
+			_mm256_zeroupper();
+		}
+		DGM_TARGET("avx2") void sqrMulMax_avx2(float *dst, const float *M, float v, size_t n)
+		{
+			const __m256 w = _mm256_set1_ps(v);
+			size_t i = 0;
+			for (; i + 8 <= n; i += 8) {
+				const __m256 m = _mm256_loadu_ps(M + i);
+				_mm256_storeu_ps(dst + i, _mm256_max_ps(_mm256_loadu_ps(dst + i), _mm256_mul_ps(_mm256_mul_ps(w, m), m)));
+			}
+			for (; i < n; i++) dst[i] = MAX(dst[i], v * M[i] * M[i]);
+			_mm256_zeroupper();
+		}
+		DGM_TARGET("avx2") void add_avx2(float *dst, const float *src, size_t n)
+		{
+			size_t i = 0;
+			for (; i + 8 <= n; i += 8) _mm256_storeu_ps(dst + i, _mm256_add_ps(_mm256_loadu_ps(dst + i), _mm256_loadu_ps(src + i)));
+			for (; i < n; i++) dst[i] += src[i];
+			_mm256_zeroupper();
+		}
+		DGM_TARGET("avx2") void addMin_avx2(float *dst, const float *E, float v, size_t n)
+		{
+			const __m256 w = _mm256_set1_ps(v);
+			size_t i = 0;
+			for (; i + 8 <= n; i += 8) _mm256_storeu_ps(dst + i, _mm256_min_ps(_mm256_loadu_ps(dst + i), _mm256_add_ps(w, _mm256_loadu_ps(E + i))));
+			for (; i < n; i++) dst[i] = MIN(dst[i], v + E[i]);
+			_mm256_zeroupper();
+		}
+		DGM_TARGET("avx2") void axpy_avx2(float *dst, const float *src, float a, size_t n)
+		{
+			const __m256 w = _mm256_set1_ps(a);
+			size_t i = 0;
+			for (; i + 8 <= n; i += 8) _mm256_storeu_ps(dst + i, _mm256_add_ps(_mm256_loadu_ps(dst + i), _mm256_mul_ps(w, _mm256_loadu_ps(src + i))));
+			for (; i < n; i++) dst[i] += a * src[i];
+			_mm256_zeroupper();
+		}
+		const CKernels kernels_avx2 = { mul_avx2, softMul_avx2, div_avx2, sum_avx2, sqrMulAdd_avx2, sqrMulMax_avx2, add_avx2, addMin_avx2, axpy_avx2 };
+
+		// ------------------------------ AVX-512 ------------------------------
+		// The remaining elements are processed with the masked loads and stores
+		inline __mmask16 tailMask(size_t n) { return static_cast<__mmask16>((1u << n) - 1); }
+
+		DGM_TARGET("avx512f") void mul_avx512(float *dst, const float *src, size_t n)
+		{
+			size_t i = 0;
+			for (; i + 16 <= n; i += 16) _mm512_storeu_ps(dst + i, _mm512_mul_ps(_mm512_loadu_ps(dst + i), _mm512_loadu_ps(src + i)));
+			if (i < n) {
+				const __mmask16 k = tailMask(n - i);
+				_mm512_mask_storeu_ps(dst + i, k, _mm512_mul_ps(_mm512_maskz_loadu_ps(k, dst + i), _mm512_maskz_loadu_ps(k, src + i)));
+			}
+			_mm256_zeroupper();
+		}
+		DGM_TARGET("avx512f") void softMul_avx512(float *dst, const float *src, float epsilon, size_t n)
+		{
+			const __m512 eps = _mm512_set1_ps(epsilon);
+			size_t i = 0;
+			for (; i + 16 <= n; i += 16) _mm512_storeu_ps(dst + i, _mm512_mul_ps(_mm512_add_ps(eps, _mm512_loadu_ps(dst + i)), _mm512_add_ps(eps, _mm512_loadu_ps(src + i))));
+			if (i < n) {
+				const __mmask16 k = tailMask(n - i);
+				_mm512_mask_storeu_ps(dst + i, k, _mm512_mul_ps(_mm512_add_ps(eps, _mm512_maskz_loadu_ps(k, dst + i)), _mm512_add_ps(eps, _mm512_maskz_loadu_ps(k, src + i))));
+			}
+			_mm256_zeroupper();
+		}
+		DGM_TARGET("avx512f") void div_avx512(float *dst, float val, size_t n)
+		{
+			const __m512 d = _mm512_set1_ps(val);
+			size_t i = 0;
+			for (; i + 16 <= n; i += 16) _mm512_storeu_ps(dst + i, _mm512_div_ps(_mm512_loadu_ps(dst + i), d));
+			if (i < n) {
+				const __mmask16 k = tailMask(n - i);
+				_mm512_mask_storeu_ps(dst + i, k, _mm512_div_ps(_mm512_maskz_loadu_ps(k, dst + i), d));
+			}
+			_mm256_zeroupper();
+		}
+		DGM_TARGET("avx512f") float sum_avx512(const float *src, size_t n)
+		{
+			__m512 acc = _mm512_setzero_ps();
+			size_t i = 0;
+			for (; i + 16 <= n; i += 16) acc = _mm512_add_ps(acc, _mm512_loadu_ps(src + i));
+			if (i < n) acc = _mm512_add_ps(acc, _mm512_maskz_loadu_ps(tailMask(n - i), src + i));
+			const float res = _mm512_reduce_add_ps(acc);
+			_mm256_zeroupper();
+			return res;
+		}
+		DGM_TARGET("avx512f") void sqrMulAdd_avx512(float *dst, const float *M, float v, size_t n)
+		{
+			const __m512 w = _mm512_set1_ps(v);
+			size_t i = 0;
+			for (; i + 16 <= n; i += 16) {
+				const __m512 m = _mm512_loadu_ps(M + i);
+				_mm512_storeu_ps(dst + i, _mm512_add_ps(_mm512_loadu_ps(dst + i), _mm512_mul_ps(_mm512_mul_ps(w, m), m)));
+			}
+			if (i < n) {
+				const __mmask16 k = tailMask(n - i);
+				const __m512 m = _mm512_maskz_loadu_ps(k, M + i);
+				_mm512_mask_storeu_ps(dst + i, k, _mm512_add_ps(_mm512_maskz_loadu_ps(k, dst + i), _mm512_mul_ps(_mm512_mul_ps(w, m), m)));
+			}
+			_mm256_zeroupper();
+		}
+		DGM_TARGET("avx512f") void sqrMulMax_avx512(float *dst, const float *M, float v, size_t n)
+		{
+			const __m512 w = _mm512_set1_ps(v);
+			size_t i = 0;
+			for (; i + 16 <= n; i += 16) {
+				const __m512 m = _mm512_loadu_ps(M + i);
+				_mm512_storeu_ps(dst + i, _mm512_max_ps(_mm512_loadu_ps(dst + i), _mm512_mul_ps(_mm512_mul_ps(w, m), m)));
+			}
+			if (i < n) {
+				const __mmask16 k = tailMask(n - i);
+				const __m512 m = _mm512_maskz_loadu_ps(k, M + i);
+				_mm512_mask_storeu_ps(dst + i, k, _mm512_max_ps(_mm512_maskz_loadu_ps(k, dst + i), _mm512_mul_ps(_mm512_mul_ps(w, m), m)));
+			}
+			_mm256_zeroupper();
+		}
+		DGM_TARGET("avx512f") void add_avx512(float *dst, const float *src, size_t n)
+		{
+			size_t i = 0;
+			for (; i + 16 <= n; i += 16) _mm512_storeu_ps(dst + i, _mm512_add_ps(_mm512_loadu_ps(dst + i), _mm512_loadu_ps(src + i)));
+			if (i < n) {
+				const __mmask16 k = tailMask(n - i);
+				_mm512_mask_storeu_ps(dst + i, k, _mm512_add_ps(_mm512_maskz_loadu_ps(k, dst + i), _mm512_maskz_loadu_ps(k, src + i)));
+			}
+			_mm256_zeroupper();
+		}
+		DGM_TARGET("avx512f") void addMin_avx512(float *dst, const float *E, float v, size_t n)
+		{
+			const __m512 w = _mm512_set1_ps(v);
+			size_t i = 0;
+			for (; i + 16 <= n; i += 16) _mm512_storeu_ps(dst + i, _mm512_min_ps(_mm512_loadu_ps(dst + i), _mm512_add_ps(w, _mm512_loadu_ps(E + i))));
+			if (i < n) {
+				const __mmask16 k = tailMask(n - i);
+				_mm512_mask_storeu_ps(dst + i, k, _mm512_min_ps(_mm512_maskz_loadu_ps(k, dst + i), _mm512_add_ps(w, _mm512_maskz_loadu_ps(k, E + i))));
+			}
+			_mm256_zeroupper();
+		}
+		DGM_TARGET("avx512f") void axpy_avx512(float *dst, const float *src, float a, size_t n)
+		{
+			const __m512 w = _mm512_set1_ps(a);
+			size_t i = 0;
+			for (; i + 16 <= n; i += 16) _mm512_storeu_ps(dst + i, _mm512_add_ps(_mm512_loadu_ps(dst + i), _mm512_mul_ps(w, _mm512_loadu_ps(src + i))));
+			if (i < n) {
+				const __mmask16 k = tailMask(n - i);
+				_mm512_mask_storeu_ps(dst + i, k, _mm512_add_ps(_mm512_maskz_loadu_ps(k, dst + i), _mm512_mul_ps(w, _mm512_maskz_loadu_ps(k, src + i))));
+			}
+			_mm256_zeroupper();
+		}
+		const CKernels kernels_avx512 = { mul_avx512, softMul_avx512, div_avx512, sum_avx512, sqrMulAdd_avx512, sqrMulMax_avx512, add_avx512, addMin_avx512, axpy_avx512 };
+
+		// Checks whether the processor and the operating system support the instruction set
+		bool cpuSupports(ISA isa)
+		{
+	#ifdef _MSC_VER
+			int info[4];
+			__cpuid(info, 0);
+			const int nIds = info[0];
+			__cpuid(info, 1);
+			const bool sse2		= (info[3] & (1 << 26)) != 0;
+			const bool osxsave	= (info[2] & (1 << 27)) != 0;
+			const unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+			int info7[4] = { 0, 0, 0, 0 };
+			if (nIds >= 7) __cpuidex(info7, 7, 0);
+			switch (isa) {
+				case ISA::SSE:		return sse2;
+				case ISA::AVX2:		return (xcr0 & 0x06) == 0x06 && (info7[1] & (1 << 5)) != 0;
+				case ISA::AVX512:	return (xcr0 & 0xE6) == 0xE6 && (info7[1] & (1 << 16)) != 0;
+				default:			return false;
+			}
+	#else
+			__builtin_cpu_init();
+			switch (isa) {
+				case ISA::SSE:		return __builtin_cpu_supports("sse2") != 0;
+				case ISA::AVX2:		return __builtin_cpu_supports("avx2") != 0;
+				case ISA::AVX512:	return __builtin_cpu_supports("avx512f") != 0;
+				default:			return false;
+			}
+	#endif
+		}
+#endif
+
+#ifdef DGM_SIMD_NEON
+		// ------------------------------ NEON ------------------------------
+		void mul_neon(float *dst, const float *src, size_t n)
+		{
+			size_t i = 0;
+			for (; i + 4 <= n; i += 4) vst1q_f32(dst + i, vmulq_f32(vld1q_f32(dst + i), vld1q_f32(src + i)));
+			for (; i < n; i++) dst[i] *= src[i];
+		}
+		void softMul_neon(float *dst, const float *src, float epsilon, size_t n)
+		{
+			const float32x4_t eps = vdupq_n_f32(epsilon);
+			size_t i = 0;
+			for (; i + 4 <= n; i += 4) vst1q_f32(dst + i, vmulq_f32(vaddq_f32(eps, vld1q_f32(dst + i)), vaddq_f32(eps, vld1q_f32(src + i))));
+			for (; i < n; i++) dst[i] = (epsilon + dst[i]) * (epsilon + src[i]);
+		}
+		void div_neon(float *dst, float val, size_t n)
+		{
+	#ifdef __aarch64__
+			const float32x4_t d = vdupq_n_f32(val);
+			size_t i = 0;
+			for (; i + 4 <= n; i += 4) vst1q_f32(dst + i, vdivq_f32(vld1q_f32(dst + i), d));
+			for (; i < n; i++) dst[i] /= val;
+	#else
+			div_scalar(dst, val, n);																	// ARMv7 NEON has no division
+	#endif
+		}
+		float sum_neon(const float *src, size_t n)
+		{
+			float32x4_t acc = vdupq_n_f32(0);
+			size_t i = 0;
+			for (; i + 4 <= n; i += 4) acc = vaddq_f32(acc, vld1q_f32(src + i));
+			float32x2_t acc2 = vadd_f32(vget_low_f32(acc), vget_high_f32(acc));
+			float res = vget_lane_f32(vpadd_f32(acc2, acc2), 0);
+			for (; i < n; i++) res += src[i];
+			return res;
+		}
+		void sqrMulAdd_neon(float *dst, const float *M, float v, size_t n)
+		{
+			const float32x4_t w = vdupq_n_f32(v);
+			size_t i = 0;
+			for (; i + 4 <= n; i += 4) {
+				const float32x4_t m = vld1q_f32(M + i);
+				vst1q_f32(dst + i, vaddq_f32(vld1q_f32(dst + i), vmulq_f32(vmulq_f32(w, m), m)));
+			}
+			for (; i < n; i++) dst[i] += v * M[i] * M[i];
+		}
+		void sqrMulMax_neon(float *dst, const float *M, float v, size_t n)
+		{
+			const float32x4_t w = vdupq_n_f32(v);
+			size_t i = 0;
+			for (; i + 4 <= n; i += 4) {
+				const float32x4_t m = vld1q_f32(M + i);
+				vst1q_f32(dst + i, vmaxq_f32(vld1q_f32(dst + i), vmulq_f32(vmulq_f32(w, m), m)));
+			}
+			for (; i < n; i++) dst[i] = MAX(dst[i], v * M[i] * M[i]);
+		}
+		void add_neon(float *dst, const float *src, size_t n)
+		{
+			size_t i = 0;
+			for (; i + 4 <= n; i += 4) vst1q_f32(dst + i, vaddq_f32(vld1q_f32(dst + i), vld1q_f32(src + i)));
+			for (; i < n; i++) dst[i] += src[i];
+		}
+		void addMin_neon(float *dst, const float *E, float v, size_t n)
+		{
+			const float32x4_t w = vdupq_n_f32(v);
+			size_t i = 0;
+			for (; i + 4 <= n; i += 4) vst1q_f32(dst + i, vminq_f32(vld1q_f32(dst + i), vaddq_f32(w, vld1q_f32(E + i))));
+			for (; i < n; i++) dst[i] = MIN(dst[i], v + E[i]);
+		}
+		void axpy_neon(float *dst, const float *src, float a, size_t n)
+		{
+			const float32x4_t w = vdupq_n_f32(a);
+			size_t i = 0;
+			for (; i + 4 <= n; i += 4) vst1q_f32(dst + i, vaddq_f32(vld1q_f32(dst + i), vmulq_f32(w, vld1q_f32(src + i))));
+			for (; i < n; i++) dst[i] += a * src[i];
+		}
+		const CKernels kernels_neon = { mul_neon, softMul_neon, div_neon, sum_neon, sqrMulAdd_neon, sqrMulMax_neon, add_neon, addMin_neon, axpy_neon };
+#endif
+
+		const CKernels * getKernels(ISA isa)
+		{
+			switch (isa) {
+#ifdef DGM_SIMD_X86
+				case ISA::SSE:		return &kernels_sse;
+				case ISA::AVX2:		return &kernels_avx2;
+				case ISA::AVX512:	return &kernels_avx512;
+#endif
+#ifdef DGM_SIMD_NEON
+				case ISA::NEON:		return &kernels_neon;
+#endif
+				default:			return &kernels_scalar;
+			}
+		}
+
+		ISA getBestISA(void)
+		{
+			for (ISA isa : { ISA::AVX512, ISA::AVX2, ISA::NEON, ISA::SSE })
+				if (isSupported(isa)) return isa;
+			return ISA::scalar;
+		}
+
+		ISA				  g_isa			= getBestISA();			// The instruction set used by the kernels
+		const CKernels	* g_pKernels	= getKernels(g_isa);	// The kernels for the instruction set g_isa
+	}
+
+	bool isSupported(ISA isa)
+	{
+		switch (isa) {
+			case ISA::scalar:	return true;
+#ifdef DGM_SIMD_X86
+			case ISA::SSE:
+			case ISA::AVX2:
+			case ISA::AVX512:	return cpuSupports(isa);
+#endif
+#ifdef DGM_SIMD_NEON
+			case ISA::NEON:		return true;
+#endif
+			default:			return false;
+		}
+	}
+
+	ISA getISA(void)
+	{
+		return g_isa;
+	}
+
+	void setISA(ISA isa)
+	{
+		DGM_ASSERT_MSG(isSupported(isa), "The instruction set %s is not supported", getISAName(isa));
+		g_isa		= isa;
+		g_pKernels	= getKernels(isa);
+	}
+
+	const char * getISAName(ISA isa)
+	{
+		switch (isa) {
+			case ISA::scalar:	return "scalar";
+			case ISA::SSE:		return "SSE2";
+			case ISA::NEON:		return "NEON";
+			case ISA::AVX2:		return "AVX2";
+			case ISA::AVX512:	return "AVX-512";
+			default:			return "unknown";
+		}
+	}
+
+	void	mul(float *dst, const float *src, size_t n)						{ g_pKernels->mul(dst, src, n); }
+	void	softMul(float *dst, const float *src, float epsilon, size_t n)	{ g_pKernels->softMul(dst, src, epsilon, n); }
+	void	div(float *dst, float val, size_t n)							{ g_pKernels->div(dst, val, n); }
+	float	sum(const float *src, size_t n)									{ return g_pKernels->sum(src, n); }
+	void	sqrMulAdd(float *dst, const float *M, float v, size_t n)		{ g_pKernels->sqrMulAdd(dst, M, v, n); }
+	void	sqrMulMax(float *dst, const float *M, float v, size_t n)		{ g_pKernels->sqrMulMax(dst, M, v, n); }
+	void	add(float *dst, const float *src, size_t n)						{ g_pKernels->add(dst, src, n); }
+	void	addMin(float *dst, const float *E, float v, size_t n)			{ g_pKernels->addMin(dst, E, v, n); }
+	void	axpy(float *dst, const float *src, float a, size_t n)			{ g_pKernels->axpy(dst, src, a, n); }
+} }
@@ -0,0 +1,117 @@
+// Vectorized kernels for the message passing algorithms with runtime dispatching
+#pragma once
+
+#include "types.h"
+
+namespace DirectGraphicalModels { namespace simd {
+	/// Instruction sets of the vectorized kernels
+	enum class ISA : byte {
+		scalar,			///< Plain C++ code
+		SSE,			///< SSE2 (x86)
+		NEON,			///< NEON (ARM)
+		AVX2,			///< AVX2 (x86)
+		AVX512			///< AVX-512F (x86)
+	};
+
+	/**
+	* @brief Checks whether the instruction set is supported by the library and the processor
+	* @param isa The instruction set
+	* @retval true if the kernels may use the instruction set \b isa
+	* @retval false otherwise
+	*/
+	DllExport bool			isSupported(ISA isa);
+	/**
+	* @brief Returns the instruction set used by the kernels
+	* @details By default the kernels use the best instruction set supported by the processor. If the library is built without \b ENABLE_SIMD option,
+	* only the plain C++ code is available.
+	* @return The instruction set used by the kernels
+	*/
+	DllExport ISA			getISA(void);
+	/**
+	* @brief Sets the instruction set used by the kernels
+	* @details This function is useful for benchmarking and testing
+	* @warning This function must not be called while any kernel is running.
+	* @param isa The instruction set. It must be supported (see isSupported()).
+	*/
+	DllExport void			setISA(ISA isa);
+	/**
+	* @brief Returns the name of the instruction set
+	* @param isa The instruction set
+	* @return The name of the instruction set
+	*/
+	DllExport const char  * getISAName(ISA isa);
+
+	/**
+	* @brief Element-wise product: \f$ dst[i] = dst[i]\cdot src[i] \f$
+	* @param[in,out] dst Array of length \b n
+	* @param[in] src Array of length \b n
+	* @param[in] n Length of the arrays
+	*/
+	DllExport void			mul(float *dst, const float *src, size_t n);
+	/**
+	* @brief Element-wise soft product: \f$ dst[i] = (\epsilon + dst[i])\cdot(\epsilon + src[i]) \f$
+	* @param[in,out] dst Array of length \b n
+	* @param[in] src Array of length \b n
+	* @param[in] epsilon The additive constant \f$ \epsilon \f$
+	* @param[in] n Length of the arrays
+	*/
+	DllExport void			softMul(float *dst, const float *src, float epsilon, size_t n);
+	/**
+	* @brief Element-wise division by a scalar: \f$ dst[i] = dst[i] / val \f$
+	* @param[in,out] dst Array of length \b n
+	* @param[in] val The divisor
+	* @param[in] n Length of the array
+	*/
+	DllExport void			div(float *dst, float val, size_t n);
+	/**
+	* @brief Sum of the elements: \f$ \sum_i src[i] \f$
+	* @param[in] src Array of length \b n
+	* @param[in] n Length of the array
+	* @return The sum of all elements of \b src
+	*/
+	DllExport float			sum(const float *src, size_t n);
+	/**
+	* @brief Accumulation of the weighted squared row: \f$ dst[i] = dst[i] + v\cdot M[i]\cdot M[i] \f$
+	* @details This is the sum-product step of CMessagePassing::MatMul() for one row \b M of the edge potential matrix
+	* @param[in,out] dst Array of length \b n
+	* @param[in] M Array of length \b n
+	* @param[in] v The weight
+	* @param[in] n Length of the arrays
+	*/
+	DllExport void			sqrMulAdd(float *dst, const float *M, float v, size_t n);
+	/**
+	* @brief Maximum of the weighted squared row: \f$ dst[i] = \max(dst[i], v\cdot M[i]\cdot M[i]) \f$
+	* @details This is the max-product step of CMessagePassing::MatMul() for one row \b M of the edge potential matrix
+	* @param[in,out] dst Array of length \b n
+	* @param[in] M Array of length \b n
+	* @param[in] v The weight
+	* @param[in] n Length of the arrays
+	*/
+	DllExport void			sqrMulMax(float *dst, const float *M, float v, size_t n);
+	/**
+	* @brief Element-wise sum: \f$ dst[i] = dst[i] + src[i] \f$
+	* @details This is the product of the messages in the log-domain
+	* @param[in,out] dst Array of length \b n
+	* @param[in] src Array of length \b n
+	* @param[in] n Length of the arrays
+	*/
+	DllExport void			add(float *dst, const float *src, size_t n);
+	/**
+	* @brief Minimum of the shifted row: \f$ dst[i] = \min(dst[i], v + E[i]) \f$
+	* @details This is the min-sum step of the message calculation in the log-domain for one row \b E of the edge energy matrix
+	* @param[in,out] dst Array of length \b n
+	* @param[in] E Array of length \b n
+	* @param[in] v The shift
+	* @param[in] n Length of the arrays
+	*/
+	DllExport void			addMin(float *dst, const float *E, float v, size_t n);
+	/**
+	* @brief Accumulation of the weighted array: \f$ dst[i] = dst[i] + a\cdot src[i] \f$
+	* @details This is the splatting, blurring and slicing step of the permutohedral lattice filter for one lattice vertex
+	* @param[in,out] dst Array of length \b n
+	* @param[in] src Array of length \b n
+	* @param[in] a The weight
+	* @param[in] n Length of the arrays
+	*/
+	DllExport void			axpy(float *dst, const float *src, float a, size_t n);
+} }
@@ -131,6 +131,9 @@ void testGraphPairwiseBuilding(IGraphPairwise& graph, byte nStates)
 	ASSERT_EQ(2, pot.at<float>(0, 0));
 
 	Mat pot_in = random::U(Size(nStates, nStates), CV_32FC1, 0.0, 100.0);
+	graph.setEdge(n, n + 1, pot_in);				// the other edges of the group keep the group potential
+	graph.getEdge(n + 1, n, pot);
+	ASSERT_EQ(2, pot.at<float>(0, 0));
 	graph.setArc(n, n + 1, pot_in);
 	Mat pot_out;
 	graph.getEdge(n, n + 1, pot_out);
@@ -202,6 +205,62 @@ TEST_F(CTestGraph, CG_dense_extension)
 	testGraphExtension(graphExt, graph);
 }
 
+TEST_F(CTestGraph, CG_dense_gaussian)
+{
+	const byte nStates = static_cast<byte>(random::u(2, 10));
+	const Size graphSize = Size(random::u<int>(10, 50), random::u<int>(10, 50));
+	const Vec2f sigma = Vec2f(random::U<float>(0.5f, 4.0f), random::U<float>(0.5f, 4.0f));
+	const int radiusX = static_cast<int>(ceilf(3 * sigma.val[0]));
+	const int radiusY = static_cast<int>(ceilf(3 * sigma.val[1]));
+
+	Mat pots = random::U(Size(nStates, graphSize.width * graphSize.height), CV_32FC1, 0.0, 1.0);
+	Mat res;
+	CEdgeModelGaussian edgeModel(graphSize, sigma, 2.0f);
+	edgeModel.apply(pots, res);
+
+	// Direct evaluation of the truncated Gaussian filter
+	for (int y = 0; y < graphSize.height; y++)
+		for (int x = 0; x < graphSize.width; x++) {
+			vec_float_t vSum(nStates, 0.0f);
+			float norm = 0;
+			for (int y1 = MAX(0, y - radiusY); y1 <= MIN(graphSize.height - 1, y + radiusY); y1++)
+				for (int x1 = MAX(0, x - radiusX); x1 <= MIN(graphSize.width - 1, x + radiusX); x1++) {
+					const float dx = static_cast<float>(x1 - x) / sigma.val[0];
+					const float dy = static_cast<float>(y1 - y) / sigma.val[1];
+					const float w = expf(-0.5f * (dx * dx + dy * dy));
+					norm += w;
+					for (int s = 0; s < nStates; s++) vSum[s] += w * pots.at<float>(y1 * graphSize.width + x1, s);
+				}
+			for (int s = 0; s < nStates; s++)
+				ASSERT_NEAR(expf(2.0f * vSum[s] / norm), res.at<float>(y * graphSize.width + x, s), 1e-3f);
+		}
+}
+
+TEST_F(CTestGraph, CG_dense_compatibility)
+{
+	const byte nStates = static_cast<byte>(random::u(2, 10));
+	const int nNodes = random::u<int>(100, 1000);
+	
+	Mat features = random::U(Size(3, nNodes), CV_32FC1, 0.0, 10.0);
+	Mat pots = random::U(Size(nStates, nNodes), CV_32FC1, 0.0, 1.0);
+	Mat compatibility = random::U(Size(nStates, nStates), CV_32FC1, -1.0, 1.0);
+
+	CEdgeModelPotts	edgeModelPotts(features, 2.0f);
+	CEdgeModelCompatibility edgeModelCompatibility(features, compatibility, 2.0f);
+
+	Mat msgPotts(pots.size(), CV_32FC1, Scalar(0));
+	Mat msgCompatibility(pots.size(), CV_32FC1, Scalar(0));
+	edgeModelPotts.applyLog(pots, msgPotts);
+	edgeModelCompatibility.applyLog(pots, msgCompatibility);
+
+	for (int n = 0; n < nNodes; n++)
+		for (int s = 0; s < nStates; s++) {
+			float val = 0;
+			for (int t = 0; t < nStates; t++) val += msgPotts.at<float>(n, t) * compatibility.at<float>(t, s);
+			ASSERT_NEAR(val, msgCompatibility.at<float>(n, s), 1e-4f);
+		}
+}
+
 TEST_F(CTestGraph, CG_pairwise_extension)
 {
 	const byte nStates = static_cast<byte>(random::u(10, 255));
@@ -210,6 +269,42 @@ TEST_F(CTestGraph, CG_pairwise_extension)
 	testGraphExtension(graphExt, graph);
 }
 
+TEST_F(CTestGraph, CG_pairwise_bulk)
+{
+	const byte nStates = static_cast<byte>(random::u(2, 10));
+	const size_t nNodes = random::u<size_t>(10, 1000);
+	CGraphPairwise graph(nStates);
+	CGraphPairwise graphBulk(nStates);
+
+	vec_size_t vSrcNodes, vDstNodes;
+	vec_byte_t vGroups;
+	for (size_t n = 0; n < nNodes; n++) {
+		graph.addNode();
+		for (size_t step : { 1, 7 })
+			if (n >= step) {
+				graph.addArc(n, n - step, static_cast<byte>(step), Mat());
+				vSrcNodes.insert(vSrcNodes.end(), { n, n - step });
+				vDstNodes.insert(vDstNodes.end(), { n - step, n });
+				vGroups.insert(vGroups.end(), 2, static_cast<byte>(step));
+			}
+	}
+	ASSERT_EQ(0, graphBulk.addNodes(nNodes));
+	graphBulk.addEdges(vSrcNodes, vDstNodes, vGroups);
+
+	ASSERT_EQ(graph.getNumNodes(), graphBulk.getNumNodes());
+	ASSERT_EQ(graph.getNumEdges(), graphBulk.getNumEdges());
+	vec_size_t vNodes, vNodesBulk;
+	for (size_t n = 0; n < nNodes; n++) {
+		graph.getChildNodes(n, vNodes);
+		graphBulk.getChildNodes(n, vNodesBulk);
+		ASSERT_EQ(vNodes, vNodesBulk);
+		graph.getParentNodes(n, vNodes);
+		graphBulk.getParentNodes(n, vNodesBulk);
+		ASSERT_EQ(vNodes, vNodesBulk);
+		for (size_t c : vNodes) ASSERT_EQ(graph.getEdgeGroup(c, n), graphBulk.getEdgeGroup(c, n));
+	}
+}
+
 TEST_F(CTestGraph, CG_pairwise_layered) 
 {
 	const byte nStatesBase = static_cast<byte>(random::u(5, 127));
@@ -260,4 +355,101 @@ TEST_F(CTestGraph, CG_pairwise_layered)
 	// fillEdges(const CTrainEdge &edgeTrainer, const CTrainLink* linkTrainer, const vec_mat_t &featureVectors, const vec_float_t &vParams, float edgeWeight = 1.0f, float linkWeight = 1.0f);
 	// defineEdgeGroup(float A, float B, float C, byte group);
 	// setEdges(std::optional<byte> group, const Mat &pot);
+}
+
+TEST_F(CTestGraph, CG_pairwise_layered_fillEdges)
+{
+	const byte nStates = static_cast<byte>(random::u(2, 16));
+	const word nFeatures = static_cast<word>(random::u(1, 5));
+	const vec_float_t vParams = { 100.0f, 0.01f };
+	const float weight = 2.0f;
+	CTrainEdgePottsCS edgeTrainer(nStates, nFeatures);
+
+	// The single-column and single-row graphs have the vertical (horizontal) edges only
+	for (const Size &graphSize : { Size(random::u<int>(5, 50), random::u<int>(5, 50)), Size(1, random::u<int>(5, 50)), Size(random::u<int>(5, 50), 1) }) {
+		CGraphPairwise graph(nStates);
+		CGraphLayeredExt graphExt(graph, 1, GRAPH_EDGES_GRID | GRAPH_EDGES_DIAG);
+		graphExt.buildGraph(graphSize);
+
+		Mat featureVectors = random::U(graphSize, CV_8UC(nFeatures));
+		graphExt.fillEdges(edgeTrainer, NULL, featureVectors, vParams, weight);
+		ASSERT_TRUE(graphExt.isTopologyFrozen());
+
+		// Reference: the single-edge potentials, assigned with setArc()
+		CGraphPairwise refGraph(nStates);
+		CGraphLayeredExt refGraphExt(refGraph, 1, GRAPH_EDGES_GRID | GRAPH_EDGES_DIAG);
+		refGraphExt.buildGraph(graphSize);
+		ASSERT_EQ(refGraph.getNumEdges(), graph.getNumEdges());
+		Mat pot, refPot;
+		for (int y = 0; y < graphSize.height; y++)
+			for (int x = 0; x < graphSize.width; x++)
+				for (const Point &d : { Point(-1, 0), Point(0, -1), Point(-1, -1), Point(1, -1) }) {
+					const Point n = Point(x, y) + d;
+					if (n.x < 0 || n.y < 0 || n.x >= graphSize.width) continue;
+					const size_t node1 = y * graphSize.width + x;
+					const size_t node2 = n.y * graphSize.width + n.x;
+					refGraph.setArc(node1, node2, edgeTrainer.getEdgePotentials(featureVectors.row(y).colRange(x, x + 1).reshape(1, nFeatures), featureVectors.row(n.y).colRange(n.x, n.x + 1).reshape(1, nFeatures), vParams, weight));
+					for (const auto &[src, dst] : { std::make_pair(node1, node2), std::make_pair(node2, node1) }) {
+						graph.getEdge(src, dst, pot);
+						refGraph.getEdge(src, dst, refPot);
+						ASSERT_LE(norm(refPot, pot, NORM_INF), 1e-4);
+					}
+				}
+	}
+}
+
+TEST_F(CTestGraph, CG_pairwise_layered_frozen)
+{
+	const byte nStates = static_cast<byte>(random::u(2, 16));
+	const Size graphSize = Size(random::u<int>(5, 50), random::u<int>(5, 50));
+
+	CGraphPairwise graph(nStates);
+	CGraphLayeredExt graphExt(graph, 2, GRAPH_EDGES_GRID | GRAPH_EDGES_DIAG | GRAPH_EDGES_LINK);
+	graphExt.buildGraph(graphSize);
+	ASSERT_FALSE(graphExt.isTopologyFrozen());
+	graphExt.freezeTopology();
+	ASSERT_TRUE(graphExt.isTopologyFrozen());
+
+	const size_t nPixels = static_cast<size_t>(graphSize.width) * graphSize.height;
+	const size_t nArcs = nPixels															// links
+		+ 2 * ((graphSize.width - 1) * graphSize.height + graphSize.width * (graphSize.height - 1))		// grid
+		+ 2 * 2 * (graphSize.width - 1) * (graphSize.height - 1);										// diagonals
+	ASSERT_EQ(nArcs, graphExt.getNumArcs());
+	ASSERT_EQ(2 * nArcs, graph.getNumEdges());
+
+	Mat pots = random::U(Size(nStates * nStates, static_cast<int>(nArcs)), CV_32FC1, 0.1, 100.0);
+	graphExt.setArcPots(pots);
+
+	// The arcs in the order of their creation
+	std::vector<std::pair<size_t, size_t>> vArcs;
+	const size_t w = graphSize.width;
+	for (size_t y = 0; y < static_cast<size_t>(graphSize.height); y++)
+		for (size_t x = 0; x < w; x++) {
+			const size_t idx = 2 * (y * w + x);
+			vArcs.emplace_back(idx, idx + 1);
+			for (size_t l = 0; l < 2; l++) if (x > 0) vArcs.emplace_back(idx + l, idx + l - 2);
+			for (size_t l = 0; l < 2; l++) if (y > 0) vArcs.emplace_back(idx + l, idx + l - 2 * w);
+		}
+	for (size_t y = 1; y < static_cast<size_t>(graphSize.height); y++)
+		for (size_t x = 0; x < w; x++) {
+			const size_t idx = 2 * (y * w + x);
+			for (size_t l = 0; l < 2; l++) if (x > 0) vArcs.emplace_back(idx + l, idx + l - 2 * (w + 1));
+			for (size_t l = 0; l < 2; l++) if (x < w - 1) vArcs.emplace_back(idx + l, idx + l - 2 * (w - 1));
+		}
+	ASSERT_EQ(nArcs, vArcs.size());
+
+	Mat pot, pot12, pot21;
+	for (size_t a = 0; a < nArcs; a++) {
+		const auto [node1, node2] = vArcs[a];
+		sqrt(pots.row(static_cast<int>(a)).reshape(1, nStates), pot);
+		graph.getEdge(node1, node2, pot12);
+		graph.getEdge(node2, node1, pot21);
+		ASSERT_EQ(0, norm(pot, pot12, NORM_INF));
+		ASSERT_EQ(0, norm(pot.t(), pot21, NORM_INF));
+	}
+
+	// Changing the topology releases the frozen topology
+	graph.addNode();
+	ASSERT_FALSE(graphExt.isTopologyFrozen());
+	ASSERT_EQ(0, graphExt.getNumArcs());
 }
\ No newline at end of file
@@ -37,6 +37,18 @@ void fillGraph(IGraphPairwise& graph)
 		graph.setEdges(std::nullopt, edgePot);
 	}
 
+namespace {
+	// Exposes the protected kernels of the message passing
+	class CMessagePassingKernels : public CMessagePassing {
+	public:
+		using CMessagePassing::MatMul;
+		using CMessagePassing::MatMulPotts;
+		using CMessagePassing::MaxProductPotts;
+		using CMessagePassing::MinSum;
+		using CMessagePassing::MinSumPotts;
+	};
+}
+
 // Constructor
 CTestInference::CTestInference(void)
 {
@@ -90,6 +102,55 @@ TEST_F(CTestInference, inference_LBP)
 	testInferer(inferer);
 }
 
+TEST_F(CTestInference, inference_LBP_checkerboard)
+{
+	CGraphPairwise graph(m_nStates);
+	buildGraph(graph, m_nNodes);
+	fillGraph(graph);
+
+	CInferLBP inferer(graph);
+	inferer.setCheckerboard(true);
+	testInferer(inferer);
+}
+
+TEST_F(CTestInference, inference_RBP)
+{
+	CGraphPairwise graph(m_nStates);
+	buildGraph(graph, m_nNodes);
+	fillGraph(graph);
+
+	CInferRBP inferer(graph);
+	testInferer(inferer);
+	ASSERT_LT(inferer.getNumUpdates(), 100 * graph.getNumEdges());		// converged before the iterations limit
+
+	fillGraph(graph);
+	inferer.setRelaxed(true);
+	testInferer(inferer);
+}
+
+TEST_F(CTestInference, inference_tolerance)
+{
+	CGraphPairwise graph(m_nStates);
+	buildGraph(graph, m_nNodes);
+	
+	for (bool checkerboard : { false, true }) {
+		fillGraph(graph);
+		CInferLBP inferer(graph);
+		inferer.setCheckerboard(checkerboard);
+		inferer.setTolerance(1e-7f);
+		testInferer(inferer);
+		ASSERT_LT(inferer.getStats().nIt, 100u);								// converged before the iterations limit
+		ASSERT_LT(inferer.getStats().residual, 1e-7f);
+	}
+
+	fillGraph(graph);
+	CInferTRW inferer(graph);
+	inferer.setTolerance(1e-6f);
+	inferer.infer(100);
+	ASSERT_LT(inferer.getStats().nIt, 100u);
+	ASSERT_LT(inferer.getStats().residual, 1e-6f);
+}
+
 TEST_F(CTestInference, inference_exact_weiss)
 {
 	CGraphWeiss graph(m_nStates);
@@ -99,3 +160,174 @@ TEST_F(CTestInference, inference_exact_weiss)
 	CInferExact inferer(graph);
 	testInferer(inferer);
 }
+
+TEST_F(CTestInference, inference_distance)
+{
+	const byte nStates = 16;
+	for (EdgeDistance dist : { EdgeDistance::linear, EdgeDistance::quadratic }) {
+		CGraphPairwise graphDist(nStates);
+		CGraphPairwise graphDense(nStates);
+		for (CGraphPairwise *pGraph : { &graphDist, &graphDense }) {
+			buildGraph(*pGraph, m_nNodes);
+			Mat nodePot(nStates, 1, CV_32FC1);
+			for (size_t i = 0; i < m_nNodes; i++) {
+				for (byte s = 0; s < nStates; s++) nodePot.at<float>(s, 0) = 0.1f + fabsf(sinf(7.0f * i + 3.0f * s));
+				pGraph->setNode(i, nodePot);
+			}
+		}
+		graphDist.setDistanceEdges(std::nullopt, dist, 0.3f, 5.0f);
+		
+		// The same potentials as an arbitrary matrix
+		Mat edgePot;
+		graphDist.getEdge(0, 1, edgePot);
+		graphDense.setEdges(std::nullopt, edgePot);
+
+		CInferViterbi viterbiDist(graphDist), viterbiDense(graphDense);
+		ASSERT_EQ(viterbiDist.decode(10), viterbiDense.decode(10));
+		CInferTRW trwDist(graphDist), trwDense(graphDense);
+		ASSERT_EQ(trwDist.decode(10), trwDense.decode(10));
+	}
+}
+
+TEST_F(CTestInference, inference_log_domain)
+{
+	CGraphPairwise graph(m_nStates);
+	buildGraph(graph, m_nNodes);
+
+	// Sum-product
+	CInferChain chain(graph);
+	CInferTree tree(graph);
+	CInferLBP lbp(graph);
+	CInferRBP rbp(graph);
+	for (CMessagePassing *pInferer : std::initializer_list<CMessagePassing *>{ &chain, &tree, &lbp, &rbp }) {
+		fillGraph(graph);
+		pInferer->setLogDomain(true);
+		testInferer(*pInferer);
+	}
+
+	// Max-product: Potts, truncated distance and arbitrary edge potentials
+	const byte nStates = 16;
+	for (int edges = 0; edges < 3; edges++) {
+		CGraphPairwise graphLog(nStates);
+		CGraphPairwise graphLin(nStates);
+		for (CGraphPairwise *pGraph : { &graphLog, &graphLin }) {
+			buildGraph(*pGraph, m_nNodes);
+			Mat nodePot(nStates, 1, CV_32FC1);
+			for (size_t i = 0; i < m_nNodes; i++) {
+				for (byte s = 0; s < nStates; s++) nodePot.at<float>(s, 0) = 0.1f + fabsf(sinf(7.0f * i + 3.0f * s));
+				pGraph->setNode(i, nodePot);
+			}
+			Mat edgePot(nStates, nStates, CV_32FC1);
+			if (edges == 0) edgePot = Mat::eye(nStates, nStates, CV_32FC1) + 0.5f;
+			if (edges == 1) pGraph->setDistanceEdges(std::nullopt, EdgeDistance::quadratic, 0.3f, 5.0f);
+			else {
+				if (edges == 2) 
+					for (byte y = 0; y < nStates; y++)
+						for (byte x = 0; x < nStates; x++) edgePot.at<float>(y, x) = 1.0f + fabsf(cosf(1.0f * x * y));
+				pGraph->setEdges(std::nullopt, edgePot);
+			}
+		}
+
+		CInferViterbi viterbiLog(graphLog), viterbiLin(graphLin);
+		viterbiLog.setLogDomain(true);
+		ASSERT_EQ(viterbiLog.decode(10), viterbiLin.decode(10));
+	}
+}
+
+TEST_F(CTestInference, inference_simd)
+{
+	const byte nStates = 19;													// not a multiple of the vector length
+	const simd::ISA bestISA = simd::getISA();
+	std::vector<vec_float_t> vPots;
+	for (simd::ISA isa : { simd::ISA::scalar, simd::ISA::SSE, simd::ISA::NEON, simd::ISA::AVX2, simd::ISA::AVX512 }) {
+		if (!simd::isSupported(isa)) continue;
+		simd::setISA(isa);
+
+		CGraphPairwise graph(nStates);
+		buildGraph(graph, m_nNodes);
+		Mat nodePot(nStates, 1, CV_32FC1);
+		Mat edgePot(nStates, nStates, CV_32FC1);
+		for (size_t i = 0; i < m_nNodes; i++) {
+			for (byte s = 0; s < nStates; s++) nodePot.at<float>(s, 0) = 0.1f + fabsf(sinf(7.0f * i + 3.0f * s));
+			graph.setNode(i, nodePot);
+		}
+		for (byte y = 0; y < nStates; y++)
+			for (byte x = 0; x < nStates; x++) edgePot.at<float>(y, x) = 1.0f + fabsf(cosf(1.0f * x * y));
+		graph.setEdges(std::nullopt, edgePot);
+
+		CInferLBP inferer(graph);
+		inferer.infer(10);
+		vPots.push_back(inferer.getPotentials(0));
+	}
+	simd::setISA(bestISA);
+
+	for (const vec_float_t &pot : vPots)
+		for (size_t i = 0; i < pot.size(); i++)
+			ASSERT_LT(fabs(pot[i] - vPots.front()[i]), 1e-5);
+}
+
+TEST_F(CTestInference, inference_dense_tiled)
+{
+	const byte nStates = 4;
+	const Size imageSize(60, 45);
+	const unsigned int nIt = 3;
+	const Vec2f sigma = Vec2f::all(1.0f);
+	Mat pots = random::U(imageSize, CV_32FC(nStates), 0.1, 1.0);
+	
+	// Reference: the whole image; the separable Gaussian is exact, thus the tiles with a sufficient halo give the same result
+	CGraphDenseKit graphKit(nStates);
+	CGraphDenseExt &graphExt = dynamic_cast<CGraphDenseExt &>(graphKit.getGraphExt());
+	graphExt.setGraph(pots);
+	graphExt.addGaussianEdgeModel(sigma, 2.0f, {}, true);
+	graphKit.getInfer().infer(nIt);
+	Mat ref = dynamic_cast<CGraphDense &>(graphKit.getGraph()).getNodePotentials().reshape(nStates, imageSize.height);
+
+	Mat res(imageSize, CV_32FC(nStates), Scalar::all(-1));
+	const int halo = 3 * (nIt + 1);												// 3 sigma for every iteration and for the normalization
+	graphKit.inferTiled(imageSize, Size(16, 16), halo, nIt, [&](CGraphDenseExt &tileExt, const Rect &roi) {
+		tileExt.setGraph(pots(roi));
+		tileExt.addGaussianEdgeModel(sigma, 2.0f, {}, true);
+	}, [&](const Rect &roi, const Mat &tilePots) {
+		tilePots.copyTo(res(roi));
+	});
+
+	for (int y = 0; y < imageSize.height; y++) {
+		const float *pRef = ref.ptr<float>(y);
+		const float *pRes = res.ptr<float>(y);
+		for (int x = 0; x < imageSize.width * nStates; x++)
+			ASSERT_NEAR(pRef[x], pRes[x], 1e-5f);
+	}
+}
+
+TEST_F(CTestInference, inference_potts_kernels)
+{
+	const byte nStates = 7;
+	Mat M(nStates, nStates, CV_32FC1, Scalar(0.3f));									// Potts matrix: equal off-diagonal elements
+	for (byte s = 0; s < nStates; s++) M.at<float>(s, s) = 0.5f + 0.1f * s;
+	Mat sqrtM;
+	sqrt(M, sqrtM);
+	Mat v = random::U(Size(nStates, 1), CV_32FC1, 0.0, 1.0);
+	vec_float_t ref(nStates), res(nStates);
+
+	// Max-product and sum-product with the squared matrix
+	for (bool maxSum : { false, true }) {
+		const float sumRef = CMessagePassingKernels::MatMul(M.ptr<float>(), nStates, v.ptr<float>(), ref.data(), maxSum);
+		const float sumRes = CMessagePassingKernels::MatMulPotts(M.ptr<float>(), nStates, v.ptr<float>(), res.data(), maxSum);
+		for (byte s = 0; s < nStates; s++) ASSERT_NEAR(ref[s], res[s], 1e-5f);
+		ASSERT_NEAR(sumRef, sumRes, 1e-5f);
+	}
+
+	// Max-product with the matrix itself
+	CMessagePassingKernels::MatMul(sqrtM.ptr<float>(), nStates, v.ptr<float>(), ref.data(), true);
+	CMessagePassingKernels::MaxProductPotts(M.ptr<float>(), nStates, v.ptr<float>(), res.data());
+	for (byte s = 0; s < nStates; s++) ASSERT_NEAR(ref[s], res[s], 1e-5f);
+
+	// Min-sum with the energies E = -log(M * M)
+	Mat E;
+	log(M.mul(M), E);
+	E = -E;
+	Mat e = random::U(Size(nStates, 1), CV_32FC1, 0.0, 5.0);
+	CMessagePassingKernels::MinSum(E.ptr<float>(), nStates, e.ptr<float>(), ref.data());
+	CMessagePassingKernels::MinSumPotts(M.ptr<float>(), nStates, e.ptr<float>(), res.data());
+	for (byte s = 0; s < nStates; s++) ASSERT_NEAR(ref[s], res[s], 1e-5f);
+}
@@ -0,0 +1,227 @@
+#include "TestTrain.h"
+#include "DGM/random.h"
+
+// Trains the node trainer with one cluster of samples per state, except the state skipState
+void CTestTrain::trainNode(CTrainNode &nodeTrainer, std::optional<byte> skipState)
+{
+	Mat featureVector(nFeatures, 1, CV_8UC1);
+	for (byte s = 0; s < nStates; s++)
+		for (int i = 0; i < (s == skipState ? 0 : nSamples); i++) {
+			for (word f = 0; f < nFeatures; f++)
+				featureVector.at<byte>(f, 0) = saturate_cast<byte>(random::N<double>(40 + 80 * s + 10 * f, 20));
+			nodeTrainer.addFeatureVec(featureVector, s);
+		}
+	nodeTrainer.train();
+}
+
+// Compares the node potentials of an image with the node potentials of its single pixels
+void CTestTrain::testNodePotentials(const CTrainNode &nodeTrainer, float tolerance)
+{
+	Mat image	= random::U(Size(imageSize.width + 5, imageSize.height), CV_8UC(nFeatures), 0, 256);
+	Mat weights	= random::U(image.size(), CV_32FC1, 0.25, 1.0);		// larger weights may overflow the unnormalized potentials
+
+	// The continuous image is processed as one sequence of pixels, its region - row by row
+	for (const Rect &roi : { Rect(Point(0, 0), image.size()), Rect(Point(3, 0), imageSize) })
+		for (float Z : { 0.0f, 1000.0f }) {
+			Mat pots = nodeTrainer.getNodePotentials(image(roi), weights(roi), Z);
+			ASSERT_EQ(roi.size(), pots.size());
+			ASSERT_EQ(CV_32FC(nStates), pots.type());
+			for (int y = 0; y < roi.height; y++)
+				for (int x = 0; x < roi.width; x++) {
+					Mat featureVector(nFeatures, 1, CV_8UC1, image.ptr<byte>(roi.y + y) + (roi.x + x) * nFeatures);
+					Mat pot = nodeTrainer.getNodePotentials(featureVector, weights.at<float>(roi.y + y, roi.x + x), Z);
+					const float *pPots = pots.ptr<float>(y) + x * nStates;
+					for (byte s = 0; s < nStates; s++)
+						ASSERT_NEAR(pot.at<float>(s, 0), pPots[s], tolerance * MAX(1.0f, pot.at<float>(s, 0)));
+				}
+		}
+}
+
+// Compares the node potentials of an image with the product of the PDFs of the naive Bayes model
+void CTestTrain::testNodePotentialsBayes(CTrainNodeBayes &nodeTrainer)
+{
+	Mat image	= random::U(imageSize, CV_8UC(nFeatures), 0, 256);
+	Mat pots	= nodeTrainer.getNodePotentials(image);
+	
+	std::vector<double> vPot(nStates);
+	for (int y = 0; y < imageSize.height; y++)
+		for (int x = 0; x < imageSize.width; x++) {
+			// The trained states have equal priors, thus the prior does not affect the normalized potentials
+			const byte *pFv = image.ptr<byte>(y) + x * nFeatures;
+			vec_byte_t vMask(nStates, 1);
+			double Sum = 0;
+			for (byte s = 0; s < nStates; s++) {
+				vPot[s] = 1;
+				for (word f = 0; f < nFeatures; f++) {
+					ptr_pdf_t pPDF = nodeTrainer.getPDF(s, f);
+					if (pPDF->isEstimated()) vPot[s] *= pPDF->getDensity(pFv[f]);
+					else {
+						vPot[s] = 0;
+						vMask[s] = 0;
+					}
+				}
+				Sum += vPot[s];
+			}
+			
+			const float *pPots = pots.ptr<float>(y) + x * nStates;
+			for (byte s = 0; s < nStates; s++) {
+				const double pot = Sum > 0 ? 100 * vPot[s] / Sum : (vMask[s] ? FLT_EPSILON : 0);		// zero densities of all relevant states
+				ASSERT_NEAR(pot, pPots[s], 1e-4 * MAX(1.0, pot));
+			}
+		}
+}
+
+// Compares the node potentials of an image with the node potentials of its single pixels, evaluated with CKDGauss::getValue()
+void CTestTrain::testNodePotentialsGMM(const CTrainNodeGMM &nodeTrainer, const Mat &image)
+{
+	Mat pots = nodeTrainer.getNodePotentials(image);
+	
+	// A column of a wider matrix is not continuous: the single-sample function does not use the frozen model for it
+	Mat featureVectors(nFeatures, 2, CV_8UC1);
+	Mat featureVector = featureVectors.col(0);
+	int nFinite = 0;
+	for (int y = 0; y < image.rows; y++)
+		for (int x = 0; x < image.cols; x++) {
+			const byte *pFv = image.ptr<byte>(y) + x * nFeatures;
+			for (word f = 0; f < nFeatures; f++) featureVector.at<byte>(f, 0) = pFv[f];
+			Mat pot = nodeTrainer.getNodePotentials(featureVector, 1.0f);
+			if (!std::all_of(pot.begin<float>(), pot.end<float>(), [](float val) { return std::isfinite(val); }))
+				continue;								// the long double coefficients overflow the float potentials
+			nFinite++;
+			const float *pPots = pots.ptr<float>(y) + x * nStates;
+			for (byte s = 0; s < nStates; s++) {
+				ASSERT_TRUE(std::isfinite(pPots[s]));
+				ASSERT_NEAR(pot.at<float>(s, 0), pPots[s], 1e-4f * MAX(1.0f, pot.at<float>(s, 0)));
+			}
+		}
+	ASSERT_GT(nFinite, 0);
+}
+
+// Writes a model with one Gaussian per state in the format of CTrainNodeGMM::saveFile()
+void CTestTrain::saveGMM(const std::string &name, const vec_mat_t &vMu, const vec_mat_t &vSigma, long double minAlpha)
+{
+	FILE *pFile = fopen((name + ".dat").c_str(), "wb");
+	ASSERT_TRUE(pFile != NULL);
+	
+	const word		maxGausses		= 1;
+	const size_t	minSamples		= 64;
+	const double	vTresholds[]	= { 1.0, 1.0, 1.0 };
+	fwrite(&maxGausses, sizeof(word), 1, pFile);
+	fwrite(&minSamples, sizeof(size_t), 1, pFile);
+	fwrite(vTresholds, sizeof(double), 3, pFile);
+	for (byte s = 0; s < nStates; s++) {
+		const word	nGausses	= 1;
+		const long	nPoints		= nSamples;
+		fwrite(&nGausses, sizeof(word), 1, pFile);
+		fwrite(&nPoints, sizeof(long), 1, pFile);
+		for (word y = 0; y < nFeatures; y++)
+			fwrite(&vMu[s].at<double>(y, 0), sizeof(double), 1, pFile);
+		for (word y = 0; y < nFeatures; y++)
+			for (word x = 0; x < nFeatures; x++)
+				fwrite(&vSigma[s].at<double>(y, x), sizeof(double), 1, pFile);
+	}
+	fwrite(&minAlpha, sizeof(long double), 1, pFile);
+	fclose(pFile);
+}
+
+TEST_F(CTestTrain, node_potentials_batch)
+{
+	CTrainNodeBayes bayes(nStates, nFeatures);
+	trainNode(bayes);
+	testNodePotentials(bayes);
+
+	CTrainNodeGMM gmm(nStates, nFeatures);
+	trainNode(gmm);
+	testNodePotentials(gmm);
+
+	CTrainNodeKNN knn(nStates, nFeatures);
+	trainNode(knn);
+	testNodePotentials(knn);
+
+#ifdef USE_SHERWOOD
+	CTrainNodeMsRF msrf(nStates, nFeatures);
+	trainNode(msrf);
+	testNodePotentials(msrf);
+#endif
+}
+
+TEST_F(CTestTrain, node_potentials_batch_cv)
+{
+	// The batch predictions of the cv::ml models are calculated for a whole chunk of samples at once
+	CTrainNodeCvRF rf(nStates, nFeatures);
+	trainNode(rf);
+	testNodePotentials(rf);
+
+	CTrainNodeCvSVM svm(nStates, nFeatures);
+	trainNode(svm);
+	testNodePotentials(svm);
+
+	CTrainNodeCvANN ann(nStates, nFeatures);
+	trainNode(ann);
+	testNodePotentials(ann);
+
+	CTrainNodeCvKNN knn(nStates, nFeatures);
+	trainNode(knn);
+	testNodePotentials(knn);
+
+	CTrainNodeCvGMM gmm(nStates, nFeatures);
+	trainNode(gmm);
+	testNodePotentials(gmm);
+}
+
+TEST_F(CTestTrain, node_potentials_bayes_lut)
+{
+	// The last state has no samples: its PDFs are not estimated and it is masked out
+	CTrainNodeBayes bayes(nStates, nFeatures);
+	trainNode(bayes, nStates - 1);
+	testNodePotentialsBayes(bayes);
+
+	// The log-densities are updated with the smoothed PDFs
+	bayes.smooth(3);
+	testNodePotentialsBayes(bayes);
+
+	// The log-densities of the loaded model replace the log-densities of the trained one
+	bayes.save("", "TestTrainBayes");
+	CTrainNodeBayes loaded(nStates, nFeatures);
+	trainNode(loaded);
+	loaded.load("", "TestTrainBayes");
+	std::remove("TestTrainBayes.dat");
+	testNodePotentialsBayes(loaded);
+}
+
+TEST_F(CTestTrain, node_potentials_gmm_frozen)
+{
+	// The pixels are sampled around the clusters, where the Gaussians are not negligible
+	Mat image(imageSize, CV_8UC(nFeatures));
+	for (int y = 0; y < imageSize.height; y++)
+		for (int x = 0; x < imageSize.width; x++) {
+			const int s = random::u<int>(0, nStates - 1);
+			for (word f = 0; f < nFeatures; f++)
+				image.ptr<byte>(y)[x * nFeatures + f] = saturate_cast<byte>(random::N<double>(40 + 80 * s + 10 * f, 30));
+		}
+
+	CTrainNodeGMM gmm(nStates, nFeatures);
+	trainNode(gmm);
+	testNodePotentialsGMM(gmm, image);
+
+	vec_mat_t vMu, vSigma;
+	for (byte s = 0; s < nStates; s++) {
+		vMu.push_back((Mat_<double>(nFeatures, 1) << 40 + 80 * s, 50 + 80 * s, 60 + 80 * s));
+		vSigma.push_back(400 * Mat::eye(nFeatures, nFeatures, CV_64FC1));
+	}
+
+	// The scaled coefficients alpha / minAlpha exceed FLT_MAX: the frozen model must not overflow where the long double one does not
+	CTrainNodeGMM loaded(nStates, nFeatures);
+	saveGMM("TestTrainGMM", vMu, vSigma, 1e-50L);
+	loaded.load("", "TestTrainGMM");
+	testNodePotentialsGMM(loaded, random::U(imageSize, CV_8UC(nFeatures), 0, 256));
+
+	// The covariance matrix of the last state is not positive definite: the model is not frozen
+	for (word f = 1; f < nFeatures; f++)
+		vSigma[nStates - 1].at<double>(f, f) = -400;
+	CTrainNodeGMM nonPD(nStates, nFeatures);
+	saveGMM("TestTrainGMM", vMu, vSigma, 1e-5L);
+	nonPD.load("", "TestTrainGMM");
+	std::remove("TestTrainGMM.dat");
+	testNodePotentialsGMM(nonPD, image);
+}
@@ -0,0 +1,28 @@
+#pragma once
+
+#include "gtest/gtest.h"
+#include "types.h"
+#include "DGM.h"
+
+using namespace DirectGraphicalModels;
+
+class CTestTrain : public ::testing::Test {
+public:
+	CTestTrain(void) = default;
+	~CTestTrain(void) = default;
+
+
+protected:
+	void	trainNode(CTrainNode &nodeTrainer, std::optional<byte> skipState = std::nullopt);
+	void	testNodePotentials(const CTrainNode &nodeTrainer, float tolerance = 1e-4f);
+	void	testNodePotentialsBayes(CTrainNodeBayes &nodeTrainer);
+	void	testNodePotentialsGMM(const CTrainNodeGMM &nodeTrainer, const Mat &image);
+	void	saveGMM(const std::string &name, const vec_mat_t &vMu, const vec_mat_t &vSigma, long double minAlpha);
+
+
+protected:	// Test configuration
+	const byte	nStates		= 3;
+	const word	nFeatures	= 3;
+	const int	nSamples	= 500;					// per state
+	const Size	imageSize	= Size(47, 31);
+};
@@ -24,3 +24,43 @@ TEST_F(CTests, parallel_gemm)
 #endif
 }
 
+
+TEST_F(CTests, parallel_for)
+{
+	auto testParallel = [] {
+		std::vector<int> v(random::u<int>(10, 10000), 0);
+		parallel::parallel_for(0, static_cast<int>(v.size()), [&v](int i) { v[i] += i; });
+		for (size_t i = 0; i < v.size(); i++) ASSERT_EQ(static_cast<int>(i), v[i]);
+
+		parallel::parallel_for_each(v.begin(), v.end(), [](int &val) { val = -val; });
+		for (size_t i = 0; i < v.size(); i++) ASSERT_EQ(-static_cast<int>(i), v[i]);
+
+		Mat m = random::U(Size(3, 1000), CV_32FC1, 0.0, 100.0);
+		parallel::sortRows<float>(m, 0);
+		for (int y = 1; y < m.rows; y++) ASSERT_LE(m.at<float>(y - 1, 0), m.at<float>(y, 0));
+	};
+
+#ifdef ENABLE_THREADPOOL
+	for (size_t nThreads : { 1, 2, 4 }) {
+		parallel::setNumThreads(nThreads);
+		testParallel();
+	}
+	parallel::setNumThreads(0);
+#else
+	testParallel();
+#endif
+}
+
+TEST_F(CTests, parallel_for_exception)
+{
+	// The exceptions are thrown both by the chunk of the calling thread and by the chunks of the other threads
+	const int size = 10000;
+	for (int thrower : { 0, size / 2, size - 1 }) {
+		std::vector<int> v(size, 0);
+		ASSERT_THROW(parallel::parallel_for(0, size, [thrower, &v](int i) {
+			if (i == thrower) throw std::runtime_error("parallel_for_exception");
+			v[i] = i;
+		}), std::runtime_error);
+		v.clear();			// the other chunks are completed before the exception is rethrown
+	}
+}